@@ -0,0 +1,224 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Compiler.h"
+#include "ConstantFolder.h"
+#include "Interpreter.h"
+#include "Lexer.h"
+#include "Literal.h"
+#include "NodeArena.h"
+#include "OutputBuffer.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+#include "Resolver.h"
+#include "VM.h"
+
+namespace {
+const std::string fibonacciSource =
+    "func fib(n){\n"
+    "    if (n < 2){\n"
+    "        return n\n"
+    "    }\n"
+    "    return fib(n - 1) + fib(n - 2)\n"
+    "}\n"
+    "out(fib(20))\n";
+
+const std::string fizzBuzzSource =
+    "func main(x){\n"
+    "    while(x > 0){\n"
+    "        if(x%3 == 0){\n"
+    "            if(x%5 == 0){\n"
+    "                out(\"fizzBuzz\")\n"
+    "            }\n"
+    "            else{\n"
+    "                out(\"fizz\")\n"
+    "            }\n"
+    "        }\n"
+    "        else{\n"
+    "            if(x%5 == 0){\n"
+    "                out(\"buzz\")\n"
+    "            }\n"
+    "            else{\n"
+    "                out(x)\n"
+    "            }\n"
+    "        }\n"
+    "        var x --\n"
+    "    }\n"
+    "}\n"
+    "main(5000)\n";
+
+const std::string stringConcatSource =
+    "func build(n){\n"
+    "    var text = \"\"\n"
+    "    for (var i = 0, i < n, var i ++){\n"
+    "        var text = text + \"ab\"\n"
+    "    }\n"
+    "    return text\n"
+    "}\n"
+    "var built = build(2000)\n"
+    "out(built)\n";
+
+const std::string deepNestingSource =
+    "func nest(n){\n"
+    "    var total = 0\n"
+    "    for (var a = 0, a < n, var a ++){\n"
+    "        for (var b = 0, b < n, var b ++){\n"
+    "            if (a > b){\n"
+    "                if ((a + b) % 2 == 0){\n"
+    "                    while (total < 0){\n"
+    "                        var total = 0\n"
+    "                    }\n"
+    "                    var total = total + ((a * (b + (a - (b * 2)))) % 7)\n"
+    "                }\n"
+    "                else{\n"
+    "                    var total = total - 1\n"
+    "                }\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    return total\n"
+    "}\n"
+    "out(nest(60))\n";
+
+// swallows everything written to it so out() does not dominate the measurement
+class NullBuffer final : public std::streambuf {
+protected:
+    int overflow(const int character) override {return character;}
+    std::streamsize xsputn(const char*, const std::streamsize count) override {return count;}
+};
+
+class SilenceOutput {
+public:
+    SilenceOutput() : previous(std::cout.rdbuf(&nullBuffer)) {}
+    ~SilenceOutput() {std::cout.rdbuf(previous);}
+private:
+    NullBuffer nullBuffer;
+    std::streambuf* previous;
+};
+
+// skips the empty results the parser gives for blank lines, false once the end of the file is reached
+bool nextStatement(Parser& parser, std::unique_ptr<Node>& node) {
+    do {node = parser.parse();}
+    while (!node);
+    return node->getType() != NodeType::EndOfFile;
+}
+
+TokenStream lex(const std::string& source) {
+    PositionHandler positionHandler("bench.vis", SourceBuffer::fromString(source));
+    return Lexer(positionHandler).tokenise();
+}
+
+// parses, folds and resolves every statement the same way Interpreter::interpretFile does
+std::vector<std::unique_ptr<Node>> prepare(const std::string& source) {
+    Parser parser(lex(source));
+    ConstantFolder constantFolder;
+    Resolver resolver;
+    std::vector<std::unique_ptr<Node>> statements;
+    std::unique_ptr<Node> node;
+    while (nextStatement(parser, node)) {
+        constantFolder.fold(node);
+        resolver.resolve(node);
+        statements.push_back(std::move(node));
+    }
+    return statements;
+}
+
+void BM_Lex(benchmark::State& state, const std::string& source) {
+    const std::shared_ptr<const SourceBuffer> buffer = SourceBuffer::fromString(source);
+    for (auto _ : state) {
+        PositionHandler positionHandler("bench.vis", buffer);
+        benchmark::DoNotOptimize(Lexer(positionHandler).tokenise());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+
+void BM_Parse(benchmark::State& state, const std::string& source) {
+    const TokenStream tokenStream = lex(source);
+    NodeArena nodeArena;
+    NodeArena::Scope arenaScope(nodeArena);
+    const NodeArena::Mark emptyArena = nodeArena.getMark();
+    for (auto _ : state) {
+        state.PauseTiming();
+        Parser parser(tokenStream);
+        state.ResumeTiming();
+        std::unique_ptr<Node> node;
+        while (nextStatement(parser, node)) {benchmark::DoNotOptimize(node.get());}
+        node.reset();
+        nodeArena.rewind(emptyArena);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * tokenStream.size()));
+}
+
+void BM_TreeWalk(benchmark::State& state, const std::string& source) {
+    NodeArena nodeArena;
+    NodeArena::Scope arenaScope(nodeArena);
+    const std::vector<std::unique_ptr<Node>> statements = prepare(source);
+    SilenceOutput silence;
+    OutputBuffer output(std::cout);
+    OutputBuffer::Scope outputScope(&output);
+    for (auto _ : state) {
+        const std::unique_ptr<Context> globalContext = Context::makeGlobal("bench.vis");
+        for (const std::unique_ptr<Node>& statement : statements) {
+            benchmark::DoNotOptimize(Interpreter::evaluate(statement, globalContext.get()));
+        }
+    }
+}
+
+void BM_VM(benchmark::State& state, const std::string& source) {
+    NodeArena nodeArena;
+    NodeArena::Scope arenaScope(nodeArena);
+    const std::vector<std::unique_ptr<Node>> statements = prepare(source);
+    Chunk chunk;
+    Compiler compiler(chunk);
+    for (const std::unique_ptr<Node>& statement : statements) {compiler.compile(statement);}
+    SilenceOutput silence;
+    OutputBuffer output(std::cout);
+    OutputBuffer::Scope outputScope(&output);
+    for (auto _ : state) {
+        const std::unique_ptr<Context> globalContext = Context::makeGlobal("bench.vis");
+        VM vm(globalContext.get());
+        benchmark::DoNotOptimize(vm.run(chunk, 0)); // runs to the end of the chunk, so every statement at once
+    }
+}
+}
+
+BENCHMARK_CAPTURE(BM_Lex, fibonacci, fibonacciSource);
+BENCHMARK_CAPTURE(BM_Lex, fizzBuzz, fizzBuzzSource);
+BENCHMARK_CAPTURE(BM_Lex, stringConcat, stringConcatSource);
+BENCHMARK_CAPTURE(BM_Lex, deepNesting, deepNestingSource);
+
+BENCHMARK_CAPTURE(BM_Parse, fibonacci, fibonacciSource);
+BENCHMARK_CAPTURE(BM_Parse, fizzBuzz, fizzBuzzSource);
+BENCHMARK_CAPTURE(BM_Parse, stringConcat, stringConcatSource);
+BENCHMARK_CAPTURE(BM_Parse, deepNesting, deepNestingSource);
+
+BENCHMARK_CAPTURE(BM_TreeWalk, fibonacci, fibonacciSource)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_TreeWalk, fizzBuzz, fizzBuzzSource)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_TreeWalk, stringConcat, stringConcatSource)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_TreeWalk, deepNesting, deepNestingSource)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_VM, fibonacci, fibonacciSource)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_VM, fizzBuzz, fizzBuzzSource)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_VM, stringConcat, stringConcatSource)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_VM, deepNesting, deepNestingSource)->Unit(benchmark::kMillisecond);
+
+// reports as JSON unless another format is asked for, so runs can be diffed across commits
+int main(int argc, char** argv) {
+    std::vector<char*> arguments(argv, argv + argc);
+    bool formatGiven = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]).rfind("--benchmark_format", 0) == 0) {formatGiven = true;}
+    }
+    static char jsonFormat[] = "--benchmark_format=json";
+    if (!formatGiven) {arguments.push_back(jsonFormat);}
+    int argumentCount = static_cast<int>(arguments.size());
+    benchmark::Initialize(&argumentCount, arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(argumentCount, arguments.data())) {return 1;}
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// runs many independent scripts in one process on worker threads, each script gets its own global context,
+// node arena and captured output so nothing one script does is seen by another
+class BatchRunner {
+public:
+    struct Result {
+        std::string filename;
+        std::string output; // everything the script printed with out()
+        std::string error; // what stopped the script, empty when it ran to the end
+        double milliseconds = 0;
+    };
+    using ResultHandler = std::function<void(const Result& result)>;
+    explicit BatchRunner(unsigned jobs, bool treeWalk = false, std::string cacheDirectory = "");
+    // results come back in the order the scripts were given, onResult sees them in that order too,
+    // each one as soon as it and every script before it have finished
+    std::vector<Result> run(const std::vector<std::string>& scripts, const ResultHandler& onResult = nullptr) const;
+    [[nodiscard]] unsigned getJobs() const;
+
+    // the .vis files under a directory in path order, or the non blank lines of a list file
+    [[nodiscard]] static std::vector<std::string> collectScripts(const std::string& path);
+    static void printReport(std::ostream& os, const std::vector<Result>& results, double wallMilliseconds, unsigned jobs);
+private:
+    unsigned jobs;
+    bool treeWalk;
+    std::string cacheDirectory;
+    [[nodiscard]] Result runScript(const std::string& filename) const;
+};
+
+#endif //BATCH_RUNNER_H
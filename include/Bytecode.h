@@ -0,0 +1,94 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Literal.h"
+#include "Position.h"
+
+// defined instructions for the virtual machine
+enum class OpCode : std::uint8_t {
+    CONSTANT,
+    NULL_,
+    POP,
+    DUP,
+    GET_VAR,
+    SET_VAR,
+    INCREMENT_VAR,
+    DECREMENT_VAR,
+    GET_LOCAL,
+    SET_LOCAL,
+    INCREMENT_LOCAL,
+    DECREMENT_LOCAL,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    MODULO,
+    COMPARE_TE,
+    COMPARE_NE,
+    COMPARE_LT,
+    COMPARE_LTE,
+    COMPARE_GT,
+    COMPARE_GTE,
+    AND,
+    OR,
+    NEGATE,
+    NOT,
+    JUMP,
+    JUMP_IF_FALSE,
+    FOR_TEST,
+    FOR_STEP,
+    OUT_VALUE,
+    OUT_END,
+    FLUSH,
+    MAKE_FUNCTION,
+    CALL,
+    CALL_VALUE,
+    TAIL_CALL,
+    TAIL_CALL_VALUE,
+    RETURN,
+    RETURN_NULL,
+};
+
+std::string opCodeToStr(OpCode op);
+
+// single fixed width instruction, operand indexes into the owning chunk's tables or is a jump target
+// local instructions carry the slot as operand and the scope depth as count
+// counted loop instructions carry their jump target as operand, FOR_TEST's count is the comparison opcode
+// calls carry the callee's name as operand and the argument count as count, a tail call replaces the current frame
+struct Instruction {
+    OpCode op;
+    std::uint16_t count;
+    std::int32_t operand;
+};
+
+struct FunctionProto;
+
+// linear block of compiled code with its constant pool, name table and line table
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<Position> positions;
+    std::vector<Value> constants;
+    std::vector<std::string> names;
+    mutable std::vector<CallSiteCache> callSiteCaches; // one per name, every CALL in the chunk runs in the same scope
+    std::vector<std::shared_ptr<FunctionProto>> functions;
+    void printChunk(std::ostream& os, int tabCount, std::size_t codeStart = 0, std::size_t functionStart = 0) const;
+    friend std::ostream& operator<<(std::ostream& os, const Chunk& chunk);
+};
+
+// compiled function body shared by every FunctionLiteral made from the same definition
+struct FunctionProto {
+    std::string name;
+    std::shared_ptr<const std::vector<Token>> args;
+    std::shared_ptr<const std::vector<std::string>> locals;
+    std::shared_ptr<const std::vector<bool>> capturedSlots; // parallel to locals, null keeps every slot
+    std::int16_t selfSlot = -1; // local each call binds the function into, -1 for none
+    Position position;
+    Chunk chunk;
+};
+
+#endif //BYTECODE_H
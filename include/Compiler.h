@@ -0,0 +1,56 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Node.h"
+
+// compiles node trees produced by the parser into linear bytecode for the VM
+class Compiler {
+public:
+    // sizes of every table in the chunk, rewinding to a mark drops whatever was compiled after it
+    struct Mark {
+        std::size_t code;
+        std::size_t positions;
+        std::size_t constants;
+        std::size_t names;
+        std::size_t callSiteCaches;
+        std::size_t functions;
+    };
+    explicit Compiler(Chunk& chunk);
+    void compile(const std::unique_ptr<Node>& node);
+    void compileFunctionBody(const std::vector<std::unique_ptr<Node>>& bodyNodes);
+    [[nodiscard]] Mark getMark() const;
+    void rewind(const Mark& mark);
+private:
+    Chunk& chunk;
+    std::unordered_map<std::string, int> nameIndices; // chunk.names by name, a linear search made big files quadratic
+    void compileNode(const Node* node);
+    void compileBlock(const std::vector<std::unique_ptr<Node>>& nodes);
+    void compileNumberNode(const Number* node);
+    void compileStringNode(const StringNode* node);
+    void compileBinaryOpNode(const BinaryOperator* node);
+    void compileUnaryOpNode(const UnaryOperator* node);
+    void compileVarAccessNode(const VarAccess* node);
+    void compileVarAssignNode(const VarAssignment* node);
+    void compileVarIncrementNode(const VarIncrement* node);
+    void compileVarDecrementNode(const VarDecrement* node);
+    void compileLibCallNode(const LibCall* node);
+    void compileIfStmtNode(const IfStmt* node);
+    void compileWhileStmtNode(const WhileStmt* node);
+    void compileForStmtNode(const ForStmt* node);
+    void compileFuncDefNode(const FuncDef* node);
+    void compileFuncCallNode(const FuncCall* node, bool tailCall = false);
+    void compileReturnCallNode(const ReturnCall* node);
+    void emitVariable(const Node* node, OpCode globalOp, OpCode localOp);
+    int emit(OpCode op, const Position& pos, std::int32_t operand = 0, std::uint16_t count = 0);
+    void patchJump(int instructionIndex);
+    [[nodiscard]] int makeConstant(Value value);
+    [[nodiscard]] int makeName(const std::string& name);
+};
+
+#endif //COMPILER_H
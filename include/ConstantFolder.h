@@ -0,0 +1,32 @@
+#ifndef CONSTANT_FOLDER_H
+#define CONSTANT_FOLDER_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Node.h"
+#include "Value.h"
+
+// optimisation pass run between parsing and execution, folds constant expressions and prunes branches that never run
+class ConstantFolder {
+public:
+    std::size_t fold(std::unique_ptr<Node>& node); // returns how many nodes were removed from this tree
+    [[nodiscard]] std::size_t getRemovedCount() const;
+private:
+    std::size_t removedCount = 0;
+    void foldNode(std::unique_ptr<Node>& node);
+    void foldBlock(std::vector<std::unique_ptr<Node>>& nodes);
+    void foldArguments(std::vector<std::unique_ptr<Node>>& nodes);
+    void replaceWithLiteral(std::unique_ptr<Node>& node);
+    void discardBlock(std::vector<std::unique_ptr<Node>>& nodes);
+    [[nodiscard]] static bool isConstant(const Node* node);
+    [[nodiscard]] static std::optional<Value> evaluateConstant(const std::unique_ptr<Node>& node);
+    [[nodiscard]] static std::optional<bool> constantCondition(const std::unique_ptr<Node>& node);
+    [[nodiscard]] static std::unique_ptr<Node> makeLiteralNode(const Value& value, const Position& position);
+    [[nodiscard]] static std::size_t countNodes(const Node* node);
+    [[nodiscard]] static std::size_t countBlock(const std::vector<std::unique_ptr<Node>>& nodes);
+};
+
+#endif //CONSTANT_FOLDER_H
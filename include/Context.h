@@ -8,44 +8,82 @@
 #include <unordered_map>
 #include <memory>
 #include "lexer.h"
+#include "Node.h"
+#include "Value.h"
 
 
 class Literal; // decleration to allow use of context without circular loop
 
+// how the last statement run in a context finished, anything but Normal skips the rest of the enclosing blocks
+// a TailCall carries the callee as its value, the caller rebinds the frame to it instead of returning
+enum class Completion : std::uint8_t {Normal, Return, Break, Continue, TailCall};
+
 class SymbolTable {
 public:
-    SymbolTable(SymbolTable* parentTable = nullptr);
-    [[nodiscard]] const std::unordered_map<std::string, std::unique_ptr<Literal>>& getTable() const;
-    Literal* getLiteral(const std::string &name);
-    void set(const std::string& name, std::unique_ptr<Literal> value);
+    explicit SymbolTable(SymbolTable* parentTable = nullptr);
+    SymbolTable(const SymbolTable& other);
+    SymbolTable(SymbolTable&& other) noexcept;
+    SymbolTable& operator=(const SymbolTable& other);
+    SymbolTable& operator=(SymbolTable&& other) noexcept;
+    [[nodiscard]] const std::unordered_map<std::string, Value>& getTable() const;
+    [[nodiscard]] const Value& getValue(const std::string &name) const;
+    [[nodiscard]] const Value& getCachedValue(const std::string &name, CallSiteCache& cache) const;
+    [[nodiscard]] std::uint64_t getVersion() const;
+    [[nodiscard]] const Value* find(const std::string &name) const;
+    void set(const std::string& name, Value value);
+    void set(const std::string& name, std::unique_ptr<Literal> literal);
     void remove(const std::string &name);
     [[nodiscard]] std::unique_ptr<SymbolTable> clone() const;
     friend std::ostream& operator<<(std::ostream& os, const SymbolTable& table);
 private:
     SymbolTable* parentSymbolTable;
-    std::unordered_map<std::string, std::unique_ptr<Literal>> table;
+    std::unordered_map<std::string, Value> table;
+    std::uint64_t version; // unique per table, renewed whenever bindings are erased or replaced wholesale
+    static std::uint64_t nextVersion();
 };
 
 
 
-class Context {
+// frames made on the heap are shared, so a function defined in one keeps it alive after the call that made it returns
+class Context : public std::enable_shared_from_this<Context> {
 public:
     explicit Context(std::string displayName,
                 Context* parentContext = nullptr,
-                std::map<std::string, std::string> entryPos = PositionHandler::nullPos);
+                const Position& entryPos = PositionHandler::nullPos);
+    [[nodiscard]] static std::unique_ptr<Context> makeGlobal(std::string displayName); // null, true and false already bound
     [[nodiscard]] SymbolTable& getSymbolTable();
     void setSymbolTable(SymbolTable&& symbolTable);
     void setParentContext(Context* context);
     std::string getDisplayName();
-    std::map<std::string, std::string> getEntryPoint();
-    void setEntryPoint(const std::map<std::string, std::string> &pos);
+    Position getEntryPoint() const;
+    void setEntryPoint(const Position &pos);
+    void bindFrame(const Context& scope, const std::shared_ptr<const std::vector<std::string>>& names);
+    void initSlots(std::shared_ptr<const std::vector<std::string>> names);
+    [[nodiscard]] Value& getSlot(int slot);
+    [[nodiscard]] const std::string& getSlotName(int slot) const;
+    [[nodiscard]] Context* getAncestor(int depth);
+    [[nodiscard]] const Value& getResolved(const SlotRef& ref);
+    [[nodiscard]] const Value& lookup(const std::string& name) const;
+    void complete(Completion kind, Value value = Value());
+    [[nodiscard]] Completion getCompletion() const {return completion;}
+    [[nodiscard]] bool isInterrupted() const {return completion != Completion::Normal;}
+    Value takeCompletionValue();
+    [[nodiscard]] std::vector<Value>& getTailArguments();
+    void release(); // empties a finished frame before it goes back to a pool
+    static void releaseFrame(std::shared_ptr<Context>& frame, const std::vector<bool>* capturedSlots);
     [[nodiscard]] std::unique_ptr<Context> clone() const;
     friend std::ostream& operator<<(std::ostream& os, const Context& context);
 private:
     std::string diplayName;
     Context* parentContext;
-    std::map<std::string, std::string> entryPoint;
+    std::shared_ptr<Context> parentOwner; // set when the parent is a shared frame, null for the global context
+    Position entryPoint;
     SymbolTable symbolTable;
+    std::vector<Value> slots; // activation record for resolved locals, empty for the global context
+    std::shared_ptr<const std::vector<std::string>> slotNames;
+    Completion completion = Completion::Normal;
+    Value completionValue; // the returned value while completion is Return
+    std::vector<Value> tailArguments; // evaluated arguments of a pending tail call
 };
 
 
@@ -0,0 +1,57 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "Bytecode.h"
+#include "Context.h"
+#include "OutputBuffer.h"
+#include "Position.h"
+#include "Value.h"
+#include "VM.h"
+
+// source compiled once to bytecode, holds no syntax tree so it can outlive everything used to build it
+class Program {
+public:
+    Program(std::string name, Chunk chunk, std::shared_ptr<const SourceRegistration> source = nullptr);
+    [[nodiscard]] const std::string& getName() const;
+    [[nodiscard]] const Chunk& getChunk() const;
+private:
+    std::string name;
+    std::shared_ptr<const Chunk> chunk; // copies share the bytecode and its lookup caches
+    std::shared_ptr<const SourceRegistration> source; // the file its positions point into, released with the last copy
+};
+
+// entry point for hosts embedding the language, compiles programs and runs them as often as needed against
+// fresh globals or a context the host keeps between runs
+// an engine reuses one vm and one output buffer for every run, and a program's bytecode caches the lookups it makes,
+// so hosts running rules concurrently keep an engine per thread and compile the programs it runs on that thread
+class Engine {
+public:
+    struct Result {
+        Value value; // what the last top level statement evaluated to
+        std::string output; // everything printed with out(), nothing reaches stdout
+    };
+    Engine();
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+    [[nodiscard]] static Program compile(std::string_view source, const std::string& name = "<source>");
+    [[nodiscard]] static Program compileFile(const std::string& filename); // accepts .visc files from --compile too
+    [[nodiscard]] static std::unique_ptr<Context> makeContext(const std::string& name = "<engine>");
+
+    Result run(const Program& program); // against fresh globals dropped once the run ends
+    Result run(const Program& program, Context& globals); // globals keep whatever the program defines
+    // output printed before a run throws is discarded along with the run
+
+    static void setGlobal(Context& globals, const std::string& name, Value value);
+    [[nodiscard]] static const Value& getGlobal(Context& globals, const std::string& name); // throws if it is not defined
+private:
+    VM vm;
+    std::ostringstream captured;
+    OutputBuffer output;
+};
+
+#endif //ENGINE_H
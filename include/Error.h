@@ -46,5 +46,10 @@ class VisRunTimeError final : public Error {
     explicit VisRunTimeError(const std::string& message);
 };
 
+class ProgramFileError final : public Error {
+public:
+    explicit ProgramFileError(const std::string& message);
+};
+
 
 #endif // ERROR_H
@@ -0,0 +1,59 @@
+#ifndef EXECUTION_STATS_H
+#define EXECUTION_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "Bytecode.h"
+#include "Node.h"
+
+// counters and phase timings behind --stats, nothing is recorded unless a Scope has made an instance active
+class ExecutionStats {
+public:
+    enum class Phase : std::uint8_t {Read, Lex, Parse, Resolve, Compile, Execute};
+    static constexpr std::size_t phaseCount = static_cast<std::size_t>(Phase::Execute) + 1;
+    static constexpr std::size_t nodeTypeCount = static_cast<std::size_t>(NodeType::ReturnCall) + 1;
+    static constexpr std::size_t opCodeCount = static_cast<std::size_t>(OpCode::RETURN_NULL) + 1;
+
+    std::array<std::chrono::steady_clock::duration, phaseCount> phaseTimes{};
+    std::array<std::uint64_t, nodeTypeCount> nodeVisits{}; // filled by the tree walker
+    std::array<std::uint64_t, opCodeCount> instructions{}; // filled by the VM
+    std::uint64_t functionCalls = 0;
+    std::uint64_t symbolLookups = 0;
+    std::uint64_t symbolMisses = 0; // tables or call site caches searched without finding the name
+    std::uint64_t literalAllocations = 0;
+
+    void print(std::ostream& os, const std::string& title) const;
+    [[nodiscard]] static long peakResidentKilobytes(); // 0 where the platform cannot report it
+    [[nodiscard]] static ExecutionStats* getActive() {return active;}
+
+    // routes counters on this thread into an instance until the scope ends
+    class Scope {
+    public:
+        explicit Scope(ExecutionStats* stats);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        ExecutionStats* previous;
+    };
+
+    // charges the time since the previous lap to a phase, does nothing without an instance
+    class Stopwatch {
+    public:
+        explicit Stopwatch(ExecutionStats* stats);
+        void lap(Phase phase);
+    private:
+        ExecutionStats* stats;
+        std::chrono::steady_clock::time_point last;
+    };
+private:
+    static thread_local ExecutionStats* active;
+};
+
+std::string phaseToStr(ExecutionStats::Phase phase);
+
+#endif //EXECUTION_STATS_H
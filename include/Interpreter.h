@@ -5,42 +5,64 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <array>
+#include <iostream>
 #include <memory>
 
 #include "Node.h"
 #include "Context.h"
 
-void printTokens(const std::map<int, std::vector<Token>>& tokenMap);
-
-class ReturnSignal {
-public:
-    explicit ReturnSignal(std::unique_ptr<Literal> value);
-    std::unique_ptr<Literal> getValue();
-private:
-    std::unique_ptr<Literal> returnValue;
-};
+void printTokens(const TokenStream& tokenStream, std::ostream& os = std::cout);
 
 class Interpreter {
 public:
-    explicit Interpreter(const std::string &filename, bool verboseFlag);
-    static void interpretFile(const std::string &filename, bool verboseFlag);
+    explicit Interpreter(const std::string &filename, bool verboseFlag, bool treeWalkFlag = false, bool statsFlag = false,
+        bool profileFlag = false, const std::string& cacheDirectory = "");
+    static void interpretFile(const std::string &filename, bool verboseFlag, bool treeWalkFlag = false, bool statsFlag = false,
+        bool profileFlag = false, const std::string& cacheDirectory = "");
     static std::unique_ptr<Literal> visit(const std::unique_ptr<Node> &node, Context* context);
+    static Value evaluate(const std::unique_ptr<Node> &node, Context* context);
+    static void setInstrumented(bool instrumented); // swaps in visitors that report to the active ExecutionStats and Profiler on this thread
 private:
-    static std::unique_ptr<Literal> visitNumberNode(const Number* node, Context* context);
-    static std::unique_ptr<Literal> visitStringNode(const StringNode* node, Context* context);
-    static std::unique_ptr<Literal> visitBinaryOpNode(const BinaryOperator* node, Context* context);
-    static std::unique_ptr<Literal> visitUnaryOpNode(const UnaryOperator* node, Context* context);
-    static std::unique_ptr<Literal> visitVarAccessNode(const VarAccess* node, Context* context);
-    static std::unique_ptr<Literal> visitVarAssignNode(const VarAssignment* node, Context* context);
-    static std::unique_ptr<Literal> visitVarIncrementNode(const VarIncrement* node, Context* context);
-    static std::unique_ptr<Literal> visitVarDecrementNode(const VarDecrement* node, Context* context);
-    static std::unique_ptr<Literal> visitLibCallNode(const LibCall* node, Context* context);
-    static std::unique_ptr<Literal> visitIfStmtNode(const IfStmt* node, Context* context);
-    static std::unique_ptr<Literal> visitWhileStmtNode(const WhileStmt* node, Context* context);
-    static std::unique_ptr<Literal> visitForStmtNode(const ForStmt* node, Context* context);
-    static std::unique_ptr<Literal> visitFuncDefNode(const FuncDef* node, Context* context);
-    static std::unique_ptr<Literal> visitFuncCallNode(const FuncCall* node, Context* context);
-    static std::unique_ptr<Literal> visitReturnCallNode(const ReturnCall* node, Context* context);
+    using NodeVisitor = Value (*)(const Node* node, Context* context);
+    static constexpr std::size_t nodeTypeCount = static_cast<std::size_t>(NodeType::ReturnCall) + 1;
+    static_assert(nodeTypeCount == 17, "add a visitor to makeVisitors for every new NodeType");
+    static const std::array<NodeVisitor, nodeTypeCount> plainVisitors;
+    static const std::array<NodeVisitor, nodeTypeCount> instrumentedVisitors;
+    static thread_local const std::array<NodeVisitor, nodeTypeCount>* nodeVisitors;
+    template <bool Instrumented>
+    static constexpr std::array<NodeVisitor, nodeTypeCount> makeVisitors();
+    // the node type fixes the concrete class at construction so the downcast needs no runtime check
+    template <bool Instrumented, typename NodeClass, Value (*visitNode)(const NodeClass*, Context*)>
+    static Value dispatch(const Node* node, Context* context) {
+        if constexpr (Instrumented) {instrumentVisit(node);}
+        return visitNode(static_cast<const NodeClass*>(node), context);
+    }
+    static void instrumentVisit(const Node* node);
+    static Value visitUnknownNode(const Node* node, Context* context);
+    static Value visitNumberNode(const Number* node, Context* context);
+    static Value visitStringNode(const StringNode* node, Context* context);
+    static Value visitBinaryOpNode(const BinaryOperator* node, Context* context);
+    static Value visitUnaryOpNode(const UnaryOperator* node, Context* context);
+    static Value visitVarAccessNode(const VarAccess* node, Context* context);
+    static Value visitVarAssignNode(const VarAssignment* node, Context* context);
+    static Value visitVarIncrementNode(const VarIncrement* node, Context* context);
+    static Value visitVarDecrementNode(const VarDecrement* node, Context* context);
+    static Value visitLibCallNode(const LibCall* node, Context* context);
+    static Value visitIfStmtNode(const IfStmt* node, Context* context);
+    static Value visitWhileStmtNode(const WhileStmt* node, Context* context);
+    static Value visitForStmtNode(const ForStmt* node, Context* context);
+    static bool runCountedLoop(const ForStmt* node, const CountedLoop& loop, Context* context);
+    static Value visitFuncDefNode(const FuncDef* node, Context* context);
+    static Value visitFuncCallNode(const FuncCall* node, Context* context);
+    static Value findCallee(const FuncCall* node, Context* context);
+    static Value evaluateArgument(const std::unique_ptr<Node>& node, Context* context);
+    static void bindArgument(Context& callContext, const FunctionLiteral* funcLiteral, std::size_t index, Value value);
+    static Value visitReturnCallNode(const ReturnCall* node, Context* context);
+    static void executeBlock(const std::vector<std::unique_ptr<Node>>& nodes, Context* context);
+    static bool exitsLoop(Context* context);
+    static const Value& readVariable(const Node* node, Context* context);
+    static void writeVariable(const Node* node, Context* context, Value value);
 };
 
 
@@ -1,6 +1,7 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <map>
 #include <vector>
 #include <unordered_set>
 #include <string>
@@ -14,7 +15,7 @@ public:
     static const std::unordered_set<std::string> LIBWORDS;
     static const std::unordered_set<std::string> KEYWORDS;
     explicit Lexer(PositionHandler& positionHandler);
-    [[nodiscard]] std::map<int, std::vector<Token>> tokenise() const;
+    [[nodiscard]] TokenStream tokenise() const;
     ~Lexer() = default;
 private:
     static const std::string DIGITS;
@@ -5,34 +5,21 @@
 #ifndef LITERAL_H
 #define LITERAL_H
 
-#include <map>
 #include <memory>
+#include <string_view>
 #include "Node.h"
 # include "Context.h"
 class Context; // decleration to allow use of context without circular loop
+struct FunctionProto; // compiled body used by the VM, see Bytecode.h
 
 class Literal {
 public:
     Literal();
+    Literal(const Literal& other);
     void setContext(Context* context);
     [[nodiscard]] Context* getContext() const;
-    void setPosition(const std::map<std::string, std::string> &pos);
-    [[nodiscard]] std::map<std::string, std::string> getPosition() const;
-
-    [[nodiscard]] virtual std::unique_ptr<Literal> add(const Literal& other) const = 0;
-    [[nodiscard]] virtual std::unique_ptr<Literal> subtract(const Literal& other) const = 0;
-    [[nodiscard]] virtual std::unique_ptr<Literal> multiply(const Literal &other) const = 0;
-    [[nodiscard]] virtual std::unique_ptr<Literal> divide(const Literal& other) const = 0;
-    [[nodiscard]] virtual std::unique_ptr<Literal> modulo(const Literal& other) const = 0;
-    [[nodiscard]] virtual std::unique_ptr<Literal> compareTE(const Literal& other) const = 0;
-    [[nodiscard]] virtual std::unique_ptr<Literal> compareNE(const Literal& other) const = 0;
-    [[nodiscard]] virtual std::unique_ptr<Literal> compareLT(const Literal& other) const;
-    [[nodiscard]] virtual std::unique_ptr<Literal> compareLTE(const Literal& other) const;
-    [[nodiscard]] virtual std::unique_ptr<Literal> compareGT(const Literal& other) const;
-    [[nodiscard]] virtual std::unique_ptr<Literal> compareGTE(const Literal& other) const;
-    [[nodiscard]] virtual std::unique_ptr<Literal> andWith(const Literal& other) const;
-    [[nodiscard]] virtual std::unique_ptr<Literal> orWith(const Literal& other) const;
-    [[nodiscard]] virtual std::unique_ptr<Literal> notSelf() const;
+    void setPosition(const Position &pos);
+    [[nodiscard]] Position getPosition() const;
 
     [[nodiscard]] virtual double getNumberValue() const = 0;
     [[nodiscard]] virtual bool getBoolValue() const = 0;
@@ -43,7 +30,7 @@ public:
     virtual ~Literal() = default;
 protected:
     std::unique_ptr<Literal> setLiteral(std::unique_ptr<Literal> literal) const;
-    std::map<std::string, std::string> position;
+    Position position;
     Context* context;
 };
 
@@ -52,14 +39,6 @@ class BoolLiteral final : public Literal {
 public:
     explicit BoolLiteral(bool value);
 
-    [[nodiscard]] std::unique_ptr<Literal> add(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> subtract(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> multiply(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> divide(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> modulo(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareTE(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareNE(const Literal& other) const override;
-
     [[nodiscard]] double getNumberValue() const override;
     [[nodiscard]] bool getBoolValue() const override;
     [[nodiscard]] std::string getStringValue() const override;
@@ -71,25 +50,24 @@ private:
 };
 
 
+// immutable text kept in storage shared with every copy and every string built from it by appending,
+// each literal sees the first length bytes, so appending to the newest one writes into the storage in place
+// and repeated s = s + x costs the length of x rather than the length of s
 class StringLiteral final : public Literal {
 public:
-    explicit StringLiteral(const std::string &value);
-
-    [[nodiscard]] std::unique_ptr<Literal> add(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> subtract(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> multiply(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> divide(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> modulo(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareTE(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareNE(const Literal& other) const override;
+    explicit StringLiteral(std::string value);
 
     [[nodiscard]] double getNumberValue() const override;
     [[nodiscard]] bool getBoolValue() const override;
     [[nodiscard]] std::string getStringValue() const override;
+    [[nodiscard]] std::string_view getView() const; // no copy, unlike getStringValue, invalid once the storage grows
+    [[nodiscard]] std::shared_ptr<const StringLiteral> append(std::string_view tail) const;
     [[nodiscard]] std::unique_ptr<Literal> clone() const override;
     void printLiteral(std::ostream &os, int tabCount) const override;
 private:
-    std::string value;
+    StringLiteral(std::shared_ptr<std::string> storage, std::size_t length);
+    std::shared_ptr<std::string> storage;
+    std::size_t length;
 };
 
 
@@ -97,47 +75,38 @@ class NumberLiteral : public Literal{
 public:
     NumberLiteral();
 
-    [[nodiscard]] std::unique_ptr<Literal> add(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> subtract(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> multiply(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> divide(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> modulo(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareTE(const Literal& other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareNE(const Literal& other) const override;
-
     [[nodiscard]] double getNumberValue() const override = 0;
     [[nodiscard]] bool getBoolValue() const override = 0;
     [[nodiscard]] std::string getStringValue() const override = 0;
     [[nodiscard]] std::unique_ptr<Literal> clone() const override = 0;
     void printLiteral(std::ostream &os, int tabCount) const override;
-private:
-    static std::unique_ptr<NumberLiteral> makeResultLiteral(float value);
 };
 
 
 class IntLiteral final : public NumberLiteral{
 public:
-    explicit IntLiteral(int value);
+    explicit IntLiteral(std::int64_t value);
     [[nodiscard]] double getNumberValue() const override;
+    [[nodiscard]] std::int64_t getIntValue() const;
     [[nodiscard]] bool getBoolValue() const override;
     [[nodiscard]] std::string getStringValue() const override;
     [[nodiscard]] std::unique_ptr<Literal> clone() const override;
     void printLiteral(std::ostream &os, int tabCount) const override;
 private:
-    int value;
+    std::int64_t value;
 };
 
 
 class FloatLiteral final : public NumberLiteral{
 public:
-    explicit FloatLiteral(float value);
+    explicit FloatLiteral(double value);
     [[nodiscard]] double getNumberValue() const override;
     [[nodiscard]] bool getBoolValue() const override;
     [[nodiscard]] std::string getStringValue() const override;
     [[nodiscard]] std::unique_ptr<Literal> clone() const override;
     void printLiteral(std::ostream &os, int tabCount) const override;
 private:
-    float value;
+    double value;
 };
 
 
@@ -149,26 +118,40 @@ public:
         std::vector<std::unique_ptr<Node>> body,
         std::unique_ptr<Context> scope
         );
+    explicit FunctionLiteral(
+        std::string name,
+        std::shared_ptr<const std::vector<Token>> args,
+        std::shared_ptr<const std::vector<std::unique_ptr<Node>>> body,
+        std::unique_ptr<Context> scope
+        );
     [[nodiscard]] std::string getName() const;
     [[nodiscard]] const std::vector<Token>& getArgs() const;
     [[nodiscard]] const std::vector<std::unique_ptr<Node>>& getBody() const;
-    [[nodiscard]] std::unique_ptr<Literal> add(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> subtract(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> multiply(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> divide(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> modulo(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareTE(const Literal &other) const override;
-    [[nodiscard]] std::unique_ptr<Literal> compareNE(const Literal &other) const override;
     [[nodiscard]] double getNumberValue() const override;
     [[nodiscard]] bool getBoolValue() const override;
     [[nodiscard]] std::string getStringValue() const override;
     [[nodiscard]] const std::unique_ptr<Context>& getScopeContext() const;
+    void setCode(std::shared_ptr<const FunctionProto> proto);
+    [[nodiscard]] const std::shared_ptr<const FunctionProto>& getCode() const;
+    void setLocals(std::shared_ptr<const std::vector<std::string>> localNames);
+    [[nodiscard]] const std::shared_ptr<const std::vector<std::string>>& getLocals() const;
+    void setCapturedSlots(std::shared_ptr<const std::vector<bool>> slots);
+    [[nodiscard]] const std::shared_ptr<const std::vector<bool>>& getCapturedSlots() const;
+    void setSelfSlot(std::int16_t slot);
+    [[nodiscard]] std::int16_t getSelfSlot() const;
+    void setCapturesFrame(bool captures);
+    [[nodiscard]] bool capturesFrame() const; // the tree walker gives such calls a shared frame on the heap
     [[nodiscard]] std::unique_ptr<Literal> clone() const override;
     void printLiteral(std::ostream &os, int tabCount) const override;
 private:
     std::string name;
-    std::vector<Token> argTokens;
-    std::vector<std::unique_ptr<Node>> bodyNodes;
+    std::shared_ptr<const std::vector<Token>> argTokens; // immutable, shared between clones and definitions
+    std::shared_ptr<const std::vector<std::unique_ptr<Node>>> bodyNodes;
     std::unique_ptr<Context> scopeContext;
+    std::shared_ptr<const FunctionProto> code;
+    std::shared_ptr<const std::vector<std::string>> locals; // slot layout from the Resolver, null when unresolved
+    std::shared_ptr<const std::vector<bool>> capturedSlots; // slots kept once a closure escapes, null keeps them all
+    std::int16_t selfSlot = -1; // bound to the function on every call, -1 for none
+    bool framesCaptured = true;
 };
 #endif //LITERAL_H
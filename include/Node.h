@@ -1,11 +1,16 @@
 #ifndef NODE_H
 #define NODE_H
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include "Token.h"
 
-enum class NodeType {
+class ConstantFolder; // optimisation pass that rewrites node children in place
+class SymbolTable;
+class Value;
+
+enum class NodeType : std::uint8_t {
     EndOfFile,
     Number,
     String,
@@ -25,20 +30,61 @@ enum class NodeType {
     ReturnCall,
 };
 
+std::string nodeTypeToStr(NodeType type);
+
+// what a unary or binary node computes, read from its operator token once when the node is built
+enum class OperatorKind : std::uint8_t {
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    And,
+    Or,
+    Negate,
+    Not,
+};
+
+// lexical address set by the Resolver, depth counts enclosing functions and an unresolved ref is a global lookup
+struct SlotRef {
+    std::int16_t depth = -1;
+    std::int16_t slot = -1;
+    [[nodiscard]] bool isResolved() const {return depth >= 0;}
+};
+
+// inline cache for a call site resolved by name, points at the binding inside the table that owns it
+// rebinding the name updates that binding in place, the owner's version changes once the binding itself is released
+struct CallSiteCache {
+    const SymbolTable* owner = nullptr;
+    const Value* binding = nullptr;
+    std::uint64_t version = 0;
+};
+
 class Node {
 public:
     virtual ~Node() = default;
     explicit Node(const Token &token, NodeType type_);
-    [[nodiscard]] Token getToken() const;
+    static void* operator new(std::size_t size);
+    static void operator delete(void* pointer);
+    [[nodiscard]] const Token& getToken() const;
     [[nodiscard]] NodeType getType() const;
+    [[nodiscard]] const SlotRef& getSlotRef() const;
+    void setSlotRef(const SlotRef& ref);
     [[nodiscard]] virtual std::unique_ptr<Node> clone() const = 0;
     virtual void printNode(std::ostream& os, int tabCount) const;
 
     static std::vector<std::unique_ptr<Node>> cloneNodeVector(const std::vector<std::unique_ptr<Node>>& nodes);
     friend std::ostream& operator<<(std::ostream& os, const Node &node);
 protected:
-    std::vector<Token> tokenVector;
+    Token token;
     NodeType type;
+    SlotRef slotRef;
 };
 
 class EndOfFile final : public Node{
@@ -72,29 +118,30 @@ public:
 class UnaryOperator final : public Node{
 public:
     UnaryOperator(const Operator &operator_, std::unique_ptr<Node> node);
-    [[nodiscard]] std::vector<Token> getTokens() const;
-    [[nodiscard]] Operator getOperator() const;
+    [[nodiscard]] OperatorKind getOperatorKind() const;
     [[nodiscard]] const std::unique_ptr<Node>& getValue() const;
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
-    Operator operatorNode;
+    friend class ConstantFolder;
+    OperatorKind operatorKind; // the node's own token is the operator
     std::unique_ptr<Node> valueNode;
 };
 
 class BinaryOperator final : public Node{
 public:
     BinaryOperator(std::unique_ptr<Node> leftNode, const Operator &operatorNode, std::unique_ptr<Node> rightNode);
-    std::vector<Token> getTokens();
     [[nodiscard]] const std::unique_ptr<Node>& getLeftNode() const;
-    [[nodiscard]] Operator getOperatorNode() const;
+    [[nodiscard]] OperatorKind getOperatorKind() const;
     [[nodiscard]] const std::unique_ptr<Node>& getRightNode() const;
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
+    friend class ConstantFolder;
     std::unique_ptr<Node> leftNode;
-    Operator operatorNode;
     std::unique_ptr<Node> rightNode;
+    OperatorKind operatorKind;
+    Position operatorPos; // the node's own token is the left operand's, kept for printing
 };
 
 class VarAssignment final : public Node{
@@ -104,6 +151,7 @@ public:
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
+    friend class ConstantFolder;
     std::unique_ptr<Node> value;
 };
 
@@ -135,6 +183,7 @@ public:
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
+    friend class ConstantFolder;
     std::vector<std::unique_ptr<Node>> argumentNodes;
 };
 
@@ -151,6 +200,7 @@ public:
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
+    friend class ConstantFolder;
     std::unique_ptr<Node> comparison;
     std::vector<std::unique_ptr<Node>> ifBlockNodes;
     std::vector<std::unique_ptr<Node>> elseBlockNodes;
@@ -167,10 +217,19 @@ public:
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
+    friend class ConstantFolder;
     std::unique_ptr<Node> comparison;
     std::vector<std::unique_ptr<Node>> whileNodes;
 };
 
+// for (var i = start, i <op> bound, var i ++/--) whose body never assigns i or bound, runnable on a native counter
+struct CountedLoop {
+    bool counted = false;
+    OperatorKind comparison = OperatorKind::Less;
+    std::int8_t step = 1;
+    bool writesBack = false; // the body can observe the variable so it is updated before every iteration
+};
+
 class ForStmt final : public Node{
 public:
     explicit ForStmt(
@@ -183,13 +242,18 @@ public:
     [[nodiscard]] const std::unique_ptr<Node>& getCondition() const;
     [[nodiscard]] const std::unique_ptr<Node>& getStep() const;
     [[nodiscard]] const std::vector<std::unique_ptr<Node>>& getForBlock() const;
+    [[nodiscard]] const CountedLoop& getCountedLoop() const;
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
+    friend class ConstantFolder;
     std::unique_ptr<Node> varDeclare;
     std::unique_ptr<Node> condition;
     std::unique_ptr<Node> step;
     std::vector<std::unique_ptr<Node>> forNodes;
+    mutable CountedLoop countedLoop;
+    mutable bool loopAnalysed = false; // analysed on first use so constant folding has already run
+    [[nodiscard]] CountedLoop analyseCountedLoop() const;
 };
 
 class FuncDef final : public Node{
@@ -199,26 +263,46 @@ public:
         std::vector<Token> arguments,
         std::vector<std::unique_ptr<Node>> bodyNodes
         );
-    [[nodiscard]] std::string getName() const;
+    [[nodiscard]] const std::string& getName() const;
     [[nodiscard]] const std::vector<Token>& getArguments() const;
+    [[nodiscard]] const std::shared_ptr<const std::vector<Token>>& getSharedArguments() const;
     [[nodiscard]] const std::vector<std::unique_ptr<Node>>& getFunctionBody() const;
+    [[nodiscard]] const std::shared_ptr<const std::vector<std::unique_ptr<Node>>>& getSharedBody() const;
+    [[nodiscard]] const std::shared_ptr<const std::vector<std::string>>& getLocals() const;
+    void setLocals(std::shared_ptr<const std::vector<std::string>> localNames);
+    [[nodiscard]] const std::shared_ptr<const std::vector<bool>>& getCapturedSlots() const;
+    void setCapturedSlots(std::shared_ptr<const std::vector<bool>> slots);
+    [[nodiscard]] std::int16_t getSelfSlot() const;
+    void setSelfSlot(std::int16_t slot);
+    [[nodiscard]] bool definesFunctions() const;
+    void setDefinesFunctions(bool defines);
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
-    std::vector<Token> arguments;
-    std::vector<std::unique_ptr<Node>> bodyNodes;
+    friend class ConstantFolder;
+    std::shared_ptr<const std::vector<Token>> arguments; // shared with every FunctionLiteral made from this definition
+    std::shared_ptr<const std::vector<std::unique_ptr<Node>>> bodyNodes;
+    std::shared_ptr<const std::vector<std::string>> locals; // slot names, arguments first, null until resolved
+    std::shared_ptr<const std::vector<bool>> capturedSlots; // parallel to locals, the ones nested functions may read
+    std::int16_t selfSlot = -1; // local every call binds the function itself into, -1 when its body never reads its name
+    bool hasFunctionDefinitions = true; // assumed until the resolver has looked at the body
 };
 
 class FuncCall final : public Node{
 public:
     explicit FuncCall(const Token &token, std::vector<std::unique_ptr<Node>> argumentNodes);
-    [[nodiscard]] std::string getName() const;
+    [[nodiscard]] const std::string& getName() const;
     [[nodiscard]] const std::vector<std::unique_ptr<Node>>& getArguments() const;
+    [[nodiscard]] CallSiteCache& getCallSiteCache() const;
+    [[nodiscard]] bool isTailCall() const;
+    void setTailCall(bool tail);
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
-    std::string name;
+    friend class ConstantFolder;
     std::vector<std::unique_ptr<Node>> argumentNodes;
+    mutable CallSiteCache callSiteCache; // filled by the first call that looks the callee up by name
+    bool tailCall = false; // set by the Resolver when the call is the whole expression of a return and its frame can be reused
 };
 
 class ReturnCall final : public Node {
@@ -228,6 +312,7 @@ public:
     [[nodiscard]] std::unique_ptr<Node> clone() const override;
     void printNode(std::ostream &os, int tabCount) const override;
 private:
+    friend class ConstantFolder;
     std::unique_ptr<Node> expression;
 };
 
@@ -0,0 +1,51 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// bump allocator for AST nodes, nodes made while an arena is active are released together when it is destroyed
+class NodeArena {
+public:
+    static constexpr std::size_t alignment = alignof(void*);
+    struct Mark {
+        std::size_t blockCount;
+        std::size_t largeBlockCount;
+        std::size_t offset;
+        std::size_t bytesUsed;
+    };
+    explicit NodeArena(std::size_t blockSize = 64 * 1024);
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+    [[nodiscard]] void* allocate(std::size_t size);
+    [[nodiscard]] Mark getMark() const;
+    void rewind(const Mark& mark);
+    void adopt(NodeArena&& other); // takes over another arena's nodes, they are kept until this arena is destroyed
+    [[nodiscard]] std::size_t getBytesUsed() const;
+    [[nodiscard]] std::size_t getBlockCount() const;
+    [[nodiscard]] static NodeArena* getActive();
+
+    // routes node allocations on this thread into an arena until the scope ends
+    class Scope {
+    public:
+        explicit Scope(NodeArena& arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        NodeArena* previous;
+    };
+private:
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::vector<std::unique_ptr<std::byte[]>> largeBlocks;
+    std::vector<std::unique_ptr<std::byte[]>> adoptedBlocks; // never rewound
+    std::size_t blockSize;
+    std::size_t offset;
+    std::size_t capacity;
+    std::size_t bytesUsed;
+    std::size_t adoptedBytes;
+    static thread_local NodeArena* active;
+};
+
+#endif //NODE_ARENA_H
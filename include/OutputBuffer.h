@@ -0,0 +1,69 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+
+#include "Value.h"
+
+// collects everything out() prints and hands it to the target stream in large writes
+// the buffer is written out when it fills, when flush() is called from a script and when the owner is destroyed,
+// line buffered mode also writes out every completed line for interactive use
+class OutputBuffer {
+public:
+    static constexpr std::size_t defaultCapacity = 64 * 1024;
+    explicit OutputBuffer(std::ostream& target, bool lineBuffered = false, std::size_t capacity = defaultCapacity);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void write(std::string_view text);
+    void write(const Value& value); // formats numbers in place with std::to_chars
+    void endLine();
+    void flush();
+    [[nodiscard]] bool isLineBuffered() const {return lineBuffered;}
+    [[nodiscard]] std::size_t getBufferedSize() const {return size;}
+    [[nodiscard]] std::ostream& getStream() {return stream;} // formatted writes that share the buffer with out()
+
+    // the scope's buffer on this thread, or a line buffered one over std::cout when no scope is open
+    [[nodiscard]] static OutputBuffer& current();
+    [[nodiscard]] static bool isInteractive(); // true when stdout is a terminal
+
+    // routes out() on this thread into a buffer until the scope ends
+    class Scope {
+    public:
+        explicit Scope(OutputBuffer* output);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        OutputBuffer* previous;
+    };
+private:
+    static constexpr std::size_t numberSpace = 352; // widest fixed notation double, sign and six decimals
+    std::ostream* target;
+    bool lineBuffered;
+    std::size_t capacity;
+    std::size_t size = 0;
+    std::unique_ptr<char[]> buffer;
+    char* reserve(std::size_t length);
+    static thread_local OutputBuffer* active;
+
+    class StreamAdapter final : public std::streambuf {
+    public:
+        explicit StreamAdapter(OutputBuffer& output) : output(output) {}
+    protected:
+        int_type overflow(int_type character) override;
+        std::streamsize xsputn(const char* text, std::streamsize count) override;
+        int sync() override;
+    private:
+        OutputBuffer& output;
+    };
+    StreamAdapter streamAdapter{*this};
+    std::ostream stream{&streamAdapter};
+};
+
+#endif //OUTPUT_BUFFER_H
@@ -0,0 +1,60 @@
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Node.h"
+#include "NodeArena.h"
+#include "SourceBuffer.h"
+#include "Token.h"
+
+// front end for large files, the source is cut into pieces before top level func definitions and the pieces are
+// lexed and then parsed on worker threads, statements are handed back in source order like Parser::parse
+class ParallelParser {
+public:
+    static constexpr std::size_t minimumSourceSize = 1024 * 1024; // smaller files parse faster on one thread
+    static constexpr std::size_t minimumPieceSize = 128 * 1024;
+    struct Piece {
+        std::string_view text;
+        int firstLine;
+    };
+    // lexes every piece, rethrowing the first lexing error in source order like Lexer::tokenise would
+    ParallelParser(const std::string& fileName, std::shared_ptr<const SourceBuffer> source, unsigned threadCount,
+        std::size_t pieceSize = 0);
+    ParallelParser(std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source, unsigned threadCount,
+        std::size_t pieceSize = 0); // for a file the caller already put in the SourceTable
+    ParallelParser(const ParallelParser&) = delete;
+    ParallelParser& operator=(const ParallelParser&) = delete;
+    // the next top level statement, a piece's syntax error is only thrown once the statements before it are taken
+    std::unique_ptr<Node> parse();
+    [[nodiscard]] std::size_t getPieceCount() const;
+
+    // cuts at lines starting with func where braces and parentheses balance
+    [[nodiscard]] static std::vector<Piece> split(std::string_view text, std::size_t pieceSize);
+    [[nodiscard]] static unsigned chooseThreadCount(std::size_t sourceSize); // 1 when splitting would not pay off
+    [[nodiscard]] static int depthChange(std::string_view line);
+private:
+    struct PieceResult {
+        Piece piece;
+        TokenStream tokenStream;
+        std::unique_ptr<NodeArena> arena; // declared first so the statements are destroyed before it
+        std::vector<std::unique_ptr<Node>> statements;
+        std::exception_ptr error;
+    };
+    std::shared_ptr<const SourceBuffer> source;
+    std::uint32_t fileId;
+    unsigned threadCount;
+    std::vector<PieceResult> results;
+    bool parsed = false;
+    std::size_t pieceIndex = 0;
+    std::size_t statementIndex = 0;
+    void parsePieces();
+};
+
+#endif //PARALLEL_PARSER_H
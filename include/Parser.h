@@ -1,6 +1,7 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <map>
 #include <vector>
 #include <functional>
 #include <memory>
@@ -11,18 +12,20 @@
 
 class Parser {
 public:
-    explicit Parser(std::map<int, std::vector<Token>> tokenizedFile);
+    explicit Parser(TokenStream tokenStream);
     std::unique_ptr<Node> parse();
     ~Parser();
 private:
-    int lineIndex;
-    int tokenIndex;
-    std::map<int, std::vector<Token>> tokenDict;
-    std::vector<Token> tokenVector;
-    Token* currentToken;
+    std::size_t lineIndex;
+    std::size_t tokenIndex; // index into the whole stream, stays within [lineBegin, lineEnd]
+    std::size_t lineBegin;
+    std::size_t lineEnd;
+    TokenStream tokenStream;
+    const Token* currentToken;
     bool advanceLine();
-    Token* advanceToken();
-    [[nodiscard]] static InvalidSyntaxError makeSyntaxError(std::map<std::string, std::string> position,
+    const Token* advanceToken();
+    void releaseTokens();
+    [[nodiscard]] static InvalidSyntaxError makeSyntaxError(const Position &position,
                                                             const std::string &expectedType);
     std::unique_ptr<Node> binaryOperation(  const std::function<std::unique_ptr<Node>()> &func,
                                             const std::vector<TokenType> &tokenTypes,
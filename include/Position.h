@@ -0,0 +1,56 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SourceBuffer.h"
+
+// compact source position carried by every token, literal and context
+struct Position {
+    std::uint32_t fileId = 0;
+    std::int32_t line = -1;
+    std::int32_t charPos = -1;
+    friend bool operator==(const Position& left, const Position& right);
+    friend bool operator!=(const Position& left, const Position& right);
+};
+
+// per file line table of views into the source buffer, line text is only copied when an error message is formatted
+// shared by every thread, so each access takes the lock
+class SourceTable {
+public:
+    static std::uint32_t registerFile(const std::string& fileName, std::shared_ptr<const SourceBuffer> source = nullptr);
+    static void releaseFile(std::uint32_t fileId); // drops the entry, the next file registered may take its id
+    // adds source's lines to the end of a registered file, returns the line number the first of them gets
+    static int appendSource(std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source);
+    [[nodiscard]] static std::string getFileName(std::uint32_t fileId);
+    [[nodiscard]] static std::string getLineText(const Position& pos);
+private:
+    struct SourceFile {
+        std::string name;
+        std::vector<std::shared_ptr<const SourceBuffer>> sources; // keep the line views alive
+        std::vector<std::string_view> lines;
+    };
+    static void indexLines(const SourceBuffer& source, std::vector<std::string_view>& lines);
+    static std::vector<SourceFile> files;
+    static std::vector<std::uint32_t> releasedIds;
+    static std::mutex filesMutex;
+};
+
+// releases a file's SourceTable entry when destroyed, for owners that outlive every position pointing into the file
+class SourceRegistration {
+public:
+    explicit SourceRegistration(std::uint32_t fileId);
+    SourceRegistration(const SourceRegistration&) = delete;
+    SourceRegistration& operator=(const SourceRegistration&) = delete;
+    ~SourceRegistration();
+    [[nodiscard]] std::uint32_t getFileId() const;
+private:
+    std::uint32_t fileId;
+};
+
+#endif //POSITION_H
@@ -1,29 +1,45 @@
 #ifndef POSITION_HANDLER_H
 #define POSITION_HANDLER_H
 
-#include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include "Position.h"
+#include "SourceBuffer.h"
 
+// walks a source buffer line by line, lines and lexemes are handed out as views into the buffer
 class PositionHandler {
 public:
-    static const std::map<std::string, std::string> nullPos;
+    static const Position nullPos;
+    explicit PositionHandler(std::string fileName, std::shared_ptr<const SourceBuffer> source);
     explicit PositionHandler(std::string fileName, std::istream& file);
+    PositionHandler(std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source); // a whole file already in the SourceTable
+    // walks piece, a view into a file already in the SourceTable, numbering lines from firstLine
+    PositionHandler(std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source, std::string_view piece, int firstLine);
     char advanceCharacter();
     bool advanceLine();
     char peek() const;
     void resetPos();
-    [[nodiscard]] static std::string getWordFromLine(const std::map<std::string, std::string>& pos);
+    [[nodiscard]] static std::string getWordFromLine(const Position& pos);
     [[nodiscard]] char getChar() const;
     [[nodiscard]] int getLineNumber() const;
-    [[nodiscard]] std::map<std::string, std::string> getPos() const;
+    [[nodiscard]] Position getPos() const;
+    [[nodiscard]] std::string_view getLineSlice(int startPos) const;
+    [[nodiscard]] std::size_t getOffset() const;
+    [[nodiscard]] std::size_t getSourceSize() const;
 
 private:
-    std::istream& file;
+    std::shared_ptr<const SourceBuffer> source;
+    std::string_view text;
+    std::size_t lineStart;
+    std::size_t nextLineStart;
     int charPos;
     char currentChar;
     int line;
+    int firstLine;
+    std::uint32_t fileId;
     std::string fileName;
-    std::string lineText;
+    std::string_view lineText;
 };
 
 
@@ -0,0 +1,115 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Position.h"
+
+// attributes run time to VIS functions and source lines behind --profile
+// the engines tick once per node or instruction and only every sampleInterval ticks read the clock,
+// the time since the previous sample is charged to the call stack and line executing at that tick
+class Profiler {
+public:
+    static constexpr std::uint32_t defaultSampleInterval = 256;
+    explicit Profiler(std::string rootName, std::uint32_t sampleInterval = defaultSampleInterval);
+
+    void enter(const std::string& function, const Position& callSite);
+    void replace(const std::string& function); // a tail call reuses the caller's frame
+    void leave();
+    [[nodiscard]] bool tick() {return --countdown == 0;} // true when the caller should take a sample
+    void sample(const Position& pos);
+    void pause(); // charges the time so far, nothing is charged again until resume
+    void resume();
+
+    struct FunctionProfile {
+        std::string name;
+        std::uint64_t calls = 0;
+        std::chrono::nanoseconds inclusive{};
+        std::chrono::nanoseconds exclusive{};
+    };
+    struct LineProfile {
+        Position position;
+        std::chrono::nanoseconds inclusive{};
+        std::chrono::nanoseconds exclusive{};
+    };
+    [[nodiscard]] std::vector<FunctionProfile> getFunctionProfiles() const; // busiest first
+    [[nodiscard]] std::vector<LineProfile> getLineProfiles() const; // busiest first
+    void writeCollapsedStacks(std::ostream& os) const; // one "frame;frame;frame nanoseconds" line per stack
+    void print(std::ostream& os, const std::string& title) const;
+    [[nodiscard]] static Profiler* getActive() {return active;}
+
+    // routes ticks on this thread into a profiler until the scope ends
+    class Scope {
+    public:
+        explicit Scope(Profiler* profiler);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        Profiler* previous;
+    };
+
+    // enters a function for the lifetime of the guard, does nothing without a profiler
+    class Call {
+    public:
+        Call(Profiler* profiler, const std::string& function, const Position& callSite);
+        ~Call();
+        Call(const Call&) = delete;
+        Call& operator=(const Call&) = delete;
+    private:
+        Profiler* profiler;
+    };
+private:
+    static constexpr std::uint32_t noNode = UINT32_MAX;
+    struct Frame {
+        std::uint32_t function;
+        std::uint32_t fileId = 0;
+        std::int32_t line = -1;
+        std::uint32_t node = noNode; // call tree node for this frame, valid while line equals nodeLine
+        std::int32_t nodeLine = -1;
+    };
+    struct CallNode {
+        std::uint32_t parent;
+        std::uint32_t function;
+        Position position;
+        std::chrono::nanoseconds self{};
+    };
+    std::uint32_t sampleInterval;
+    std::uint32_t countdown;
+    bool running = false;
+    std::chrono::steady_clock::time_point last;
+    std::vector<Frame> frames;
+    std::vector<std::string> functionNames;
+    std::vector<std::uint64_t> functionCalls;
+    std::unordered_map<std::string, std::uint32_t> functionIds;
+    std::uint32_t lastFunction = 0;
+    struct ChildKey {
+        std::uint32_t parent;
+        std::uint32_t function;
+        std::int32_t line;
+        bool operator==(const ChildKey& other) const {
+            return parent == other.parent && function == other.function && line == other.line;
+        }
+    };
+    struct ChildKeyHash {
+        std::size_t operator()(const ChildKey& key) const {
+            return (static_cast<std::size_t>(key.parent) * 0x9E3779B97F4A7C15ULL) ^
+                (static_cast<std::size_t>(key.function) << 32) ^ static_cast<std::uint32_t>(key.line);
+        }
+    };
+    std::vector<CallNode> callTree;
+    std::unordered_map<ChildKey, std::uint32_t, ChildKeyHash> children;
+    std::uint32_t internFunction(const std::string& function);
+    std::uint32_t currentNode();
+    std::uint32_t childNode(std::uint32_t parent, const Frame& frame);
+    void charge();
+    static thread_local Profiler* active;
+};
+
+#endif //PROFILER_H
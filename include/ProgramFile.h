@@ -0,0 +1,33 @@
+#ifndef PROGRAM_FILE_H
+#define PROGRAM_FILE_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "Bytecode.h"
+#include "SourceBuffer.h"
+
+// whole file bytecode with its constant pools, name tables and line tables, written by --compile and the program
+// cache and run without lexing or parsing again
+// numbers are stored in native byte order, so program files are only meant for the machine that wrote them
+class ProgramFile {
+public:
+    static constexpr std::uint32_t formatVersion = 3; // bump whenever the compiler or this layout changes
+    [[nodiscard]] static bool isProgram(std::string_view bytes);
+    [[nodiscard]] static std::uint64_t hashBytes(std::string_view bytes); // 64 bit FNV-1a
+    [[nodiscard]] static Chunk compile(const std::string& filename); // lex, parse, fold, resolve and compile without running
+    // the file is only in the SourceTable while it compiles, positions in the chunk keep their lines but not the file
+    [[nodiscard]] static Chunk compile(const std::string& sourceName, std::shared_ptr<const SourceBuffer> source);
+    [[nodiscard]] static Chunk compile(std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source); // registered by the caller
+    static void write(std::ostream& os, const Chunk& chunk, std::uint64_t sourceHash, const std::string& sourceName);
+    static void save(const std::string& path, const Chunk& chunk, std::uint64_t sourceHash, const std::string& sourceName);
+    // expectedHash of 0 accepts a program compiled from any source, positions point into the caller's file fileId
+    [[nodiscard]] static Chunk read(std::string_view bytes, std::uint64_t expectedHash = 0, std::uint32_t fileId = 0);
+    [[nodiscard]] static std::string cachePath(const std::string& cacheDirectory, std::uint64_t sourceHash);
+    [[nodiscard]] static std::string defaultCacheDirectory(); // empty when there is nowhere to cache
+};
+
+#endif //PROGRAM_FILE_H
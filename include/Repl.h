@@ -0,0 +1,44 @@
+#ifndef REPL_H
+#define REPL_H
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "Bytecode.h"
+#include "Compiler.h"
+#include "Context.h"
+#include "NodeArena.h"
+#include "OutputBuffer.h"
+#include "Position.h"
+#include "VM.h"
+
+// interactive session over one global context, every complete input is compiled onto the end of a chunk that
+// grows for the whole session and run from where it starts, so variables and functions carry over between inputs
+class Repl {
+public:
+    Repl(std::ostream& os, std::ostream& errors);
+    Repl(const Repl&) = delete;
+    Repl& operator=(const Repl&) = delete;
+    void run(std::istream& is, bool prompts); // reads until the input ends
+    // takes one line, returns true while more lines are needed to finish the input it belongs to
+    bool addLine(const std::string& line);
+    void finish(); // runs an input still waiting for a possible else
+private:
+    std::ostream& errors;
+    OutputBuffer output;
+    SourceRegistration sourceFile; // every input is appended to one <repl> file, numbered on from the last
+    NodeArena nodeArena; // an input's nodes are dropped once it is compiled
+    std::unique_ptr<Context> globals;
+    Chunk chunk;
+    Compiler compiler;
+    VM vm;
+    std::string pending;
+    int depth = 0;
+    bool awaitingElse = false; // a finished if is held back a line in case an else follows
+    bool hasElse = false;
+    void execute(const std::string& source);
+};
+
+#endif //REPL_H
@@ -0,0 +1,45 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Node.h"
+
+// static scope pass run after parsing, gives every name used inside a function a (depth, slot) address
+class Resolver {
+public:
+    void resolve(const std::unique_ptr<Node>& node);
+    [[nodiscard]] bool definedFunctions() const; // whether the last statement resolved defines a function at any depth
+private:
+    // reads a function makes of its own name through the slot its definition writes in this scope
+    struct SelfReference {
+        FuncDef* function;
+        std::int16_t slot;
+        std::vector<Node*> nodes;
+    };
+    struct Scope {
+        FuncDef* function;
+        std::vector<std::string> names; // slot names, arguments first
+        std::vector<bool> captured; // slots a nested function may read
+        std::vector<int> writes; // statements writing each slot, an argument counts as one
+        std::vector<FuncCall*> tailCalls; // marked once the whole body is known not to define a closure
+        bool capturesFrame = false; // a nested function points at the frame so it cannot be reused
+        std::vector<SelfReference> selfReferences;
+    };
+    std::vector<Scope> scopes; // one per enclosing function, innermost last
+    bool functionsDefined = false;
+    void resolveNode(Node* node);
+    void resolveBlock(const std::vector<std::unique_ptr<Node>>& nodes);
+    void resolveFuncDef(FuncDef* node);
+    void resolveName(Node* node, const std::string& name);
+    [[nodiscard]] SlotRef lookup(const std::string& name) const;
+    void markCaptured(const std::string& name);
+    void addSelfReference(Node* node, const SlotRef& ref);
+    void bindSelfReferences(Scope& scope);
+    static void collectDeclarations(const Node* node, std::vector<std::string>& names);
+};
+
+#endif //RESOLVER_H
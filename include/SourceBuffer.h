@@ -0,0 +1,29 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// read only text of a whole source file, memory mapped when the file allows it and read into memory otherwise
+class SourceBuffer {
+public:
+    [[nodiscard]] static std::shared_ptr<const SourceBuffer> fromFile(const std::string& path);
+    [[nodiscard]] static std::shared_ptr<const SourceBuffer> fromStream(std::istream& stream);
+    [[nodiscard]] static std::shared_ptr<const SourceBuffer> fromString(std::string text);
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+    [[nodiscard]] std::string_view getText() const {return text;}
+    [[nodiscard]] std::size_t size() const {return text.size();}
+    [[nodiscard]] bool isMapped() const {return mapping != nullptr;}
+private:
+    SourceBuffer() = default;
+    std::string ownedText; // streaming fallback for pipes, stdin and in memory sources
+    void* mapping = nullptr;
+    std::size_t mappingSize = 0;
+    std::string_view text;
+};
+
+#endif //SOURCE_BUFFER_H
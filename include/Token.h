@@ -4,6 +4,8 @@
 #include <map>
 #include <string>
 #include <variant>
+#include <vector>
+#include "Position.h"
 
 // defined token types
 enum class TokenType {
@@ -36,17 +38,17 @@ enum class TokenType {
     GREATEREQUAL,
 };
 
-using ValueLiteral = std::variant<std::monostate, bool, int, float, std::string>;
+using ValueLiteral = std::variant<std::monostate, bool, int, double, std::string>;
 
 std::string tokenTypeToStr(TokenType type);
 
 // token class representing individual token
 class Token {
 public:
-    explicit Token(TokenType type_, const std::map<std::string, std::string>& pos, ValueLiteral  value_ = std::monostate{});
+    explicit Token(TokenType type_, const Position& pos, ValueLiteral  value_ = std::monostate{});
     [[nodiscard]] TokenType getType() const;
-    [[nodiscard]] ValueLiteral getValue() const;
-    [[nodiscard]] std::map<std::string, std::string> getPos() const;
+    [[nodiscard]] const ValueLiteral& getValue() const;
+    [[nodiscard]] Position getPos() const;
     [[nodiscard]] bool matches(TokenType type_, const std::string &value_) const;
     [[nodiscard]] Token clone() const;
     // overload the << operator to easily print tokens
@@ -54,7 +56,36 @@ public:
 private:
     TokenType type;
     ValueLiteral value;
-    std::map<std::string, std::string> position;
+    Position position;
+};
+
+// the tokens of one source line, a view into a TokenStream
+struct TokenLine {
+    const Token* first;
+    const Token* last;
+    [[nodiscard]] const Token* begin() const {return first;}
+    [[nodiscard]] const Token* end() const {return last;}
+    [[nodiscard]] std::size_t size() const {return last - first;}
+    [[nodiscard]] bool empty() const {return first == last;}
+    const Token& operator[](const std::size_t index) const {return first[index];}
+};
+
+// every token of a file in one contiguous array, lineStarts holds the index of the first token of each line
+class TokenStream {
+public:
+    TokenStream() = default;
+    TokenStream(const std::map<int, std::vector<Token>>& lines); // NOLINT(*-explicit-constructor) hand written token lines
+    void beginLine();
+    void push(Token token);
+    [[nodiscard]] std::size_t lineCount() const;
+    [[nodiscard]] std::size_t lineStart(std::size_t line) const;
+    [[nodiscard]] std::size_t lineEnd(std::size_t line) const;
+    [[nodiscard]] TokenLine getLine(std::size_t line) const;
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] const Token& operator[](std::size_t index) const;
+private:
+    std::vector<Token> tokens;
+    std::vector<std::size_t> lineStarts;
 };
 
 
@@ -0,0 +1,42 @@
+#ifndef VM_H
+#define VM_H
+
+#include <memory>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Context.h"
+
+// stack based virtual machine executing chunks produced by the Compiler
+class VM {
+public:
+    explicit VM(Context* globalContext);
+    Value run(const Chunk& chunk, std::size_t startIp);
+    void setGlobalContext(Context* context); // lets one vm and its pooled frames serve many global contexts in turn
+private:
+    // the instrumented build of the loop is only taken while an ExecutionStats or Profiler is active
+    template <bool Instrumented>
+    Value execute(const Chunk& chunk, std::size_t startIp);
+    struct CallFrame {
+        const Chunk* chunk;
+        const FunctionProto* function; // null for the top level frame
+        std::size_t ip;
+        std::size_t stackBase;
+        std::shared_ptr<Context> context; // null for the top level frame
+        bool captured; // a function defined in this frame shares its context so it cannot be reused
+    };
+    Context* globalContext;
+    std::vector<Value> stack;
+    std::vector<CallFrame> frames;
+    std::vector<std::shared_ptr<Context>> contextPool; // finished call frames kept for reuse
+    Value pop();
+    void push(Value value);
+    void makeFunction(const std::shared_ptr<FunctionProto>& proto, Context* context);
+    void callFunction(const Value& callee, const std::string& name, std::uint16_t argCount);
+    void tailCallFunction(CallFrame& frame, const Value& callee, const std::string& name, std::uint16_t argCount);
+    static const FunctionLiteral* checkCallee(const Value& callee, const std::string& name, std::uint16_t argCount);
+    std::shared_ptr<Context> acquireContext();
+    void bindArguments(Context& callContext, const FunctionLiteral* funcLiteral, std::uint16_t argCount);
+};
+
+#endif //VM_H
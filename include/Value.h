@@ -0,0 +1,78 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+class Literal; // decleration to allow use of value without circular loop
+class FunctionLiteral;
+
+enum class ValueType : std::uint8_t {
+    Null,
+    Bool,
+    Int,
+    Float,
+    String,
+    Function,
+};
+
+std::string valueTypeToStr(ValueType type);
+
+// by value evaluation result, numbers and booleans live inline and only strings and functions are boxed
+class Value {
+public:
+    Value();
+    explicit Value(bool value);
+    explicit Value(int value);
+    explicit Value(std::int64_t value);
+    explicit Value(double value);
+    explicit Value(std::shared_ptr<const Literal> literal);
+    static Value fromLiteral(std::unique_ptr<Literal> literal);
+    static Value fromString(std::string text);
+    [[nodiscard]] ValueType getType() const;
+    [[nodiscard]] bool isNull() const;
+    [[nodiscard]] double getNumberValue() const;
+    [[nodiscard]] std::int64_t getIntValue() const;
+    [[nodiscard]] bool getBoolValue() const;
+    [[nodiscard]] std::string getStringValue() const;
+    [[nodiscard]] std::string_view getStringView() const; // views a string value in place, empty for other types
+    [[nodiscard]] const FunctionLiteral* getFunction() const;
+    [[nodiscard]] long getShareCount() const; // values sharing this one's string or function, 0 when nothing is boxed
+    [[nodiscard]] std::unique_ptr<Literal> toLiteral() const;
+
+    [[nodiscard]] Value add(const Value& other) const;
+    [[nodiscard]] Value subtract(const Value& other) const;
+    [[nodiscard]] Value multiply(const Value& other) const;
+    [[nodiscard]] Value divide(const Value& other) const;
+    [[nodiscard]] Value modulo(const Value& other) const;
+    [[nodiscard]] Value compareTE(const Value& other) const;
+    [[nodiscard]] Value compareNE(const Value& other) const;
+    [[nodiscard]] Value compareLT(const Value& other) const;
+    [[nodiscard]] Value compareLTE(const Value& other) const;
+    [[nodiscard]] Value compareGT(const Value& other) const;
+    [[nodiscard]] Value compareGTE(const Value& other) const;
+    [[nodiscard]] Value andWith(const Value& other) const;
+    [[nodiscard]] Value orWith(const Value& other) const;
+    [[nodiscard]] Value notSelf() const;
+    [[nodiscard]] Value negate() const;
+
+    void printValue(std::ostream& os, int tabCount) const;
+    friend std::ostream& operator<<(std::ostream& os, const Value& value);
+private:
+    ValueType type;
+    union {
+        bool boolValue;
+        std::int64_t intValue;
+        double floatValue;
+    };
+    std::shared_ptr<const Literal> boxed;
+    [[nodiscard]] bool isIntegral() const;
+    [[nodiscard]] Value arithmetic(const Value& other, char op) const;
+    static Value integerArithmetic(std::int64_t left, std::int64_t right, char op);
+    static Value floatArithmetic(double left, double right, char op);
+};
+
+#endif //VALUE_H
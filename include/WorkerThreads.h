@@ -0,0 +1,24 @@
+#ifndef WORKER_THREADS_H
+#define WORKER_THREADS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// runs task(index) for every index below count on up to threadCount threads, the calling thread included
+// indices are handed out one at a time so uneven tasks still spread across the threads, task must not throw
+template <typename Task>
+void runOnThreads(const std::size_t count, const unsigned threadCount, const Task& task) {
+    std::atomic<std::size_t> next{0};
+    const auto worker = [&] {
+        for (std::size_t index = next++; index < count; index = next++) {task(index);}
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t extra = 1; extra < std::min<std::size_t>(threadCount, count); extra++) {threads.emplace_back(worker);}
+    worker();
+    for (std::thread& thread : threads) {thread.join();}
+}
+
+#endif //WORKER_THREADS_H
@@ -1,11 +1,28 @@
 set(PROJECT_SOURCES
+        ${PROJECT_SOURCE_DIR}/src/SourceBuffer.cpp
+        ${PROJECT_SOURCE_DIR}/src/Position.cpp
         ${PROJECT_SOURCE_DIR}/src/Token.cpp
         ${PROJECT_SOURCE_DIR}/src/Error.cpp
+        ${PROJECT_SOURCE_DIR}/src/ExecutionStats.cpp
+        ${PROJECT_SOURCE_DIR}/src/Profiler.cpp
         ${PROJECT_SOURCE_DIR}/src/Literal.cpp
+        ${PROJECT_SOURCE_DIR}/src/Value.cpp
+        ${PROJECT_SOURCE_DIR}/src/OutputBuffer.cpp
+        ${PROJECT_SOURCE_DIR}/src/NodeArena.cpp
         ${PROJECT_SOURCE_DIR}/src/Node.cpp
         ${PROJECT_SOURCE_DIR}/src/Context.cpp
         ${PROJECT_SOURCE_DIR}/src/PositionHandler.cpp
         ${PROJECT_SOURCE_DIR}/src/Lexer.cpp
         ${PROJECT_SOURCE_DIR}/src/Parser.cpp
+        ${PROJECT_SOURCE_DIR}/src/ParallelParser.cpp
+        ${PROJECT_SOURCE_DIR}/src/Resolver.cpp
+        ${PROJECT_SOURCE_DIR}/src/ConstantFolder.cpp
+        ${PROJECT_SOURCE_DIR}/src/Bytecode.cpp
+        ${PROJECT_SOURCE_DIR}/src/Compiler.cpp
+        ${PROJECT_SOURCE_DIR}/src/ProgramFile.cpp
+        ${PROJECT_SOURCE_DIR}/src/VM.cpp
         ${PROJECT_SOURCE_DIR}/src/Interpreter.cpp
+        ${PROJECT_SOURCE_DIR}/src/BatchRunner.cpp
+        ${PROJECT_SOURCE_DIR}/src/Engine.cpp
+        ${PROJECT_SOURCE_DIR}/src/Repl.cpp
 )
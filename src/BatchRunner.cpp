@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "BatchRunner.h"
+#include "Interpreter.h"
+#include "OutputBuffer.h"
+#include "WorkerThreads.h"
+
+BatchRunner::BatchRunner(const unsigned jobs, const bool treeWalk, std::string cacheDirectory) :
+jobs(jobs > 0 ? jobs : std::max(std::thread::hardware_concurrency(), 1u)),
+treeWalk(treeWalk),
+cacheDirectory(std::move(cacheDirectory)) {}
+
+// out() goes to this thread's buffer through the scope, so concurrent scripts never share a stream
+BatchRunner::Result BatchRunner::runScript(const std::string& filename) const {
+    Result result{filename, "", "", 0};
+    std::ostringstream captured;
+    const auto start = std::chrono::steady_clock::now();
+    {
+        OutputBuffer output(captured);
+        OutputBuffer::Scope outputScope(&output);
+        try {Interpreter::interpretFile(filename, false, treeWalk, false, false, cacheDirectory);}
+        catch (const std::exception& error) {result.error = error.what();}
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.output = captured.str();
+    return result;
+}
+
+std::vector<BatchRunner::Result> BatchRunner::run(const std::vector<std::string>& scripts, const ResultHandler& onResult) const {
+    std::vector<Result> results(scripts.size());
+    std::vector<bool> finished(scripts.size(), false);
+    std::size_t nextReported = 0;
+    std::mutex reportMutex;
+    runOnThreads(scripts.size(), jobs, [&](const std::size_t index) {
+        Result result = runScript(scripts[index]);
+        const std::lock_guard<std::mutex> lock(reportMutex);
+        results[index] = std::move(result);
+        finished[index] = true;
+        for (; nextReported < scripts.size() && finished[nextReported]; nextReported++) { // whoever completes the prefix reports it
+            if (onResult) {onResult(results[nextReported]);}
+        }
+    });
+    return results;
+}
+
+unsigned BatchRunner::getJobs() const {return jobs;}
+
+std::vector<std::string> BatchRunner::collectScripts(const std::string& path) {
+    std::vector<std::string> scripts;
+    if (std::filesystem::is_directory(path)) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".vis") {scripts.push_back(entry.path().string());}
+        }
+        std::sort(scripts.begin(), scripts.end());
+        return scripts;
+    }
+    std::ifstream list(path);
+    if (!list) {throw std::runtime_error("Error: Could not open file: " + path);}
+    for (std::string line; std::getline(list, line);) {
+        if (!line.empty() && line.back() == '\r') {line.pop_back();}
+        if (line.find_first_not_of(" \t") != std::string::npos) {scripts.push_back(line);}
+    }
+    return scripts;
+}
+
+void BatchRunner::printReport(std::ostream& os, const std::vector<Result>& results, const double wallMilliseconds,
+    const unsigned jobs) {
+    double scriptMilliseconds = 0;
+    std::size_t failed = 0;
+    const Result* slowest = nullptr;
+    for (const Result& result : results) {
+        scriptMilliseconds += result.milliseconds;
+        if (!result.error.empty()) {failed++;}
+        if (!slowest || result.milliseconds > slowest->milliseconds) {slowest = &result;}
+    }
+    std::ostringstream report;
+    report << "batch of " << results.size() << " scripts on " << jobs << " jobs" << std::endl << std::fixed << std::setprecision(3);
+    const auto row = [&report](const std::string& name, const auto& value) {
+        report << "  " << std::left << std::setw(24) << name << std::right << std::setw(14) << value << std::endl;
+    };
+    row("failed", failed);
+    row("wall (ms)", wallMilliseconds);
+    row("script total (ms)", scriptMilliseconds);
+    if (!results.empty()) {
+        row("mean script (ms)", scriptMilliseconds / static_cast<double>(results.size()));
+        row("slowest script (ms)", slowest->milliseconds);
+        report << "    " << slowest->filename << std::endl;
+    }
+    if (wallMilliseconds > 0) {row("scripts per second", static_cast<double>(results.size()) * 1000.0 / wallMilliseconds);}
+    os << report.str();
+}
@@ -0,0 +1,98 @@
+#include <iomanip>
+#include <iostream>
+
+#include "Bytecode.h"
+
+std::string opCodeToStr(const OpCode op) {
+    switch (op) {
+        case OpCode::CONSTANT: return "CONSTANT";
+        case OpCode::NULL_: return "NULL";
+        case OpCode::POP: return "POP";
+        case OpCode::DUP: return "DUP";
+        case OpCode::GET_VAR: return "GET_VAR";
+        case OpCode::SET_VAR: return "SET_VAR";
+        case OpCode::INCREMENT_VAR: return "INCREMENT_VAR";
+        case OpCode::DECREMENT_VAR: return "DECREMENT_VAR";
+        case OpCode::GET_LOCAL: return "GET_LOCAL";
+        case OpCode::SET_LOCAL: return "SET_LOCAL";
+        case OpCode::INCREMENT_LOCAL: return "INCREMENT_LOCAL";
+        case OpCode::DECREMENT_LOCAL: return "DECREMENT_LOCAL";
+        case OpCode::ADD: return "ADD";
+        case OpCode::SUBTRACT: return "SUBTRACT";
+        case OpCode::MULTIPLY: return "MULTIPLY";
+        case OpCode::DIVIDE: return "DIVIDE";
+        case OpCode::MODULO: return "MODULO";
+        case OpCode::COMPARE_TE: return "COMPARE_TE";
+        case OpCode::COMPARE_NE: return "COMPARE_NE";
+        case OpCode::COMPARE_LT: return "COMPARE_LT";
+        case OpCode::COMPARE_LTE: return "COMPARE_LTE";
+        case OpCode::COMPARE_GT: return "COMPARE_GT";
+        case OpCode::COMPARE_GTE: return "COMPARE_GTE";
+        case OpCode::AND: return "AND";
+        case OpCode::OR: return "OR";
+        case OpCode::NEGATE: return "NEGATE";
+        case OpCode::NOT: return "NOT";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::FOR_TEST: return "FOR_TEST";
+        case OpCode::FOR_STEP: return "FOR_STEP";
+        case OpCode::OUT_VALUE: return "OUT_VALUE";
+        case OpCode::OUT_END: return "OUT_END";
+        case OpCode::FLUSH: return "FLUSH";
+        case OpCode::MAKE_FUNCTION: return "MAKE_FUNCTION";
+        case OpCode::CALL: return "CALL";
+        case OpCode::CALL_VALUE: return "CALL_VALUE";
+        case OpCode::TAIL_CALL: return "TAIL_CALL";
+        case OpCode::TAIL_CALL_VALUE: return "TAIL_CALL_VALUE";
+        case OpCode::RETURN: return "RETURN";
+        case OpCode::RETURN_NULL: return "RETURN_NULL";
+        default: return "UNKNOWN";
+    }
+}
+
+void Chunk::printChunk(std::ostream &os, const int tabCount, const std::size_t codeStart,
+                        const std::size_t functionStart) const {
+    for (std::size_t i = codeStart; i < code.size(); i++) {
+        const Instruction& instruction = code[i];
+        os << std::string(tabCount, '\t') << std::setw(4) << std::setfill('0') << i << std::setfill(' ')
+        << " line " << positions[i].line + 1 << " | " << opCodeToStr(instruction.op);
+        switch (instruction.op) {
+            case OpCode::CONSTANT:
+                os << " " << instruction.operand << " (" << constants[instruction.operand].getStringValue() << ")";
+                break;
+            case OpCode::GET_VAR: case OpCode::SET_VAR: case OpCode::INCREMENT_VAR: case OpCode::DECREMENT_VAR:
+                os << " " << instruction.operand << " (" << names[instruction.operand] << ")";
+                break;
+            case OpCode::GET_LOCAL: case OpCode::SET_LOCAL: case OpCode::INCREMENT_LOCAL: case OpCode::DECREMENT_LOCAL:
+                os << " slot " << instruction.operand << " depth " << instruction.count;
+                break;
+            case OpCode::CALL: case OpCode::CALL_VALUE: case OpCode::TAIL_CALL: case OpCode::TAIL_CALL_VALUE:
+                os << " " << instruction.operand << " (" << names[instruction.operand] << ") args: " << instruction.count;
+                break;
+            case OpCode::JUMP: case OpCode::JUMP_IF_FALSE:
+                os << " -> " << instruction.operand;
+                break;
+            case OpCode::FOR_TEST:
+                os << " " << opCodeToStr(static_cast<OpCode>(instruction.count)) << " -> " << instruction.operand;
+                break;
+            case OpCode::FOR_STEP:
+                os << (instruction.count == 1 ? " +1" : " -1") << " -> " << instruction.operand;
+                break;
+            case OpCode::MAKE_FUNCTION:
+                os << " " << instruction.operand << " (" << functions[instruction.operand]->name << ")";
+                break;
+            default:
+                break;
+        }
+        os << std::endl;
+    }
+    for (std::size_t i = functionStart; i < functions.size(); i++) {
+        os << std::string(tabCount, '\t') << "Function<" << functions[i]->name << ">" << std::endl;
+        functions[i]->chunk.printChunk(os, tabCount+1);
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const Chunk& chunk) {
+    chunk.printChunk(os, 0);
+    return os;
+}
@@ -0,0 +1,298 @@
+#include "Compiler.h"
+#include "Error.h"
+
+Compiler::Compiler(Chunk& chunk) : chunk(chunk) {
+    for (std::size_t index = 0; index < chunk.names.size(); index++) {nameIndices.emplace(chunk.names[index], static_cast<int>(index));}
+}
+
+Compiler::Mark Compiler::getMark() const {
+    return Mark{chunk.code.size(), chunk.positions.size(), chunk.constants.size(), chunk.names.size(),
+        chunk.callSiteCaches.size(), chunk.functions.size()};
+}
+
+void Compiler::rewind(const Mark& mark) {
+    chunk.code.resize(mark.code);
+    chunk.positions.resize(mark.positions);
+    chunk.constants.resize(mark.constants);
+    for (std::size_t index = mark.names; index < chunk.names.size(); index++) {nameIndices.erase(chunk.names[index]);}
+    chunk.names.resize(mark.names);
+    chunk.callSiteCaches.resize(mark.callSiteCaches);
+    chunk.functions.resize(mark.functions);
+}
+
+// compiles a single top level statement leaving its result on the stack
+void Compiler::compile(const std::unique_ptr<Node>& node) {compileNode(node.get());}
+
+void Compiler::compileFunctionBody(const std::vector<std::unique_ptr<Node>>& bodyNodes) {
+    compileBlock(bodyNodes);
+    const Position pos = bodyNodes.empty() ? Position{} : bodyNodes.back()->getToken().getPos();
+    emit(OpCode::RETURN_NULL, pos);
+}
+
+void Compiler::compileNode(const Node* node) {
+    switch (node->getType()) {
+        case NodeType::Number:
+            return compileNumberNode(dynamic_cast<const Number*>(node));
+        case NodeType::String:
+            return compileStringNode(dynamic_cast<const StringNode*>(node));
+        case NodeType::BinaryOperator:
+            return compileBinaryOpNode(dynamic_cast<const BinaryOperator*>(node));
+        case NodeType::UnaryOperator:
+            return compileUnaryOpNode(dynamic_cast<const UnaryOperator*>(node));
+        case NodeType::VarAccess:
+            return compileVarAccessNode(dynamic_cast<const VarAccess*>(node));
+        case NodeType::VarAssgnment:
+            return compileVarAssignNode(dynamic_cast<const VarAssignment*>(node));
+        case NodeType::VarIncrement:
+            return compileVarIncrementNode(dynamic_cast<const VarIncrement*>(node));
+        case NodeType::VarDecrement:
+            return compileVarDecrementNode(dynamic_cast<const VarDecrement*>(node));
+        case NodeType::LibCall:
+            return compileLibCallNode(dynamic_cast<const LibCall*>(node));
+        case NodeType::IfStmt:
+            return compileIfStmtNode(dynamic_cast<const IfStmt*>(node));
+        case NodeType::WhileStmt:
+            return compileWhileStmtNode(dynamic_cast<const WhileStmt*>(node));
+        case NodeType::ForStmt:
+            return compileForStmtNode(dynamic_cast<const ForStmt*>(node));
+        case NodeType::FuncDef:
+            return compileFuncDefNode(dynamic_cast<const FuncDef*>(node));
+        case NodeType::FuncCall:
+            return compileFuncCallNode(dynamic_cast<const FuncCall*>(node));
+        case NodeType::ReturnCall:
+            return compileReturnCallNode(dynamic_cast<const ReturnCall*>(node));
+        default:
+            throw InterpretError("compile node method not defined");
+    }
+}
+
+// statements inside a block discard their result
+void Compiler::compileBlock(const std::vector<std::unique_ptr<Node>>& nodes) {
+    for (const std::unique_ptr<Node>& node : nodes) {
+        compileNode(node.get());
+        emit(OpCode::POP, node->getToken().getPos());
+    }
+}
+
+void Compiler::compileNumberNode(const Number* node) {
+    const Token& token = node->getToken();
+    Value number;
+    if (token.getType() == TokenType::INT) {
+        number = Value(std::get<int>(token.getValue()));
+    }
+    else if (token.getType() == TokenType::FLOAT) {
+        number = Value(std::get<double>(token.getValue()));
+    }
+    else {
+        throw VisRunTimeError("When compiling number node was provided token of type <" +
+            tokenTypeToStr(token.getType()) + "> instead of INT or FLOAT");
+    }
+    emit(OpCode::CONSTANT, token.getPos(), makeConstant(number));
+}
+
+void Compiler::compileStringNode(const StringNode* node) {
+    const Token& token = node->getToken();
+    auto stringLiteral = std::make_shared<StringLiteral>(std::get<std::string>(token.getValue()));
+    stringLiteral->setPosition(token.getPos());
+    emit(OpCode::CONSTANT, token.getPos(), makeConstant(Value(std::shared_ptr<const Literal>(std::move(stringLiteral)))));
+}
+
+void Compiler::compileBinaryOpNode(const BinaryOperator* node) {
+    compileNode(node->getLeftNode().get());
+    compileNode(node->getRightNode().get());
+    OpCode op;
+    switch (node->getOperatorKind()) {
+        case OperatorKind::Add: op = OpCode::ADD; break;
+        case OperatorKind::Subtract: op = OpCode::SUBTRACT; break;
+        case OperatorKind::Multiply: op = OpCode::MULTIPLY; break;
+        case OperatorKind::Divide: op = OpCode::DIVIDE; break;
+        case OperatorKind::Modulo: op = OpCode::MODULO; break;
+        case OperatorKind::Equal: op = OpCode::COMPARE_TE; break;
+        case OperatorKind::NotEqual: op = OpCode::COMPARE_NE; break;
+        case OperatorKind::Less: op = OpCode::COMPARE_LT; break;
+        case OperatorKind::LessEqual: op = OpCode::COMPARE_LTE; break;
+        case OperatorKind::Greater: op = OpCode::COMPARE_GT; break;
+        case OperatorKind::GreaterEqual: op = OpCode::COMPARE_GTE; break;
+        case OperatorKind::And: op = OpCode::AND; break;
+        case OperatorKind::Or: op = OpCode::OR; break;
+        default: throw InterpretError("binary operator not defined");
+    }
+    emit(op, node->getToken().getPos());
+}
+
+void Compiler::compileUnaryOpNode(const UnaryOperator* node) {
+    compileNode(node->getValue().get());
+    emit(node->getOperatorKind() == OperatorKind::Negate ? OpCode::NEGATE : OpCode::NOT, node->getToken().getPos());
+}
+
+void Compiler::compileVarAccessNode(const VarAccess* node) {
+    emitVariable(node, OpCode::GET_VAR, OpCode::GET_LOCAL);
+}
+
+void Compiler::compileVarAssignNode(const VarAssignment* node) {
+    compileNode(node->getValue().get());
+    emitVariable(node, OpCode::SET_VAR, OpCode::SET_LOCAL);
+}
+
+void Compiler::compileVarIncrementNode(const VarIncrement* node) {
+    emitVariable(node, OpCode::INCREMENT_VAR, OpCode::INCREMENT_LOCAL);
+}
+
+void Compiler::compileVarDecrementNode(const VarDecrement* node) {
+    emitVariable(node, OpCode::DECREMENT_VAR, OpCode::DECREMENT_LOCAL);
+}
+
+// each argument is printed as soon as it is evaluated to keep the tree walker's output order
+void Compiler::compileLibCallNode(const LibCall* node) {
+    const Token& token = node->getToken();
+    const std::string &libFunc = std::get<std::string>(token.getValue());
+    if (libFunc == "flush") {
+        if (!node->getArgumentNodes().empty()) {throw VisRunTimeError("flush takes no arguments");}
+        emit(OpCode::FLUSH, token.getPos());
+        return;
+    }
+    if (libFunc != "out") {throw VisRunTimeError("libCall was made to an unknown function: " + libFunc);}
+    for (const auto& argumentNode : node->getArgumentNodes()) {
+        compileNode(argumentNode.get());
+        emit(OpCode::OUT_VALUE, argumentNode->getToken().getPos());
+    }
+    emit(OpCode::OUT_END, token.getPos());
+}
+
+// the comparison result is left on the stack as the statement's value
+void Compiler::compileIfStmtNode(const IfStmt* node) {
+    const Position pos = node->getToken().getPos();
+    compileNode(node->getComparison().get());
+    emit(OpCode::DUP, pos);
+    const int elseJump = emit(OpCode::JUMP_IF_FALSE, pos);
+    compileBlock(node->getIfBlock());
+    const int endJump = emit(OpCode::JUMP, pos);
+    patchJump(elseJump);
+    compileBlock(node->getElseBlock());
+    patchJump(endJump);
+}
+
+// the condition is evaluated once up front for the statement's value, matching the tree walker
+void Compiler::compileWhileStmtNode(const WhileStmt* node) {
+    const Position pos = node->getToken().getPos();
+    compileNode(node->getComparison().get());
+    const int loopStart = static_cast<int>(chunk.code.size());
+    compileNode(node->getComparison().get());
+    const int exitJump = emit(OpCode::JUMP_IF_FALSE, pos);
+    compileBlock(node->getWhileBlock());
+    emit(OpCode::JUMP, pos, loopStart);
+    patchJump(exitJump);
+}
+
+// counted loops keep the bound and a native counter on the stack, the variable is only stored when it can be seen
+void Compiler::compileForStmtNode(const ForStmt* node) {
+    const Position pos = node->getToken().getPos();
+    compileNode(node->getVarDeclare().get());
+    emit(OpCode::POP, pos);
+    compileNode(node->getCondition().get());
+    if (const CountedLoop& loop = node->getCountedLoop(); loop.counted) {
+        const auto* condition = static_cast<const BinaryOperator*>(node->getCondition().get());
+        compileNode(condition->getRightNode().get());
+        compileNode(condition->getLeftNode().get());
+        OpCode comparison;
+        switch (loop.comparison) {
+            case OperatorKind::Less: comparison = OpCode::COMPARE_LT; break;
+            case OperatorKind::LessEqual: comparison = OpCode::COMPARE_LTE; break;
+            case OperatorKind::Greater: comparison = OpCode::COMPARE_GT; break;
+            case OperatorKind::GreaterEqual: comparison = OpCode::COMPARE_GTE; break;
+            default: comparison = OpCode::COMPARE_NE; break;
+        }
+        const int loopStart = static_cast<int>(chunk.code.size());
+        const int exitJump = emit(OpCode::FOR_TEST, pos, 0, static_cast<std::uint16_t>(comparison));
+        if (loop.writesBack) {emitVariable(node->getVarDeclare().get(), OpCode::SET_VAR, OpCode::SET_LOCAL);}
+        compileBlock(node->getForBlock());
+        emit(OpCode::FOR_STEP, pos, loopStart, loop.step > 0 ? 1 : 0);
+        patchJump(exitJump);
+        emitVariable(node->getVarDeclare().get(), OpCode::SET_VAR, OpCode::SET_LOCAL);
+        emit(OpCode::POP, pos);
+        emit(OpCode::POP, pos);
+        return;
+    }
+    const int loopStart = static_cast<int>(chunk.code.size());
+    compileNode(node->getCondition().get());
+    const int exitJump = emit(OpCode::JUMP_IF_FALSE, pos);
+    compileBlock(node->getForBlock());
+    compileNode(node->getStep().get());
+    emit(OpCode::POP, pos);
+    emit(OpCode::JUMP, pos, loopStart);
+    patchJump(exitJump);
+}
+
+void Compiler::compileFuncDefNode(const FuncDef* node) {
+    auto proto = std::make_shared<FunctionProto>();
+    proto->name = node->getName();
+    proto->position = node->getToken().getPos();
+    proto->locals = node->getLocals();
+    proto->capturedSlots = node->getCapturedSlots();
+    proto->selfSlot = node->getSelfSlot();
+    proto->args = node->getSharedArguments();
+    Compiler(proto->chunk).compileFunctionBody(node->getFunctionBody());
+    chunk.functions.push_back(std::move(proto));
+    emit(OpCode::MAKE_FUNCTION, node->getToken().getPos(), static_cast<int>(chunk.functions.size() - 1));
+    emitVariable(node, OpCode::SET_VAR, OpCode::SET_LOCAL);
+}
+
+// a callee held in a local slot is pushed after the arguments and called from the stack
+void Compiler::compileFuncCallNode(const FuncCall* node, const bool tailCall) {
+    for (const auto& argumentNode : node->getArguments()) {compileNode(argumentNode.get());}
+    const auto argCount = static_cast<std::uint16_t>(node->getArguments().size());
+    if (node->getSlotRef().isResolved()) {
+        emitVariable(node, OpCode::GET_VAR, OpCode::GET_LOCAL);
+        emit(tailCall ? OpCode::TAIL_CALL_VALUE : OpCode::CALL_VALUE, node->getToken().getPos(), makeName(node->getName()), argCount);
+    }
+    else {
+        emit(tailCall ? OpCode::TAIL_CALL : OpCode::CALL, node->getToken().getPos(), makeName(node->getName()), argCount);
+    }
+}
+
+// a tail call needs no RETURN, the callee takes over this frame and returns straight to its caller
+void Compiler::compileReturnCallNode(const ReturnCall* node) {
+    if (const Node* expression = node->getExpression().get(); expression && expression->getType() == NodeType::FuncCall) {
+        if (const auto* callNode = static_cast<const FuncCall*>(expression); callNode->isTailCall()) {
+            return compileFuncCallNode(callNode, true);
+        }
+    }
+    if (node->getExpression()) {compileNode(node->getExpression().get());}
+    else {emit(OpCode::NULL_, node->getToken().getPos());}
+    emit(OpCode::RETURN, node->getToken().getPos());
+}
+
+int Compiler::emit(const OpCode op, const Position& pos, const std::int32_t operand, const std::uint16_t count) {
+    chunk.code.push_back(Instruction{op, count, operand});
+    chunk.positions.push_back(pos);
+    return static_cast<int>(chunk.code.size() - 1);
+}
+
+// resolved names address their slot directly, anything else is looked up by name at run time
+void Compiler::emitVariable(const Node* node, const OpCode globalOp, const OpCode localOp) {
+    const Token& token = node->getToken();
+    if (const SlotRef& ref = node->getSlotRef(); ref.isResolved()) {
+        emit(localOp, token.getPos(), ref.slot, static_cast<std::uint16_t>(ref.depth));
+    }
+    else {
+        emit(globalOp, token.getPos(), makeName(std::get<std::string>(token.getValue())));
+    }
+}
+
+// point a previously emitted jump at the next instruction to be emitted
+void Compiler::patchJump(const int instructionIndex) {
+    chunk.code[instructionIndex].operand = static_cast<std::int32_t>(chunk.code.size());
+}
+
+int Compiler::makeConstant(Value value) {
+    chunk.constants.push_back(std::move(value));
+    return static_cast<int>(chunk.constants.size() - 1);
+}
+
+int Compiler::makeName(const std::string& name) {
+    const auto [it, inserted] = nameIndices.emplace(name, static_cast<int>(chunk.names.size()));
+    if (!inserted) {return it->second;}
+    chunk.names.push_back(name);
+    chunk.callSiteCaches.emplace_back();
+    return static_cast<int>(chunk.names.size() - 1);
+}
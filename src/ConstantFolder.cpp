@@ -0,0 +1,210 @@
+#include <cstdint>
+#include <limits>
+
+#include "ConstantFolder.h"
+#include "Error.h"
+#include "Interpreter.h"
+
+// folds a single top level statement, a constant top level if keeps its node and only loses the branch it never takes
+std::size_t ConstantFolder::fold(std::unique_ptr<Node>& node) {
+    const std::size_t removedBefore = removedCount;
+    foldNode(node);
+    return removedCount - removedBefore;
+}
+
+std::size_t ConstantFolder::getRemovedCount() const {return removedCount;}
+
+void ConstantFolder::foldNode(std::unique_ptr<Node>& node) {
+    if (!node) {return;}
+    switch (node->getType()) {
+        case NodeType::UnaryOperator:
+            foldNode(static_cast<UnaryOperator*>(node.get())->valueNode);
+            return replaceWithLiteral(node);
+        case NodeType::BinaryOperator: {
+            auto* binaryNode = static_cast<BinaryOperator*>(node.get());
+            foldNode(binaryNode->leftNode);
+            foldNode(binaryNode->rightNode);
+            return replaceWithLiteral(node);
+        }
+        case NodeType::VarAssgnment:
+            return foldNode(static_cast<VarAssignment*>(node.get())->value);
+        case NodeType::LibCall:
+            return foldArguments(static_cast<LibCall*>(node.get())->argumentNodes);
+        case NodeType::FuncCall:
+            return foldArguments(static_cast<FuncCall*>(node.get())->argumentNodes);
+        case NodeType::ReturnCall:
+            return foldNode(static_cast<ReturnCall*>(node.get())->expression);
+        case NodeType::IfStmt: {
+            auto* ifNode = static_cast<IfStmt*>(node.get());
+            foldNode(ifNode->comparison);
+            if (const std::optional<bool> condition = constantCondition(ifNode->comparison)) {
+                discardBlock(*condition ? ifNode->elseBlockNodes : ifNode->ifBlockNodes);
+            }
+            foldBlock(ifNode->ifBlockNodes);
+            return foldBlock(ifNode->elseBlockNodes);
+        }
+        case NodeType::WhileStmt: {
+            auto* whileNode = static_cast<WhileStmt*>(node.get());
+            foldNode(whileNode->comparison);
+            if (const std::optional<bool> condition = constantCondition(whileNode->comparison); condition && !*condition) {
+                return discardBlock(whileNode->whileNodes);
+            }
+            return foldBlock(whileNode->whileNodes);
+        }
+        case NodeType::ForStmt: {
+            auto* forNode = static_cast<ForStmt*>(node.get());
+            foldNode(forNode->varDeclare);
+            foldNode(forNode->condition);
+            foldNode(forNode->step);
+            return foldBlock(forNode->forNodes);
+        }
+        case NodeType::FuncDef: {
+            const auto* funcDef = static_cast<FuncDef*>(node.get());
+            if (funcDef->bodyNodes.use_count() == 1) { // nothing has captured the body yet so it can still be rewritten
+                foldBlock(const_cast<std::vector<std::unique_ptr<Node>>&>(*funcDef->bodyNodes));
+            }
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+// a constant if inside a block is replaced by the statements of the branch it takes, a loop that never runs is dropped
+void ConstantFolder::foldBlock(std::vector<std::unique_ptr<Node>>& nodes) {
+    std::vector<std::unique_ptr<Node>> folded;
+    folded.reserve(nodes.size());
+    for (std::unique_ptr<Node>& node : nodes) {
+        foldNode(node);
+        if (node->getType() == NodeType::IfStmt) {
+            auto* ifNode = static_cast<IfStmt*>(node.get());
+            if (const std::optional<bool> condition = constantCondition(ifNode->comparison)) {
+                removedCount += 1 + countNodes(ifNode->comparison.get());
+                for (std::unique_ptr<Node>& takenNode : *condition ? ifNode->ifBlockNodes : ifNode->elseBlockNodes) {
+                    folded.push_back(std::move(takenNode));
+                }
+                continue;
+            }
+        }
+        else if (node->getType() == NodeType::WhileStmt) {
+            const auto* whileNode = static_cast<WhileStmt*>(node.get());
+            if (const std::optional<bool> condition = constantCondition(whileNode->comparison); condition && !*condition) {
+                removedCount += countNodes(node.get());
+                continue;
+            }
+        }
+        folded.push_back(std::move(node));
+    }
+    nodes = std::move(folded);
+}
+
+void ConstantFolder::foldArguments(std::vector<std::unique_ptr<Node>>& nodes) {
+    for (std::unique_ptr<Node>& node : nodes) {foldNode(node);}
+}
+
+// results that have no literal node or that raise an error are left to be evaluated at run time
+void ConstantFolder::replaceWithLiteral(std::unique_ptr<Node>& node) {
+    if (!isConstant(node.get())) {return;}
+    const std::optional<Value> value = evaluateConstant(node);
+    if (!value) {return;}
+    std::unique_ptr<Node> literal = makeLiteralNode(*value, node->getToken().getPos());
+    if (!literal) {return;}
+    removedCount += countNodes(node.get()) - 1;
+    node = std::move(literal);
+}
+
+void ConstantFolder::discardBlock(std::vector<std::unique_ptr<Node>>& nodes) {
+    removedCount += countBlock(nodes);
+    nodes.clear();
+}
+
+bool ConstantFolder::isConstant(const Node* node) {
+    switch (node->getType()) {
+        case NodeType::Number: case NodeType::String:
+            return true;
+        case NodeType::UnaryOperator:
+            return isConstant(static_cast<const UnaryOperator*>(node)->getValue().get());
+        case NodeType::BinaryOperator: {
+            const auto* binaryNode = static_cast<const BinaryOperator*>(node);
+            return isConstant(binaryNode->getLeftNode().get()) && isConstant(binaryNode->getRightNode().get());
+        }
+        default:
+            return false;
+    }
+}
+
+// evaluated with the tree walker so folded results match run time exactly, constant subtrees never touch the context
+std::optional<Value> ConstantFolder::evaluateConstant(const std::unique_ptr<Node>& node) {
+    try {return Interpreter::evaluate(node, nullptr);}
+    catch (const Error&) {return std::nullopt;}
+}
+
+std::optional<bool> ConstantFolder::constantCondition(const std::unique_ptr<Node>& node) {
+    if (!isConstant(node.get())) {return std::nullopt;}
+    const std::optional<Value> value = evaluateConstant(node);
+    if (!value) {return std::nullopt;}
+    try {return value->getBoolValue();}
+    catch (const Error&) {return std::nullopt;}
+}
+
+std::unique_ptr<Node> ConstantFolder::makeLiteralNode(const Value& value, const Position& position) {
+    switch (value.getType()) {
+        case ValueType::Int: {
+            const std::int64_t number = value.getIntValue();
+            if (number < std::numeric_limits<int>::min() || number > std::numeric_limits<int>::max()) {
+                return nullptr; // INT tokens only carry an int
+            }
+            return std::make_unique<Number>(Token(TokenType::INT, position, static_cast<int>(number)));
+        }
+        case ValueType::Float:
+            return std::make_unique<Number>(Token(TokenType::FLOAT, position, value.getNumberValue()));
+        case ValueType::String:
+            return std::make_unique<StringNode>(Token(TokenType::STRING, position, value.getStringValue()));
+        default:
+            return nullptr; // booleans have no literal node
+    }
+}
+
+std::size_t ConstantFolder::countNodes(const Node* node) {
+    if (!node) {return 0;}
+    switch (node->getType()) {
+        case NodeType::UnaryOperator:
+            return 1 + countNodes(static_cast<const UnaryOperator*>(node)->getValue().get());
+        case NodeType::BinaryOperator: {
+            const auto* binaryNode = static_cast<const BinaryOperator*>(node);
+            return 1 + countNodes(binaryNode->getLeftNode().get()) + countNodes(binaryNode->getRightNode().get());
+        }
+        case NodeType::VarAssgnment:
+            return 1 + countNodes(static_cast<const VarAssignment*>(node)->getValue().get());
+        case NodeType::LibCall:
+            return 1 + countBlock(static_cast<const LibCall*>(node)->getArgumentNodes());
+        case NodeType::FuncCall:
+            return 1 + countBlock(static_cast<const FuncCall*>(node)->getArguments());
+        case NodeType::ReturnCall:
+            return 1 + countNodes(static_cast<const ReturnCall*>(node)->getExpression().get());
+        case NodeType::IfStmt: {
+            const auto* ifNode = static_cast<const IfStmt*>(node);
+            return 1 + countNodes(ifNode->getComparison().get()) + countBlock(ifNode->getIfBlock()) +
+                countBlock(ifNode->getElseBlock());
+        }
+        case NodeType::WhileStmt: {
+            const auto* whileNode = static_cast<const WhileStmt*>(node);
+            return 1 + countNodes(whileNode->getComparison().get()) + countBlock(whileNode->getWhileBlock());
+        }
+        case NodeType::ForStmt: {
+            const auto* forNode = static_cast<const ForStmt*>(node);
+            return 1 + countNodes(forNode->getVarDeclare().get()) + countNodes(forNode->getCondition().get()) +
+                countNodes(forNode->getStep().get()) + countBlock(forNode->getForBlock());
+        }
+        case NodeType::FuncDef:
+            return 1 + countBlock(static_cast<const FuncDef*>(node)->getFunctionBody());
+        default:
+            return 1;
+    }
+}
+
+std::size_t ConstantFolder::countBlock(const std::vector<std::unique_ptr<Node>>& nodes) {
+    std::size_t count = 0;
+    for (const std::unique_ptr<Node>& node : nodes) {count += countNodes(node.get());}
+    return count;
+}
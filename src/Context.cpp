@@ -4,47 +4,112 @@
 
 #include "Context.h"
 
+#include <atomic>
 #include <ostream>
 #include <utility>
 #include "Error.h"
+#include "ExecutionStats.h"
 #include "Literal.h"
 
 
 //SYMBOL TABLE DEFINITION
-SymbolTable::SymbolTable(SymbolTable* parentTable) : parentSymbolTable(parentTable), table() {}
+SymbolTable::SymbolTable(SymbolTable* parentTable) : parentSymbolTable(parentTable), table(), version(nextVersion()) {}
 
-const std::unordered_map<std::string, std::unique_ptr<Literal>>& SymbolTable::getTable() const {return table;}
+// copies and moves take a fresh version so a cache can never match a table that reuses an old address
+SymbolTable::SymbolTable(const SymbolTable& other) :
+parentSymbolTable(other.parentSymbolTable), table(other.table), version(nextVersion()) {}
 
-Literal* SymbolTable::getLiteral(const std::string &name) {
-    if (const auto it = table.find(name); it != table.end()) {
-        return it->second.get();
+SymbolTable::SymbolTable(SymbolTable&& other) noexcept :
+parentSymbolTable(other.parentSymbolTable), table(std::move(other.table)), version(nextVersion()) {
+    other.version = nextVersion();
+}
+
+SymbolTable& SymbolTable::operator=(const SymbolTable& other) {
+    parentSymbolTable = other.parentSymbolTable;
+    table = other.table;
+    version = nextVersion();
+    return *this;
+}
+
+SymbolTable& SymbolTable::operator=(SymbolTable&& other) noexcept {
+    parentSymbolTable = other.parentSymbolTable;
+    table = std::move(other.table);
+    version = nextVersion();
+    other.version = nextVersion();
+    return *this;
+}
+
+std::uint64_t SymbolTable::nextVersion() {
+    static std::atomic<std::uint64_t> versionCounter{0};
+    return versionCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+std::uint64_t SymbolTable::getVersion() const {return version;}
+
+const std::unordered_map<std::string, Value>& SymbolTable::getTable() const {return table;}
+
+const Value& SymbolTable::getValue(const std::string &name) const {
+    ExecutionStats* stats = ExecutionStats::getActive();
+    if (stats) {stats->symbolLookups++;}
+    for (const SymbolTable* searched = this; searched; searched = searched->parentSymbolTable) {
+        if (const auto it = searched->table.find(name); it != searched->table.end()) {return it->second;}
+        if (stats) {stats->symbolMisses++;}
+    }
+    throw VisRunTimeError("symbol '" + name + "' was not found in lookup tables");
+}
+
+// a hit needs the owner to still hold the binding and every table searched before it to be empty
+const Value& SymbolTable::getCachedValue(const std::string &name, CallSiteCache& cache) const {
+    ExecutionStats* stats = ExecutionStats::getActive();
+    if (stats) {stats->symbolLookups++;}
+    if (cache.binding) {
+        const SymbolTable* searched = this;
+        while (searched && searched != cache.owner && searched->table.empty()) {searched = searched->parentSymbolTable;}
+        if (searched && searched == cache.owner && searched->version == cache.version) {return *cache.binding;}
     }
-    if (parentSymbolTable) {
-        return parentSymbolTable->getLiteral(name);
+    if (stats) {stats->symbolMisses++;} // the call site cache itself missed
+    for (const SymbolTable* searched = this; searched; searched = searched->parentSymbolTable) {
+        if (const auto it = searched->table.find(name); it != searched->table.end()) {
+            cache = CallSiteCache{searched, &it->second, searched->version};
+            return it->second;
+        }
+        if (stats) {stats->symbolMisses++;}
     }
     throw VisRunTimeError("symbol '" + name + "' was not found in lookup tables");
 }
 
-void SymbolTable::set(const std::string& name, std::unique_ptr<Literal> value) {
-    table[name] = std::move(value);
+const Value* SymbolTable::find(const std::string &name) const {
+    const auto it = table.find(name);
+    return it != table.end() ? &it->second : nullptr;
+}
+
+void SymbolTable::set(const std::string& name, Value value) {
+    if (const auto it = table.find(name); it != table.end()) {
+        it->second = std::move(value);
+        return;
+    }
+    table.emplace(name, std::move(value));
+}
+
+void SymbolTable::set(const std::string& name, std::unique_ptr<Literal> literal) {
+    set(name, Value::fromLiteral(std::move(literal)));
 }
 
-void SymbolTable::remove(const std::string& name) {table.erase(name);}
+void SymbolTable::remove(const std::string& name) {
+    if (table.erase(name) > 0) {version = nextVersion();}
+}
 
+// values are copied by value, boxed strings and functions are shared rather than deep cloned
 std::unique_ptr<SymbolTable> SymbolTable::clone() const {
     auto newTable = std::make_unique<SymbolTable>(parentSymbolTable);
-    for (const auto& [name, literalPtr] : table) {
-        if (literalPtr) {
-            newTable->set(name, literalPtr->clone());
-        }
-    }
+    newTable->table = table;
     return newTable;
 }
 
 std::ostream& operator<<(std::ostream& os, const SymbolTable& table) {
-    for (const auto& [name, literal] : table.table) {
+    for (const auto& [name, value] : table.table) {
         os << name << std::endl;
-        if (literal) os << *literal << std::endl << std::string(100, '-') << std::endl;
+        if (!value.isNull()) os << value << std::endl << std::string(100, '-') << std::endl;
         else os << "REFERENCE WAS NULL";
         os << "\n";
     }
@@ -54,31 +119,156 @@ std::ostream& operator<<(std::ostream& os, const SymbolTable& table) {
 
 
 //CONTEXT DEFINITION
-Context::Context(std::string displayName, Context* parentContext, std::map<std::string, std::string> entryPos) :
+Context::Context(std::string displayName, Context* parentContext, const Position& entryPos) :
 diplayName(std::move(displayName)),
 parentContext(parentContext),
-entryPoint(std::move(entryPos)),
+entryPoint(entryPos),
 symbolTable(SymbolTable()) {
 
 }
 
+std::unique_ptr<Context> Context::makeGlobal(std::string displayName) {
+    SymbolTable globalSymbolTable;
+    globalSymbolTable.set("null", std::make_unique<BoolLiteral>(false));
+    globalSymbolTable.set("true", std::make_unique<BoolLiteral>(true));
+    globalSymbolTable.set("false", std::make_unique<BoolLiteral>(false));
+    auto globalContext = std::make_unique<Context>(std::move(displayName));
+    globalContext->setSymbolTable(std::move(globalSymbolTable));
+    return globalContext;
+}
+
 SymbolTable& Context::getSymbolTable() {return symbolTable;}
 
 void Context::setSymbolTable(SymbolTable&& symbolTable) {this->symbolTable = std::move(symbolTable);}
 
-void Context::setParentContext(Context *context) {this->parentContext = context;}
+void Context::setParentContext(Context *context) {
+    this->parentContext = context;
+    parentOwner = context ? context->weak_from_this().lock() : nullptr;
+}
 
 std::string Context::getDisplayName() {return diplayName;}
 
-std::map<std::string, std::string> Context::getEntryPoint() {return entryPoint;}
+Position Context::getEntryPoint() const {return entryPoint;}
 
-void Context::setEntryPoint(const std::map<std::string, std::string> &pos) { entryPoint = pos;}
+void Context::setEntryPoint(const Position &pos) { entryPoint = pos;}
+
+// turns this context into the activation frame of a call made from scope, reusing any storage it already owns
+void Context::bindFrame(const Context& scope, const std::shared_ptr<const std::vector<std::string>>& names) {
+    diplayName = scope.diplayName;
+    parentContext = scope.parentContext;
+    parentOwner = scope.parentOwner;
+    entryPoint = scope.entryPoint;
+    symbolTable = scope.symbolTable;
+    completion = Completion::Normal;
+    if (names) {initSlots(names);}
+    else {
+        slots.clear();
+        slotNames.reset();
+    }
+}
+
+void Context::initSlots(std::shared_ptr<const std::vector<std::string>> names) {
+    slots.assign(names->size(), Value());
+    slotNames = std::move(names);
+}
+
+Value& Context::getSlot(const int slot) {return slots[slot];}
+
+const std::string& Context::getSlotName(const int slot) const {return (*slotNames)[slot];}
+
+// every frame holds its parent when the parent is shared, so the chain a closure walks outlives the calls that made it
+Context* Context::getAncestor(int depth) {
+    Context* context = this;
+    for (; depth > 0; depth--) {context = context->parentContext;}
+    return context;
+}
+
+// reads a resolved local, a slot that has not been written yet falls back to the enclosing scopes by name
+const Value& Context::getResolved(const SlotRef& ref) {
+    Context* owner = getAncestor(ref.depth);
+    const Value& value = owner->slots[ref.slot];
+    if (!value.isNull()) {return value;}
+    return owner->lookup(owner->getSlotName(ref.slot));
+}
+
+// dynamic lookup through the activation records and tables of every enclosing context
+const Value& Context::lookup(const std::string& name) const {
+    if (ExecutionStats* stats = ExecutionStats::getActive()) {stats->symbolLookups++;}
+    for (const Context* context = this; context; context = context->parentContext) {
+        if (context->slotNames) {
+            const std::vector<std::string>& names = *context->slotNames;
+            for (std::size_t i = names.size(); i-- > 0;) {
+                if (names[i] == name && !context->slots[i].isNull()) {return context->slots[i];}
+            }
+        }
+        if (const Value* value = context->symbolTable.find(name)) {return *value;}
+    }
+    return symbolTable.getValue(name);
+}
+
+// records an abrupt completion, the enclosing blocks stop early until the owner of the kind takes it
+void Context::complete(const Completion kind, Value value) {
+    completion = kind;
+    completionValue = std::move(value);
+}
+
+Value Context::takeCompletionValue() {
+    completion = Completion::Normal;
+    return std::move(completionValue);
+}
+
+std::vector<Value>& Context::getTailArguments() {return tailArguments;}
+
+void Context::release() {
+    parentOwner.reset();
+    slots.clear();
+    completionValue = Value();
+    tailArguments.clear();
+    if (!symbolTable.getTable().empty()) {symbolTable = SymbolTable();}
+}
+
+// a frame and the functions defined in it point at each other, when nothing outside the frame holds the frame or
+// one of those functions its values are dropped here so both can be freed, otherwise the closures keep it alive
+// with only the slots they may read, a closure calling itself reads its own frame rather than this one, so only
+// closures defined here that read one another through it still keep each other alive
+void Context::releaseFrame(std::shared_ptr<Context>& frame, const std::vector<bool>* capturedSlots) {
+    if (frame && frame.use_count() > 1) {
+        std::vector<std::pair<const Value*, long>> closures; // each defined here, with how many of the frame's values hold it
+        const auto collect = [&frame, &closures](const Value& value) {
+            const FunctionLiteral* funcLiteral = value.getFunction();
+            if (!funcLiteral || funcLiteral->getScopeContext()->parentContext != frame.get()) {return;}
+            for (auto& [closure, held] : closures) {
+                if (closure->getFunction() == funcLiteral) {
+                    held++;
+                    return;
+                }
+            }
+            closures.emplace_back(&value, 1);
+        };
+        for (const Value& value : frame->slots) {collect(value);}
+        for (const auto& [name, value] : frame->symbolTable.getTable()) {collect(value);}
+        bool escaped = closures.empty() || frame.use_count() != 1 + static_cast<long>(closures.size());
+        for (const auto& [closure, held] : closures) {
+            if (closure->getShareCount() != held) {escaped = true;}
+        }
+        if (!escaped) {frame->release();}
+        else if (capturedSlots) {
+            for (std::size_t i = 0; i < frame->slots.size(); i++) {
+                if (!(*capturedSlots)[i]) {frame->slots[i] = Value();}
+            }
+        }
+    }
+    frame.reset();
+}
 
 std::unique_ptr<Context> Context::clone() const {
     auto newContext = std::make_unique<Context>(diplayName, parentContext, entryPoint);
+    newContext->parentOwner = parentOwner;
 
     std::unique_ptr<SymbolTable> newTable = symbolTable.clone();
-    newContext->setSymbolTable(newTable.get());
+    newContext->setSymbolTable(std::move(*newTable));
+    newContext->slots = slots;
+    newContext->slotNames = slotNames;
     return newContext;
 }
 
@@ -0,0 +1,65 @@
+#include <stdexcept>
+#include <utility>
+
+#include "Engine.h"
+#include "ProgramFile.h"
+#include "SourceBuffer.h"
+
+Program::Program(std::string name, Chunk chunk, std::shared_ptr<const SourceRegistration> source) :
+name(std::move(name)),
+chunk(std::make_shared<const Chunk>(std::move(chunk))),
+source(std::move(source)) {}
+
+const std::string& Program::getName() const {return name;}
+
+const Chunk& Program::getChunk() const {return *chunk;}
+
+Engine::Engine() : vm(nullptr), output(captured) {}
+
+Program Engine::compile(const std::string_view source, const std::string& name) {
+    std::shared_ptr<const SourceBuffer> buffer = SourceBuffer::fromString(std::string(source));
+    auto registration = std::make_shared<const SourceRegistration>(SourceTable::registerFile(name, buffer));
+    Chunk chunk = ProgramFile::compile(registration->getFileId(), std::move(buffer));
+    return Program(name, std::move(chunk), std::move(registration));
+}
+
+Program Engine::compileFile(const std::string& filename) {
+    std::shared_ptr<const SourceBuffer> source = SourceBuffer::fromFile(filename);
+    if (!source) {throw std::runtime_error("Error: Could not open file: " + filename);}
+    const bool compiled = ProgramFile::isProgram(source->getText());
+    auto registration = std::make_shared<const SourceRegistration>(
+        SourceTable::registerFile(filename, compiled ? nullptr : source)); // a compiled program has no lines to show
+    Chunk chunk = compiled ? ProgramFile::read(source->getText(), 0, registration->getFileId())
+        : ProgramFile::compile(registration->getFileId(), std::move(source));
+    return Program(filename, std::move(chunk), std::move(registration));
+}
+
+std::unique_ptr<Context> Engine::makeContext(const std::string& name) {return Context::makeGlobal(name);}
+
+Engine::Result Engine::run(const Program& program) {
+    const std::unique_ptr<Context> globals = makeContext(program.getName());
+    return run(program, *globals);
+}
+
+// out() goes to the engine's buffer while the run lasts, whatever a failed run left behind is cleared first
+Engine::Result Engine::run(const Program& program, Context& globals) {
+    output.flush();
+    captured.str("");
+    Result result;
+    {
+        OutputBuffer::Scope outputScope(&output);
+        vm.setGlobalContext(&globals);
+        result.value = vm.run(program.getChunk(), 0);
+    }
+    output.flush();
+    result.output = captured.str();
+    return result;
+}
+
+void Engine::setGlobal(Context& globals, const std::string& name, Value value) {
+    globals.getSymbolTable().set(name, std::move(value));
+}
+
+const Value& Engine::getGlobal(Context& globals, const std::string& name) {
+    return globals.getSymbolTable().getValue(name);
+}
@@ -33,3 +33,6 @@ InterpretError::InterpretError(const std::string& message): Error(
 VisRunTimeError::VisRunTimeError(const std::string& message): Error("RunTime Error: " + message) {
 }
 
+ProgramFileError::ProgramFileError(const std::string& message): Error("Program File Error: " + message) {
+}
+
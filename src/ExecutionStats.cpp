@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "ExecutionStats.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define VIS_HAS_RUSAGE
+#endif
+
+thread_local ExecutionStats* ExecutionStats::active = nullptr;
+
+std::string phaseToStr(const ExecutionStats::Phase phase) {
+    switch (phase) {
+        case ExecutionStats::Phase::Read: return "read";
+        case ExecutionStats::Phase::Lex: return "lex";
+        case ExecutionStats::Phase::Parse: return "parse";
+        case ExecutionStats::Phase::Resolve: return "resolve";
+        case ExecutionStats::Phase::Compile: return "compile";
+        case ExecutionStats::Phase::Execute: return "execute";
+        default: return "unknown";
+    }
+}
+
+namespace {
+void printCount(std::ostream& os, const std::string& label, const std::uint64_t count) {
+    os << "  " << std::left << std::setw(24) << label << std::right << std::setw(14) << count << std::endl;
+}
+
+// nonzero counters only, busiest first
+void printBreakdown(std::ostream& os, std::vector<std::pair<std::string, std::uint64_t>> counts) {
+    counts.erase(std::remove_if(counts.begin(), counts.end(), [](const auto& count) {return count.second == 0;}),
+        counts.end());
+    std::stable_sort(counts.begin(), counts.end(), [](const auto& left, const auto& right) {
+        return left.second > right.second;
+    });
+    for (const auto& [label, count] : counts) {printCount(os, "  " + label, count);}
+}
+}
+
+// written into a buffer first so the caller's stream keeps its formatting flags
+void ExecutionStats::print(std::ostream& os, const std::string& title) const {
+    std::ostringstream report;
+    report << "stats for " << title << std::endl << std::fixed << std::setprecision(3);
+    std::chrono::steady_clock::duration total{};
+    for (std::size_t i = 0; i < phaseCount; i++) {
+        total += phaseTimes[i];
+        const double milliseconds = std::chrono::duration<double, std::milli>(phaseTimes[i]).count();
+        report << "  " << std::left << std::setw(24) << phaseToStr(static_cast<Phase>(i)) + " (ms)"
+            << std::right << std::setw(14) << milliseconds << std::endl;
+    }
+    report << "  " << std::left << std::setw(24) << "total (ms)" << std::right << std::setw(14)
+        << std::chrono::duration<double, std::milli>(total).count() << std::endl;
+    printCount(report, "function calls", functionCalls);
+    printCount(report, "symbol lookups", symbolLookups);
+    printCount(report, "symbol misses", symbolMisses);
+    printCount(report, "literal allocations", literalAllocations);
+    if (const long peakKilobytes = peakResidentKilobytes(); peakKilobytes > 0) {
+        report << "  " << std::left << std::setw(24) << "peak resident (KB)" << std::right << std::setw(14)
+            << peakKilobytes << std::endl;
+    }
+    std::vector<std::pair<std::string, std::uint64_t>> nodeCounts;
+    for (std::size_t i = 0; i < nodeTypeCount; i++) {
+        nodeCounts.emplace_back(nodeTypeToStr(static_cast<NodeType>(i)), nodeVisits[i]);
+    }
+    std::vector<std::pair<std::string, std::uint64_t>> instructionCounts;
+    for (std::size_t i = 0; i < opCodeCount; i++) {
+        instructionCounts.emplace_back(opCodeToStr(static_cast<OpCode>(i)), instructions[i]);
+    }
+    if (std::any_of(nodeVisits.begin(), nodeVisits.end(), [](const std::uint64_t count) {return count > 0;})) {
+        report << "  node visits" << std::endl;
+        printBreakdown(report, std::move(nodeCounts));
+    }
+    if (std::any_of(instructions.begin(), instructions.end(), [](const std::uint64_t count) {return count > 0;})) {
+        report << "  instructions" << std::endl;
+        printBreakdown(report, std::move(instructionCounts));
+    }
+    os << report.str();
+}
+
+long ExecutionStats::peakResidentKilobytes() {
+#ifdef VIS_HAS_RUSAGE
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {return 0;}
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // reported in bytes rather than kilobytes
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+ExecutionStats::Scope::Scope(ExecutionStats* stats) : previous(active) {active = stats;}
+
+ExecutionStats::Scope::~Scope() {active = previous;}
+
+ExecutionStats::Stopwatch::Stopwatch(ExecutionStats* stats) : stats(stats) {
+    if (stats) {last = std::chrono::steady_clock::now();}
+}
+
+void ExecutionStats::Stopwatch::lap(const Phase phase) {
+    if (!stats) {return;}
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    stats->phaseTimes[static_cast<std::size_t>(phase)] += now - last;
+    last = now;
+}
@@ -3,368 +3,582 @@
 //
 
 #include <error.h>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <optional>
 
 #include "Interpreter.h"
+#include "Compiler.h"
+#include "ConstantFolder.h"
+#include "ExecutionStats.h"
+#include "ParallelParser.h"
+#include "Profiler.h"
+#include "ProgramFile.h"
 #include "PositionHandler.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include "Resolver.h"
 #include "Literal.h"
+#include "NodeArena.h"
+#include "OutputBuffer.h"
+#include "VM.h"
 
 
-void printTokens(const std::map<int, std::vector<Token>>& tokenMap) {
-    for (const auto& [lineNumber, tokens] : tokenMap) {
-        std::cout << "Line " << lineNumber << ":" << std::endl;
-        for (const Token& token : tokens) {
-            std::cout << token << std::endl;
+void printTokens(const TokenStream& tokenStream, std::ostream& os) {
+    for (std::size_t lineNumber = 0; lineNumber < tokenStream.lineCount(); lineNumber++) {
+        os << "Line " << lineNumber << ":" << std::endl;
+        for (const Token& token : tokenStream.getLine(lineNumber)) {
+            os << token << std::endl;
         }
-        std::cout << std::endl;
+        os << std::endl;
     }
 }
 
 
-//RETURN SIGNAL DEFINITION
-ReturnSignal::ReturnSignal(std::unique_ptr<Literal> value) : returnValue(std::move(value)) {}
-std::unique_ptr<Literal> ReturnSignal::getValue() {return std::move(returnValue);}
-
+namespace {
+// a compiled program given directly or the cached compile of this source, nullopt when the source has to be parsed
+std::optional<Chunk> loadProgram(const SourceBuffer& source, const std::string& cachePath, const std::uint64_t sourceHash,
+    const std::uint32_t fileId) {
+    if (ProgramFile::isProgram(source.getText())) {return ProgramFile::read(source.getText(), 0, fileId);}
+    if (cachePath.empty()) {return std::nullopt;}
+    const std::shared_ptr<const SourceBuffer> cached = SourceBuffer::fromFile(cachePath);
+    if (!cached) {return std::nullopt;}
+    try {return ProgramFile::read(cached->getText(), sourceHash, fileId);}
+    catch (const ProgramFileError&) {return std::nullopt;} // stale or damaged entries are compiled again and replaced
+}
+}
 
 
 //INTERPRETER DEFINTITION
-Interpreter::Interpreter(const std::string &filename, const bool verboseFlag) {
-    interpretFile(filename, verboseFlag);
+Interpreter::Interpreter(const std::string &filename, const bool verboseFlag, const bool treeWalkFlag, const bool statsFlag,
+    const bool profileFlag, const std::string& cacheDirectory) {
+    interpretFile(filename, verboseFlag, treeWalkFlag, statsFlag, profileFlag, cacheDirectory);
 };
 
-void Interpreter::interpretFile(const std::string &filename, bool verboseFlag) {
-    std::ifstream inputFile(filename);
-    if (!inputFile.is_open()) {throw std::runtime_error("Error: Could not open file: " + filename);}
-    PositionHandler positionHandler(filename, inputFile);
-    SymbolTable globalSymbolTable = SymbolTable();
-    globalSymbolTable.set("null", std::make_unique<BoolLiteral>(false));
-    globalSymbolTable.set("true", std::make_unique<BoolLiteral>(true));
-    globalSymbolTable.set("false", std::make_unique<BoolLiteral>(false));
-    Context globalContext = Context(filename);
-    globalContext.setSymbolTable(std::move(globalSymbolTable));
-
-    Lexer lexer(positionHandler);
-    std::map<int, std::vector<Token>> tokenList = lexer.tokenise();
-    if (verboseFlag) {printTokens(tokenList);} // print tokens
-    Parser parser(tokenList);
-    std::unique_ptr<Node> nodeTree;
-    do {
-        nodeTree = parser.parse();
-        if (nodeTree) {  // only process non-null nodes
-            if (nodeTree->getType() == NodeType::EndOfFile) {
-                break; // exit if we get an EndOfFile node
+// runs each statement as soon as it is parsed, on the VM by default or the tree walker when treeWalkFlag is set
+// statsFlag prints an ExecutionStats summary to stderr once the whole file has run
+// profileFlag prints a Profiler summary to stderr and writes collapsed stacks to filename.folded
+// a file written by --compile runs straight on the VM, and with a cacheDirectory a VM run of a source file that ran
+// to completion before is loaded from its cached compile instead of being lexed and parsed again
+void Interpreter::interpretFile(const std::string &filename, bool verboseFlag, bool treeWalkFlag, bool statsFlag,
+    bool profileFlag, const std::string& cacheDirectory) {
+    const std::unique_ptr<ExecutionStats> runStats = statsFlag ? std::make_unique<ExecutionStats>() : nullptr;
+    ExecutionStats::Scope statsScope(runStats ? runStats.get() : ExecutionStats::getActive()); // keeps an outer collector
+    ExecutionStats::Stopwatch stopwatch(ExecutionStats::getActive());
+    const std::unique_ptr<Profiler> runProfiler = profileFlag ? std::make_unique<Profiler>(filename) : nullptr;
+    Profiler::Scope profilerScope(runProfiler ? runProfiler.get() : Profiler::getActive());
+    Profiler* profiler = Profiler::getActive();
+    if (runStats || runProfiler) {setInstrumented(true);}
+    std::ostream& verboseOutput = OutputBuffer::current().getStream(); // keeps listings in order with out()
+    NodeArena nodeArena; // declared first so every function value still pointing at the tree is gone before it
+    NodeArena::Scope arenaScope(nodeArena);
+    std::shared_ptr<const SourceBuffer> source = SourceBuffer::fromFile(filename);
+    if (!source) {throw std::runtime_error("Error: Could not open file: " + filename);}
+    // one entry whether the file is parsed or loaded, a compiled program has no lines to show
+    // errors are formatted when they are thrown, so the entry is released as soon as the run ends
+    const bool compiled = ProgramFile::isProgram(source->getText());
+    const SourceRegistration sourceFile(SourceTable::registerFile(filename, compiled ? nullptr : source));
+    const std::uint32_t fileId = sourceFile.getFileId();
+    const std::unique_ptr<Context> globalContext = Context::makeGlobal(filename);
+    const bool cacheable = !cacheDirectory.empty() && !treeWalkFlag && !verboseFlag;
+    const std::uint64_t sourceHash = cacheable ? ProgramFile::hashBytes(source->getText()) : 0;
+    const std::string cachePath = cacheable ? ProgramFile::cachePath(cacheDirectory, sourceHash) : "";
+    if (const std::optional<Chunk> program = loadProgram(*source, cachePath, sourceHash, fileId)) {
+        if (treeWalkFlag) {throw ProgramFileError("compiled programs only run on the vm");}
+        stopwatch.lap(ExecutionStats::Phase::Read);
+        if (verboseFlag) {verboseOutput << *program << std::endl;}
+        VM vm(globalContext.get());
+        if (profiler) {profiler->resume();}
+        vm.run(*program, 0);
+        if (profiler) {profiler->pause();}
+        stopwatch.lap(ExecutionStats::Phase::Execute);
+    }
+    else {
+        // large files are split and parsed up front on worker threads, verbose runs keep the single token listing
+        const unsigned parseThreads = verboseFlag ? 1 : ParallelParser::chooseThreadCount(source->size());
+        std::unique_ptr<ParallelParser> parallelParser;
+        std::unique_ptr<Parser> parser;
+        if (parseThreads > 1) {
+            stopwatch.lap(ExecutionStats::Phase::Read);
+            parallelParser = std::make_unique<ParallelParser>(fileId, std::move(source), parseThreads);
+            stopwatch.lap(ExecutionStats::Phase::Lex);
+        }
+        else {
+            PositionHandler positionHandler(fileId, std::move(source));
+            stopwatch.lap(ExecutionStats::Phase::Read);
+
+            Lexer lexer(positionHandler);
+            const auto lexStart = std::chrono::steady_clock::now();
+            TokenStream tokenStream = lexer.tokenise();
+            stopwatch.lap(ExecutionStats::Phase::Lex);
+            if (verboseFlag) {
+                const std::chrono::duration<double> lexTime = std::chrono::steady_clock::now() - lexStart;
+                printTokens(tokenStream, verboseOutput);
+                const double megabytes = static_cast<double>(positionHandler.getSourceSize()) / (1024.0 * 1024.0);
+                verboseOutput << "lexed " << positionHandler.getSourceSize() << " bytes in " << lexTime.count() * 1000 << " ms ("
+                    << (lexTime.count() > 0 ? megabytes / lexTime.count() : 0) << " MB/s)" << std::endl << std::endl;
+            } // print tokens
+            parser = std::make_unique<Parser>(std::move(tokenStream));
+        }
+        Chunk chunk;
+        Compiler compiler(chunk);
+        VM vm(globalContext.get());
+        ConstantFolder constantFolder;
+        Resolver resolver;
+        std::unique_ptr<Node> nodeTree;
+        do {
+            const NodeArena::Mark statementMark = nodeArena.getMark();
+            nodeTree = parallelParser ? parallelParser->parse() : parser->parse();
+            stopwatch.lap(ExecutionStats::Phase::Parse);
+            if (nodeTree) {  // only process non-null nodes
+                if (nodeTree->getType() == NodeType::EndOfFile) {
+                    break; // exit if we get an EndOfFile node
+                }
+                const std::size_t removedNodes = constantFolder.fold(nodeTree);
+                resolver.resolve(nodeTree);
+                stopwatch.lap(ExecutionStats::Phase::Resolve);
+                if (verboseFlag && removedNodes > 0) {verboseOutput << "constant folding removed " << removedNodes << " nodes" << std::endl;}
+                if (verboseFlag) {verboseOutput << *nodeTree << std::endl << std::endl;} // print node
+                Value returnValue;
+                if (treeWalkFlag) {
+                    if (profiler) {profiler->resume();}
+                    returnValue = evaluate(nodeTree, globalContext.get());
+                    if (profiler) {profiler->pause();}
+                    stopwatch.lap(ExecutionStats::Phase::Execute);
+                    if (globalContext->isInterrupted()) {throw VisRunTimeError("return called outside of a function");}
+                }
+                else {
+                    const std::size_t codeStart = chunk.code.size();
+                    const std::size_t functionStart = chunk.functions.size();
+                    compiler.compile(nodeTree);
+                    stopwatch.lap(ExecutionStats::Phase::Compile);
+                    if (verboseFlag) {chunk.printChunk(verboseOutput, 0, codeStart, functionStart); verboseOutput << std::endl;}
+                    if (profiler) {profiler->resume();}
+                    returnValue = vm.run(chunk, codeStart);
+                    if (profiler) {profiler->pause();}
+                    stopwatch.lap(ExecutionStats::Phase::Execute);
+                }
+                if (verboseFlag) { if (!returnValue.isNull()) {
+                    verboseOutput << returnValue << std::endl << std::string(100, '-') << std::endl;
+                } } // print visited value return
+                if (!resolver.definedFunctions()) { // function bodies outlive their statement, even inside a block
+                    nodeTree.reset();
+                    nodeArena.rewind(statementMark);
+                }
             }
-            if (verboseFlag) {std::cout << *nodeTree << std::endl << std::endl;} // print node
-            std::unique_ptr<Literal> returnLiteral = visit(nodeTree, &globalContext);
-            if (verboseFlag) { if (returnLiteral) {
-                std::cout << *returnLiteral << std::endl << std::string(100, '-') << std::endl;
-            } } // print visited literal return
+        }
+        while (true);
+        if (cacheable) { // a failed cache write only costs the next run its shortcut
+            try {ProgramFile::save(cachePath, chunk, sourceHash, filename);}
+            catch (const std::exception&) {}
         }
     }
-    while (true);
+    if (runStats || runProfiler) {
+        setInstrumented(false);
+        OutputBuffer::current().flush();
+    }
+    const std::string engine = treeWalkFlag ? " (tree walker)" : " (vm)";
+    if (runStats) {runStats->print(std::cerr, filename + engine);}
+    if (runProfiler) {
+        runProfiler->print(std::cerr, filename + engine);
+        const std::string stacksFile = filename + ".folded";
+        std::ofstream stacks(stacksFile);
+        if (!stacks) {throw std::runtime_error("Error: Could not write file: " + stacksFile);}
+        runProfiler->writeCollapsedStacks(stacks);
+        std::cerr << "collapsed stacks written to " << stacksFile << std::endl;
+    }
 }
 
+// boxed entry point kept for callers that work with literals, evaluation itself stays on values
 std::unique_ptr<Literal> Interpreter::visit(const std::unique_ptr<Node> &node, Context *context) {
-    switch (node->getType()) {
-        case NodeType::Number:
-            return visitNumberNode(dynamic_cast<Number*>(node.get()), context);
-        case NodeType::String:
-            return visitStringNode(dynamic_cast<StringNode*>(node.get()), context);
-        case NodeType::BinaryOperator:
-            return visitBinaryOpNode(dynamic_cast<BinaryOperator*>(node.get()), context);
-        case NodeType::UnaryOperator:
-            return visitUnaryOpNode(dynamic_cast<UnaryOperator*>(node.get()), context);
-        case NodeType::VarAccess:
-            return visitVarAccessNode(dynamic_cast<VarAccess*>(node.get()), context);
-        case NodeType::VarAssgnment:
-            return visitVarAssignNode(dynamic_cast<VarAssignment*>(node.get()), context);
-        case NodeType::VarIncrement:
-            return visitVarIncrementNode(dynamic_cast<VarIncrement*>(node.get()), context);
-        case NodeType::VarDecrement:
-            return visitVarDecrementNode(dynamic_cast<VarDecrement*>(node.get()), context);
-        case NodeType::LibCall:
-            return visitLibCallNode(dynamic_cast<LibCall*>(node.get()), context);
-        case NodeType::IfStmt:
-            return visitIfStmtNode(dynamic_cast<IfStmt*>(node.get()), context);
-        case NodeType::WhileStmt:
-            return visitWhileStmtNode(dynamic_cast<WhileStmt*>(node.get()), context);
-        case NodeType::ForStmt:
-            return visitForStmtNode(dynamic_cast<ForStmt*>(node.get()), context);
-        case NodeType::FuncDef:
-            return visitFuncDefNode(dynamic_cast<FuncDef*>(node.get()), context);
-        case NodeType::FuncCall:
-            return visitFuncCallNode(dynamic_cast<FuncCall*>(node.get()), context);
-        case NodeType::ReturnCall:
-            return visitReturnCallNode(dynamic_cast<ReturnCall*>(node.get()), context);
-        default:
-            throw VisRunTimeError("visit node method not defined");
+    return evaluate(node, context).toLiteral();
+}
+
+// visitors indexed by NodeType, node types that are never evaluated on their own fall through to visitUnknownNode
+template <bool Instrumented>
+constexpr auto Interpreter::makeVisitors() -> std::array<NodeVisitor, nodeTypeCount> {
+    return {
+        &visitUnknownNode,                                          // EndOfFile
+        &dispatch<Instrumented, Number, &visitNumberNode>,
+        &dispatch<Instrumented, StringNode, &visitStringNode>,
+        &visitUnknownNode,                                          // Operator
+        &dispatch<Instrumented, UnaryOperator, &visitUnaryOpNode>,
+        &dispatch<Instrumented, BinaryOperator, &visitBinaryOpNode>,
+        &dispatch<Instrumented, VarAssignment, &visitVarAssignNode>,
+        &dispatch<Instrumented, VarAccess, &visitVarAccessNode>,
+        &dispatch<Instrumented, VarIncrement, &visitVarIncrementNode>,
+        &dispatch<Instrumented, VarDecrement, &visitVarDecrementNode>,
+        &dispatch<Instrumented, LibCall, &visitLibCallNode>,
+        &dispatch<Instrumented, IfStmt, &visitIfStmtNode>,
+        &dispatch<Instrumented, WhileStmt, &visitWhileStmtNode>,
+        &dispatch<Instrumented, ForStmt, &visitForStmtNode>,
+        &dispatch<Instrumented, FuncDef, &visitFuncDefNode>,
+        &dispatch<Instrumented, FuncCall, &visitFuncCallNode>,
+        &dispatch<Instrumented, ReturnCall, &visitReturnCallNode>,
+    };
+}
+
+// the plain table has no instrumentation at all, --stats and --profile swap the whole table instead of testing a flag per node
+const std::array<Interpreter::NodeVisitor, Interpreter::nodeTypeCount> Interpreter::plainVisitors = makeVisitors<false>();
+const std::array<Interpreter::NodeVisitor, Interpreter::nodeTypeCount> Interpreter::instrumentedVisitors = makeVisitors<true>();
+thread_local const std::array<Interpreter::NodeVisitor, Interpreter::nodeTypeCount>* Interpreter::nodeVisitors = &plainVisitors;
+
+void Interpreter::setInstrumented(const bool instrumented) {
+    nodeVisitors = instrumented ? &instrumentedVisitors : &plainVisitors;
+}
+
+// a tail call is made by its caller's call loop without visiting the FuncCall, so its return is counted instead
+void Interpreter::instrumentVisit(const Node* node) {
+    if (Profiler* profiler = Profiler::getActive(); profiler && profiler->tick()) {profiler->sample(node->getToken().getPos());}
+    ExecutionStats* stats = ExecutionStats::getActive();
+    if (!stats) {return;}
+    stats->nodeVisits[static_cast<std::size_t>(node->getType())]++;
+    if (node->getType() == NodeType::FuncCall) {stats->functionCalls++;}
+    else if (node->getType() == NodeType::ReturnCall) {
+        const std::unique_ptr<Node>& expression = static_cast<const ReturnCall*>(node)->getExpression();
+        if (expression && expression->getType() == NodeType::FuncCall &&
+            static_cast<const FuncCall*>(expression.get())->isTailCall()) {stats->functionCalls++;}
     }
 }
 
-std::unique_ptr<Literal> Interpreter::visitNumberNode(const Number* node, Context* context) {
-    const Token token = node->getToken();
+Value Interpreter::evaluate(const std::unique_ptr<Node> &node, Context *context) {
+    return (*nodeVisitors)[static_cast<std::size_t>(node->getType())](node.get(), context);
+}
+
+Value Interpreter::visitUnknownNode(const Node* node, Context* context) {
+    throw VisRunTimeError("visit node method not defined");
+}
+
+Value Interpreter::visitNumberNode(const Number* node, Context* context) {
+    const Token& token = node->getToken();
     const TokenType type = token.getType();
-    std::unique_ptr<Literal> numberLiteral = nullptr;
     if (type == TokenType::INT) {
-        const int value = std::get<int>(token.getValue());
-        numberLiteral = std::make_unique<IntLiteral>(value);
+        return Value(std::get<int>(token.getValue()));
     }
-    else if (type == TokenType::FLOAT) {
-        const float value = std::get<float>(token.getValue());
-        numberLiteral = std::make_unique<FloatLiteral>(value);
+    if (type == TokenType::FLOAT) {
+        return Value(std::get<double>(token.getValue()));
     }
-    else {
-        throw VisRunTimeError("When visiting number node was provided token of type <" + tokenTypeToStr(type) +
-            "> instead of INT or FLOAT");
-    }
-    numberLiteral->setPosition(token.getPos());
-    numberLiteral->setContext(context);
-    return numberLiteral;
+    throw VisRunTimeError("When visiting number node was provided token of type <" + tokenTypeToStr(type) +
+        "> instead of INT or FLOAT");
 }
 
-std::unique_ptr<Literal> Interpreter::visitStringNode(const StringNode* node, Context* context) {
-    const Token token = node->getToken();
-    const std::string value = std::get<std::string>(token.getValue());
-    std::unique_ptr<Literal> stringLiteral = std::make_unique<StringLiteral>(value);
+Value Interpreter::visitStringNode(const StringNode* node, Context* context) {
+    const Token& token = node->getToken();
+    auto stringLiteral = std::make_shared<StringLiteral>(std::get<std::string>(token.getValue()));
     stringLiteral->setPosition(token.getPos());
-    stringLiteral->setContext(context);
-    return stringLiteral;
-}
-
-std::unique_ptr<Literal> Interpreter::visitBinaryOpNode(const BinaryOperator *node, Context *context) {
-    const Token token = node->getToken();
-    const std::unique_ptr<Node> &left = node->getLeftNode();
-    const Operator operatorNode = node->getOperatorNode();
-    const std::unique_ptr<Node> &right = node->getRightNode();
-    const std::unique_ptr<Literal> leftvalue = visit(left, context);
-    const std::unique_ptr<Literal> rightvalue = visit(right, context);
-    std::unique_ptr<Literal> uniqueLiteral;
-    switch (operatorNode.getToken().getType()) {
-        case TokenType::PLUS:
-            uniqueLiteral = leftvalue->add(*rightvalue);
-            break;
-        case TokenType::MINUS:
-            uniqueLiteral = leftvalue->subtract(*rightvalue);
-            break;
-        case TokenType::MUL:
-            uniqueLiteral = leftvalue->multiply(*rightvalue);
-            break;
-        case TokenType::DIV:
-            uniqueLiteral = leftvalue->divide(*rightvalue);
-            break;
-        case TokenType::MOD:
-            uniqueLiteral = leftvalue->modulo(*rightvalue);
-            break;
-        case TokenType::TRUEEQUALS:
-            uniqueLiteral = leftvalue->compareTE(*rightvalue);
-            break;
-        case TokenType::NOTEQUAL:
-            uniqueLiteral = leftvalue->compareNE(*rightvalue);
-            break;
-        case TokenType::LESSTHAN:
-            uniqueLiteral = leftvalue->compareLT(*rightvalue);
-            break;
-        case TokenType::LESSEQUAL:
-            uniqueLiteral = leftvalue->compareLTE(*rightvalue);
-            break;
-        case TokenType::GREATERTHAN:
-            uniqueLiteral = leftvalue->compareGT(*rightvalue);
-            break;
-        case TokenType::GREATEREQUAL:
-            uniqueLiteral = leftvalue->compareGTE(*rightvalue);
-            break;
-        case TokenType::KEYWORD:
-            if (operatorNode.getToken().matches(TokenType::KEYWORD, "and")) {
-                uniqueLiteral = leftvalue->andWith(*rightvalue);
-                break;
-            }
-            else if (operatorNode.getToken().matches(TokenType::KEYWORD, "or")) {
-                uniqueLiteral = leftvalue->orWith(*rightvalue);
-                break;
-            }
+    return Value(std::shared_ptr<const Literal>(std::move(stringLiteral)));
+}
+
+Value Interpreter::visitBinaryOpNode(const BinaryOperator *node, Context *context) {
+    const Value leftValue = evaluate(node->getLeftNode(), context);
+    const Value rightValue = evaluate(node->getRightNode(), context);
+    switch (node->getOperatorKind()) {
+        case OperatorKind::Add:
+            return leftValue.add(rightValue);
+        case OperatorKind::Subtract:
+            return leftValue.subtract(rightValue);
+        case OperatorKind::Multiply:
+            return leftValue.multiply(rightValue);
+        case OperatorKind::Divide:
+            return leftValue.divide(rightValue);
+        case OperatorKind::Modulo:
+            return leftValue.modulo(rightValue);
+        case OperatorKind::Equal:
+            return leftValue.compareTE(rightValue);
+        case OperatorKind::NotEqual:
+            return leftValue.compareNE(rightValue);
+        case OperatorKind::Less:
+            return leftValue.compareLT(rightValue);
+        case OperatorKind::LessEqual:
+            return leftValue.compareLTE(rightValue);
+        case OperatorKind::Greater:
+            return leftValue.compareGT(rightValue);
+        case OperatorKind::GreaterEqual:
+            return leftValue.compareGTE(rightValue);
+        case OperatorKind::And:
+            return leftValue.andWith(rightValue);
+        case OperatorKind::Or:
+            return leftValue.orWith(rightValue);
         default:
-            throw ParseError("did not recognise token <"
-                + tokenTypeToStr(operatorNode.getToken().getType())
-                + "> inside binary opertaion instead expected: PLUS, MINUS, MUL, DIV");
+            throw InterpretError("binary operator not defined");
     }
-    uniqueLiteral->setPosition(token.getPos());
-    uniqueLiteral->setContext(context);
-    return uniqueLiteral;
-}
-
-std::unique_ptr<Literal> Interpreter::visitUnaryOpNode(const UnaryOperator* node, Context* context) {
-    const Token token = node->getToken();
-    const Operator operatorNode = node->getOperator();
-    const std::unique_ptr<Literal> valueLiteral = visit(node->getValue(), context);
-    std::unique_ptr<Literal> returnLiteral;
-    if(operatorNode.getToken().getType() == TokenType::MINUS) {
-        returnLiteral = valueLiteral->multiply(IntLiteral(-1));
-    }
-    else if (operatorNode.getToken().matches(TokenType::KEYWORD, "not")) {
-        returnLiteral = valueLiteral->notSelf();
-    }
-    else {
-        throw ParseError("unknown operator <"
-                + tokenTypeToStr(operatorNode.getToken().getType())
-                + "> for unary operation, expected MINUS or KEYWORD<not>");
+}
+
+Value Interpreter::visitUnaryOpNode(const UnaryOperator* node, Context* context) {
+    const Value value = evaluate(node->getValue(), context);
+    if (node->getOperatorKind() == OperatorKind::Negate) {
+        return value.negate();
     }
-    returnLiteral->setPosition(token.getPos());
-    returnLiteral->setContext(context);
-    return returnLiteral;
+    return value.notSelf(); // the only other unary operator a node can be built with
 }
 
-std::unique_ptr<Literal> Interpreter::visitVarAssignNode(const VarAssignment *node, Context *context) {
-    const std::string varName = std::get<std::string>(node->getToken().getValue());
-    auto literalValue = std::unique_ptr(visit(node->getValue(), context));
-    std::unique_ptr<Literal> clonedValue = literalValue->clone();
-    context->getSymbolTable().set(varName, std::move(literalValue));
-    return clonedValue;
+// resolved names read their activation record slot, globals keep the by name lookup
+const Value& Interpreter::readVariable(const Node* node, Context* context) {
+    if (const SlotRef& ref = node->getSlotRef(); ref.isResolved()) {return context->getResolved(ref);}
+    return context->getSymbolTable().getValue(std::get<std::string>(node->getToken().getValue()));
 }
 
-std::unique_ptr<Literal> Interpreter::visitVarAccessNode(const VarAccess *node, Context* context) {
-    const std::string varName = std::get<std::string>(node->getToken().getValue());
-    std::unique_ptr<Literal> value = context->getSymbolTable().getLiteral(varName)->clone();
-    if (not value) {
-        throw VisRunTimeError("unknown variable " + varName);
+void Interpreter::writeVariable(const Node* node, Context* context, Value value) {
+    if (const SlotRef& ref = node->getSlotRef(); ref.isResolved()) {
+        context->getAncestor(ref.depth)->getSlot(ref.slot) = std::move(value);
+        return;
     }
+    context->getSymbolTable().set(std::get<std::string>(node->getToken().getValue()), std::move(value));
+}
+
+Value Interpreter::visitVarAssignNode(const VarAssignment *node, Context *context) {
+    Value value = evaluate(node->getValue(), context);
+    if (value.isNull()) {
+        throw VisRunTimeError("cannot assign a null value to variable " + std::get<std::string>(node->getToken().getValue()));
+    }
+    writeVariable(node, context, value);
     return value;
 }
 
-std::unique_ptr<Literal> Interpreter::visitVarIncrementNode(const VarIncrement *node, Context* context) {
-    const std::string varName = std::get<std::string>(node->getToken().getValue());
-    std::unique_ptr<Literal> value = context->getSymbolTable().getLiteral(varName)->clone();
-    if (not value) {throw VisRunTimeError("unknown variable " + varName);}
-    value = value->add(IntLiteral(1));
-    std::unique_ptr<Literal> clonedValue = value->clone();
-    context->getSymbolTable().set(varName, std::move(value));
-    return clonedValue;
+Value Interpreter::visitVarAccessNode(const VarAccess *node, Context* context) {
+    return readVariable(node, context);
+}
+
+Value Interpreter::visitVarIncrementNode(const VarIncrement *node, Context* context) {
+    Value value = readVariable(node, context).add(Value(1));
+    writeVariable(node, context, value);
+    return value;
 }
 
-std::unique_ptr<Literal> Interpreter::visitVarDecrementNode(const VarDecrement *node, Context* context) {
-    const std::string varName = std::get<std::string>(node->getToken().getValue());
-    std::unique_ptr<Literal> value = context->getSymbolTable().getLiteral(varName)->clone();
-    if (not value) {throw VisRunTimeError("unknown variable " + varName);}
-    value = value->subtract(IntLiteral(1));
-    std::unique_ptr<Literal> clonedValue = value->clone();
-    context->getSymbolTable().set(varName, std::move(value));
-    return clonedValue;
+Value Interpreter::visitVarDecrementNode(const VarDecrement *node, Context* context) {
+    Value value = readVariable(node, context).subtract(Value(1));
+    writeVariable(node, context, value);
+    return value;
 }
 
-std::unique_ptr<Literal> Interpreter::visitLibCallNode(const LibCall *node, Context *context) {
+Value Interpreter::visitLibCallNode(const LibCall *node, Context *context) {
     const std::string &libFunc = std::get<std::string>(node->getToken().getValue());
     if (libFunc == "out") {
         for (const auto& argumentNode : node->getArgumentNodes()) {
-            if (const std::unique_ptr<Literal> returnLiteral = visit(argumentNode, context)) {
-                std::cout << returnLiteral->getStringValue() << " ";
+            if (const Value value = evaluate(argumentNode, context); !value.isNull()) {
+                OutputBuffer& output = OutputBuffer::current();
+                output.write(value);
+                output.write(" ");
             }
         }
-        std::cout << std::endl;
+        OutputBuffer::current().endLine();
+    } else if (libFunc == "flush") {
+        if (!node->getArgumentNodes().empty()) {throw VisRunTimeError("flush takes no arguments");}
+        OutputBuffer::current().flush();
     } else {
         throw VisRunTimeError("libCall was made to an unknown function: " + libFunc);
     }
-    return nullptr;
+    return Value();
+}
+
+// runs statements in order until one of them completes abruptly, the completion stays on the context for the caller
+void Interpreter::executeBlock(const std::vector<std::unique_ptr<Node>>& nodes, Context* context) {
+    for (const std::unique_ptr<Node>& executableNode : nodes) {
+        evaluate(executableNode, context);
+        if (context->isInterrupted()) {return;}
+    }
 }
 
-std::unique_ptr<Literal> Interpreter::visitIfStmtNode(const IfStmt* node, Context* context) {
-    std::unique_ptr<Literal> comparisonResult = visit(node->getComparison(), context);
-    const std::vector<std::unique_ptr<Node>>& executableNodes =
-        comparisonResult->getBoolValue() ? node->getIfBlock() : node->getElseBlock();
-    for (const std::unique_ptr<Node>& executableNode : executableNodes) {
-        visit(executableNode, context);
+// consumes break and continue after a loop body, a return is left for the enclosing function
+bool Interpreter::exitsLoop(Context* context) {
+    switch (context->getCompletion()) {
+        case Completion::Normal:
+            return false;
+        case Completion::Break:
+            context->takeCompletionValue();
+            return true;
+        case Completion::Continue:
+            context->takeCompletionValue();
+            return false;
+        default:
+            return true;
     }
+}
+
+Value Interpreter::visitIfStmtNode(const IfStmt* node, Context* context) {
+    Value comparisonResult = evaluate(node->getComparison(), context);
+    executeBlock(comparisonResult.getBoolValue() ? node->getIfBlock() : node->getElseBlock(), context);
     return comparisonResult;
 }
 
-std::unique_ptr<Literal> Interpreter::visitWhileStmtNode(const WhileStmt* node, Context* context) {
-    std::unique_ptr<Literal> comparisonResult = visit(node->getComparison(), context);
-    const std::vector<std::unique_ptr<Node>>& executableNodes = node->getWhileBlock();
-    while (visit(node->getComparison(), context)->getBoolValue()) {
-        for (const std::unique_ptr<Node>& executableNode : executableNodes) {
-            visit(executableNode, context);
-        }
+Value Interpreter::visitWhileStmtNode(const WhileStmt* node, Context* context) {
+    Value comparisonResult = evaluate(node->getComparison(), context);
+    while (evaluate(node->getComparison(), context).getBoolValue()) {
+        executeBlock(node->getWhileBlock(), context);
+        if (exitsLoop(context)) {break;}
     }
     return comparisonResult;
 }
 
-std::unique_ptr<Literal> Interpreter::visitForStmtNode(const ForStmt* node, Context* context) {
-    visit(node->getVarDeclare(), context);
-    std::unique_ptr<Literal> comparisonResult = visit(node->getCondition(), context);
-    const std::vector<std::unique_ptr<Node>>& executableNodes = node->getForBlock();
-    while (visit(node->getCondition(), context)->getBoolValue()) {
-        for (const std::unique_ptr<Node>& executableNode : executableNodes) {
-            visit(executableNode, context);
-        }
-        visit(node->getStep(), context);
+Value Interpreter::visitForStmtNode(const ForStmt* node, Context* context) {
+    evaluate(node->getVarDeclare(), context);
+    Value comparisonResult = evaluate(node->getCondition(), context);
+    if (const CountedLoop& loop = node->getCountedLoop(); loop.counted && runCountedLoop(node, loop, context)) {
+        return comparisonResult;
+    }
+    while (evaluate(node->getCondition(), context).getBoolValue()) {
+        executeBlock(node->getForBlock(), context);
+        if (exitsLoop(context)) {break;}
+        evaluate(node->getStep(), context);
     }
     return comparisonResult;
 }
 
-std::unique_ptr<Literal> Interpreter::visitFuncDefNode(const FuncDef* node, Context* context) {
+// runs the loop on a native int64 counter, returns false without running anything when start or bound is not an int
+bool Interpreter::runCountedLoop(const ForStmt* node, const CountedLoop& loop, Context* context) {
+    const auto* condition = static_cast<const BinaryOperator*>(node->getCondition().get());
+    const Value start = readVariable(condition->getLeftNode().get(), context);
+    const Value limit = evaluate(condition->getRightNode(), context);
+    if (start.getType() != ValueType::Int || limit.getType() != ValueType::Int) {return false;}
+    const Node* variable = node->getVarDeclare().get();
+    const std::int64_t bound = limit.getIntValue();
+    std::int64_t counter = start.getIntValue();
+    while (true) {
+        bool proceed;
+        switch (loop.comparison) {
+            case OperatorKind::Less: proceed = counter < bound; break;
+            case OperatorKind::LessEqual: proceed = counter <= bound; break;
+            case OperatorKind::Greater: proceed = counter > bound; break;
+            case OperatorKind::GreaterEqual: proceed = counter >= bound; break;
+            default: proceed = counter != bound; break;
+        }
+        if (!proceed) {break;}
+        if (loop.writesBack) {writeVariable(variable, context, Value(counter));}
+        executeBlock(node->getForBlock(), context);
+        if (exitsLoop(context)) {break;}
+        if (loop.step > 0 ? counter == std::numeric_limits<std::int64_t>::max()
+                          : counter == std::numeric_limits<std::int64_t>::min()) {
+            writeVariable(variable, context, Value(counter));
+            throw VisRunTimeError(loop.step > 0 ? "integer overflow in addition" : "integer overflow in subtraction");
+        }
+        counter += loop.step;
+    }
+    writeVariable(variable, context, Value(counter));
+    return true;
+}
+
+Value Interpreter::visitFuncDefNode(const FuncDef* node, Context* context) {
     auto contextForFunc = std::make_unique<Context>(node->getName());
     contextForFunc->setParentContext(context);
     contextForFunc->setSymbolTable(SymbolTable(&context->getSymbolTable()));
-    // Clone arguments and body
-    std::vector<Token> clonedArgs;
-    for (const Token& token : node->getArguments()) {clonedArgs.push_back(token.clone());}
-    std::vector<std::unique_ptr<Node>> clonedBody = Node::cloneNodeVector(node->getFunctionBody());
-    std::unique_ptr<FunctionLiteral> funcLiteral = std::make_unique<FunctionLiteral>(
+    // arguments and body are shared with the definition rather than cloned
+    auto funcLiteral = std::make_shared<FunctionLiteral>(
         node->getName(),
-        std::move(clonedArgs),
-        std::move(clonedBody),
+        node->getSharedArguments(),
+        node->getSharedBody(),
         std::move(contextForFunc)
         );
+    funcLiteral->setLocals(node->getLocals());
+    funcLiteral->setCapturedSlots(node->getCapturedSlots());
+    funcLiteral->setSelfSlot(node->getSelfSlot());
+    funcLiteral->setCapturesFrame(node->definesFunctions());
     funcLiteral->setContext(context);
     funcLiteral->setPosition(node->getToken().getPos());
-    std::cout << *funcLiteral->getScopeContext() << std::endl;
-    const std::string funcName = funcLiteral->getName();
-    auto clonedFunc = funcLiteral->clone();
-    clonedFunc->setContext(context);
-    clonedFunc->setPosition(node->getToken().getPos());
-    context->getSymbolTable().set(funcName, std::move(funcLiteral));
-    return clonedFunc;
-}
-
-std::unique_ptr<Literal> Interpreter::visitFuncCallNode(const FuncCall* node, Context* context) {
-    const std::string name = node->getName();
-    Literal* func = context->getSymbolTable().getLiteral(name);
-    const FunctionLiteral* funcLiteral = dynamic_cast<FunctionLiteral*>(func);
-    if (!funcLiteral) {
-        throw VisRunTimeError("function >>> " + name + " <<< called but does not point to a function");
-    }
-    const std::unique_ptr<Literal> funcClone = funcLiteral->clone();
-    FunctionLiteral* concreteFunc = dynamic_cast<FunctionLiteral*>(funcClone.get());
-    concreteFunc->setContext(funcLiteral->getContext());
-    concreteFunc->setPosition(funcLiteral->getPosition());
-    const auto& funcArgs = funcLiteral->getArgs();
+    const Value funcValue(std::shared_ptr<const Literal>(std::move(funcLiteral)));
+    writeVariable(node, context, funcValue);
+    return funcValue;
+}
+
+Value Interpreter::visitFuncCallNode(const FuncCall* node, Context* context) {
+    Value funcValue = findCallee(node, context); // the copy keeps the function alive while it runs
+    const FunctionLiteral* funcLiteral = funcValue.getFunction();
     const auto& passedArgs = node->getArguments();
-    if (funcArgs.size() != passedArgs.size()) {
-        throw VisRunTimeError("function >>> " + name + " <<< was called with incorrect arguments");
+    // lightweight activation frame that lives only for this call, unless the body defines functions that point at it
+    Context stackFrame("");
+    std::shared_ptr<Context> sharedFrame;
+    Context* callContext = &stackFrame;
+    if (funcLiteral->capturesFrame()) {
+        sharedFrame = std::make_shared<Context>("");
+        callContext = sharedFrame.get();
     }
-    for (int i = 0; i < funcArgs.size(); i++) {
-        std::string argName = std::get<std::string>(funcArgs[i].getValue());
-        std::unique_ptr<Literal> value = visit(passedArgs[i], context);
-        if (!value) {throw InterpretError("function argument evaluated to a null ptr");}
-        concreteFunc->getScopeContext()->getSymbolTable().set(argName, std::move(value));
+    callContext->bindFrame(*funcLiteral->getScopeContext(), funcLiteral->getLocals());
+    if (funcLiteral->getSelfSlot() >= 0) {callContext->getSlot(funcLiteral->getSelfSlot()) = funcValue;}
+    for (std::size_t i = 0; i < passedArgs.size(); i++) {
+        bindArgument(*callContext, funcLiteral, i, evaluateArgument(passedArgs[i], context));
     }
-    try {
-        for (const std::unique_ptr<Node>& bodyNode : funcLiteral->getBody()) {
-            visit(bodyNode, concreteFunc->getScopeContext().get());
+    Profiler* profiler = Profiler::getActive();
+    Profiler::Call profiledCall(profiler, funcLiteral->getName(), node->getToken().getPos());
+    executeBlock(funcLiteral->getBody(), callContext);
+    // each tail call rebinds this frame and runs in this loop, so a chain of them never grows the native stack
+    while (callContext->getCompletion() == Completion::TailCall) {
+        funcValue = callContext->takeCompletionValue();
+        funcLiteral = funcValue.getFunction();
+        if (profiler) {profiler->replace(funcLiteral->getName());}
+        if (funcLiteral->capturesFrame() && !sharedFrame) { // only functions defining none make tail calls, so nothing points at the old frame
+            sharedFrame = std::make_shared<Context>("");
+            sharedFrame->getTailArguments().swap(callContext->getTailArguments());
+            callContext = sharedFrame.get();
+        }
+        callContext->bindFrame(*funcLiteral->getScopeContext(), funcLiteral->getLocals());
+        if (funcLiteral->getSelfSlot() >= 0) {callContext->getSlot(funcLiteral->getSelfSlot()) = funcValue;}
+        std::vector<Value>& tailArguments = callContext->getTailArguments();
+        for (std::size_t i = 0; i < tailArguments.size(); i++) {
+            bindArgument(*callContext, funcLiteral, i, std::move(tailArguments[i]));
         }
+        tailArguments.clear();
+        executeBlock(funcLiteral->getBody(), callContext);
     }
-    catch (ReturnSignal& returnSignal) {
-        return returnSignal.getValue();
+    Value result;
+    switch (callContext->getCompletion()) {
+        case Completion::Normal:
+            break;
+        case Completion::Return:
+            result = callContext->takeCompletionValue();
+            break;
+        default:
+            throw VisRunTimeError("function >>> " + funcLiteral->getName() + " <<< left a loop control statement outside of a loop");
     }
-    return nullptr;
+    Context::releaseFrame(sharedFrame, funcLiteral->getCapturedSlots().get());
+    return result;
 }
 
-std::unique_ptr<Literal> Interpreter::visitReturnCallNode(const ReturnCall* node, Context* context) {
-    std::unique_ptr<Literal> returnValue = visit(node->getExpression(), context);
-    throw ReturnSignal(std::move(returnValue));
+Value Interpreter::findCallee(const FuncCall* node, Context* context) {
+    const std::string& name = node->getName();
+    Value funcValue = node->getSlotRef().isResolved()
+        ? context->getResolved(node->getSlotRef())
+        : context->getSymbolTable().getCachedValue(name, node->getCallSiteCache());
+    const FunctionLiteral* funcLiteral = funcValue.getFunction();
+    if (!funcLiteral) {
+        throw VisRunTimeError("function >>> " + name + " <<< called but does not point to a function");
+    }
+    if (funcLiteral->getArgs().size() != node->getArguments().size()) {
+        throw VisRunTimeError("function >>> " + name + " <<< was called with incorrect arguments");
+    }
+    return funcValue;
 }
 
+Value Interpreter::evaluateArgument(const std::unique_ptr<Node>& node, Context* context) {
+    Value value = evaluate(node, context);
+    if (value.isNull()) {throw InterpretError("function argument evaluated to a null ptr");}
+    return value;
+}
 
+void Interpreter::bindArgument(Context& callContext, const FunctionLiteral* funcLiteral, const std::size_t index, Value value) {
+    if (funcLiteral->getLocals()) {
+        callContext.getSlot(static_cast<int>(index)) = std::move(value);
+        return;
+    }
+    const std::string& argName = std::get<std::string>(funcLiteral->getArgs()[index].getValue());
+    callContext.getSymbolTable().set(argName, std::move(value));
+}
 
-
+// return does not unwind, it marks the frame and every enclosing block stops after the current statement
+// a tail call only evaluates its callee and arguments here, the call itself is made by the frame's own call loop
+Value Interpreter::visitReturnCallNode(const ReturnCall* node, Context* context) {
+    if (const auto& expression = node->getExpression(); expression && expression->getType() == NodeType::FuncCall) {
+        if (const auto* callNode = static_cast<const FuncCall*>(expression.get()); callNode->isTailCall()) {
+            Value funcValue = findCallee(callNode, context);
+            std::vector<Value>& tailArguments = context->getTailArguments();
+            for (const std::unique_ptr<Node>& argumentNode : callNode->getArguments()) {
+                tailArguments.push_back(evaluateArgument(argumentNode, context));
+            }
+            if (!context->isInterrupted()) {context->complete(Completion::TailCall, std::move(funcValue));}
+            return Value();
+        }
+    }
+    Value returnValue = node->getExpression() ? evaluate(node->getExpression(), context) : Value();
+    if (!context->isInterrupted()) {context->complete(Completion::Return, std::move(returnValue));}
+    return Value();
+}
@@ -1,8 +1,9 @@
 #include "Lexer.h"
+#include <charconv>
 #include <iostream>
 #include "Error.h"
 
-const std::unordered_set<std::string> Lexer::LIBWORDS = {"out"};
+const std::unordered_set<std::string> Lexer::LIBWORDS = {"out", "flush"};
 const std::unordered_set<std::string> Lexer::KEYWORDS = {
     "var","and","or", "not", "if", "else", "while", "for", "func", "return"
 };
@@ -15,7 +16,7 @@ const char Lexer::COMMENT = '~';
 Lexer::Lexer(PositionHandler& positionHandler) : positionHandler(positionHandler) {}
 
 Token Lexer::makeOperatorToken(const char character) const {
-    const std::map<std::string, std::string> pos = positionHandler.getPos();
+    const Position pos = positionHandler.getPos();
     switch(character) {
         case '+':
             if (positionHandler.peek() == '+') {
@@ -37,73 +38,82 @@ Token Lexer::makeOperatorToken(const char character) const {
     }
 }
 Token Lexer::makeNumberToken (char character) const{// loop through line until next char isnt digit
-    const std::map<std::string, std::string> pos = positionHandler.getPos();
+    const Position pos = positionHandler.getPos();
     bool dotFlag = false;
-    std::string stringNum;
-    stringNum += character;
     char peekChar = this->positionHandler.peek();
     while (peekChar != '\0' and (Lexer::DIGITS.find(peekChar) != std::string::npos or peekChar == '.')){
         character = this->positionHandler.advanceCharacter();
         if (character == '.') {
-            std::map<std::string, std::string> position = positionHandler.getPos();
+            const Position position = positionHandler.getPos();
             if (!dotFlag) {dotFlag = true;}
             else {
                 const std::string word = PositionHandler::getWordFromLine(position);
                 throw IllegalCharError("\nIllegal Number >>> " + word + " <<<\n"+
-                    "on line: " + std::to_string(stoi(position["line"]) + 1) +
-                    " of file: " + position["name"] + "\n" +
-                    "{" + position["lineText"] + "}");
+                    "on line: " + std::to_string(position.line + 1) +
+                    " of file: " + SourceTable::getFileName(position.fileId) + "\n" +
+                    "{" + SourceTable::getLineText(position) + "}");
             }
         }
-        stringNum += character;
         peekChar = this->positionHandler.peek();
     }
+    // the digits are parsed straight out of the source buffer
+    const std::string_view digits = positionHandler.getLineSlice(pos.charPos);
+    std::from_chars_result result{};
+    ValueLiteral value;
     if (dotFlag) {
-        return Token(TokenType::FLOAT, pos, std::stof(stringNum));
+        double floatValue = 0;
+        result = std::from_chars(digits.data(), digits.data() + digits.size(), floatValue);
+        value = floatValue;
     }
     else {
-        return Token(TokenType::INT, pos, std::stoi(stringNum));
+        int intValue = 0;
+        result = std::from_chars(digits.data(), digits.data() + digits.size(), intValue);
+        value = intValue;
     }
+    if (result.ec != std::errc()) {
+        throw IllegalCharError("\nIllegal Number >>> " + std::string(digits) + " <<<\n"+
+            "on line: " + std::to_string(pos.line + 1) +
+            " of file: " + SourceTable::getFileName(pos.fileId) + "\n" +
+            "{" + SourceTable::getLineText(pos) + "}");
+    }
+    return Token(dotFlag ? TokenType::FLOAT : TokenType::INT, pos, std::move(value));
 }
 Token Lexer::makeStringToken (char character) const{
-    const std::map<std::string, std::string> pos = positionHandler.getPos();
-    std::string valueString = "";
+    const Position pos = positionHandler.getPos();
     character = positionHandler.advanceCharacter();
     while (character != '\"') {
         if (character == '\0') {
             throw InvalidSyntaxError(
-                "\nError in file: " + pos.at("name")
-                + "\n>>> line: " + std::to_string(stoi(pos.at("line")) + 1)
-                + " | " + pos.at("lineText") + "<<<"
+                "\nError in file: " + SourceTable::getFileName(pos.fileId)
+                + "\n>>> line: " + std::to_string(pos.line + 1)
+                + " | " + SourceTable::getLineText(pos) + "<<<"
                 + "\nline ended without closing quotation marks"
             );
         }
-        valueString += character;
         character = positionHandler.advanceCharacter();
     }
-    return Token(TokenType::STRING, pos, valueString);
+    const std::string_view quoted = positionHandler.getLineSlice(pos.charPos);
+    return Token(TokenType::STRING, pos, std::string(quoted.substr(1, quoted.size() - 2)));
 }
 Token Lexer::makeIdentifierToken(char character) const{
-    const std::map<std::string, std::string> pos = positionHandler.getPos();
-    std::string identifierString;
-    identifierString += character;
+    const Position pos = positionHandler.getPos();
     do {
         char peekChar = this->positionHandler.peek();
         if (peekChar != '\0' and Lexer::LETTERS_DIGITS.find(peekChar) != std::string::npos) {
-            character = this->positionHandler.advanceCharacter();
-            identifierString += character;
+            this->positionHandler.advanceCharacter();
         }
         else {break;}
     } while (true);
+    std::string identifierString(positionHandler.getLineSlice(pos.charPos));
     if (KEYWORDS.find(identifierString) != KEYWORDS.end() or LIBWORDS.find(identifierString) != LIBWORDS.end()) {
-        return Token(TokenType::KEYWORD, pos, identifierString);
+        return Token(TokenType::KEYWORD, pos, std::move(identifierString));
     }
     else {
-        return Token(TokenType::IDENTIFIER, pos, identifierString);
+        return Token(TokenType::IDENTIFIER, pos, std::move(identifierString));
     }
 }
 Token Lexer::makeEqualsToken(char character) const {
-    const std::map<std::string, std::string> pos = positionHandler.getPos();
+    const Position pos = positionHandler.getPos();
     const char peekChar = this->positionHandler.peek();
     if (peekChar == '=') {
         positionHandler.advanceCharacter();
@@ -114,20 +124,20 @@ Token Lexer::makeEqualsToken(char character) const {
     }
 }
 Token Lexer::makeNotEqualsToken(char character) const {
-    std::map<std::string, std::string> pos = positionHandler.getPos();
+    Position pos = positionHandler.getPos();
     if (const char peekChar = this->positionHandler.peek(); peekChar == '=') {
         positionHandler.advanceCharacter();
         return Token(TokenType::NOTEQUAL, pos);
     }
     else {
-        throw ExpectedCharError("\nOn line: " + std::to_string(stoi(pos["line"]) + 1) +
-        " of file: " + pos["name"] + "\n" +
-        "{" + pos["lineText"] + "}\n" +
+        throw ExpectedCharError("\nOn line: " + std::to_string(pos.line + 1) +
+        " of file: " + SourceTable::getFileName(pos.fileId) + "\n" +
+        "{" + SourceTable::getLineText(pos) + "}\n" +
         "Expected >>> != <<< instead recieved >>> !" + std::string(1, peekChar) + " <<<");
     }
 }
 Token Lexer::makeLessThanToken(char character) const {
-    const std::map<std::string, std::string> pos = positionHandler.getPos();
+    const Position pos = positionHandler.getPos();
     const char peekChar = this->positionHandler.peek();
     if (peekChar == '=') {
         positionHandler.advanceCharacter();
@@ -138,7 +148,7 @@ Token Lexer::makeLessThanToken(char character) const {
     }
 }
 Token Lexer::makeGreaterThanToken(char character) const {
-    const std::map<std::string, std::string> pos = positionHandler.getPos();
+    const Position pos = positionHandler.getPos();
     const char peekChar = this->positionHandler.peek();
     if (peekChar == '=') {
         positionHandler.advanceCharacter();
@@ -149,12 +159,13 @@ Token Lexer::makeGreaterThanToken(char character) const {
     }
 }
 
-std::map<int, std::vector<Token>> Lexer::tokenise() const {
-    std::map<int, std::vector<Token>> tokenDict = {};
+// tokens are appended straight into one flat stream, every source line starts a new line in it
+TokenStream Lexer::tokenise() const {
+    TokenStream tokenStream;
     bool isLine = positionHandler.advanceLine();
     while (isLine) { // loop through lines
-        std::vector<Token> lineTokens = {};
-        std::map<std::string, std::string> pos = positionHandler.getPos();
+        tokenStream.beginLine();
+        Position pos = positionHandler.getPos();
         char currentChar = positionHandler.getChar();
         bool escapeFlag = false;
         while (currentChar != '\0' and not escapeFlag) { // loop through characters
@@ -167,60 +178,60 @@ std::map<int, std::vector<Token>> Lexer::tokenise() const {
                     escapeFlag = true;
                 break;
                 case '(':
-                    lineTokens.emplace_back(TokenType::OPENPAREN, pos);
+                    tokenStream.push(Token(TokenType::OPENPAREN, pos));
                 break;
                 case ')':
-                    lineTokens.emplace_back(TokenType::CLOSEPAREN, pos);
+                    tokenStream.push(Token(TokenType::CLOSEPAREN, pos));
                     break;
                 case '{':
-                    lineTokens.emplace_back(TokenType::OPENBRACE, pos);
+                    tokenStream.push(Token(TokenType::OPENBRACE, pos));
                 break;
                 case '}':
-                    lineTokens.emplace_back(TokenType::CLOSEBRACE, pos);
+                    tokenStream.push(Token(TokenType::CLOSEBRACE, pos));
                 break;
                 case ',':
-                    lineTokens.emplace_back(TokenType::SEPERATOR, pos);
+                    tokenStream.push(Token(TokenType::SEPERATOR, pos));
                 break;
                 case '=':
-                    lineTokens.push_back(makeEqualsToken(currentChar));
+                    tokenStream.push(makeEqualsToken(currentChar));
                 break;
                 case '!':
-                    lineTokens.push_back(makeNotEqualsToken(currentChar));
+                    tokenStream.push(makeNotEqualsToken(currentChar));
                 break;
                 case '<':
-                    lineTokens.push_back(makeLessThanToken(currentChar));
+                    tokenStream.push(makeLessThanToken(currentChar));
                 break;
                 case '>':
-                    lineTokens.push_back(makeGreaterThanToken(currentChar));
+                    tokenStream.push(makeGreaterThanToken(currentChar));
                 break;
                 case '\"':
-                    lineTokens.push_back(makeStringToken(currentChar));
+                    tokenStream.push(makeStringToken(currentChar));
                 break;
                 default:
                     if (OPERATORS.find(currentChar) != std::string::npos) {
-                        lineTokens.push_back(makeOperatorToken(currentChar));
+                        tokenStream.push(makeOperatorToken(currentChar));
                     }
                     else if (DIGITS.find(currentChar) != std::string::npos) {
-                        lineTokens.push_back(makeNumberToken(currentChar));
+                        tokenStream.push(makeNumberToken(currentChar));
                     }
                     else if (LETTERS.find(currentChar) != std::string::npos) {
-                        lineTokens.push_back(makeIdentifierToken(currentChar));
+                        tokenStream.push(makeIdentifierToken(currentChar));
                     }
                     else {
-                        throw IllegalCharError("\nUnrecognized character >>> " + pos["character"] + " <<<" +
+                        throw IllegalCharError("\nUnrecognized character >>> " + std::string(1, currentChar) + " <<<" +
                             " on line: " +
-                            std::to_string(stoi(pos["line"]) + 1) + " of file: " + pos["name"] +
-                            " {" + pos["lineText"] + "}");
+                            std::to_string(pos.line + 1) + " of file: " + SourceTable::getFileName(pos.fileId) +
+                            " {" + SourceTable::getLineText(pos) + "}");
                     }
             }
             currentChar = positionHandler.advanceCharacter(); // advance to next char
         }
-        lineTokens.emplace_back(TokenType::EOL, positionHandler.getPos());
-        tokenDict[positionHandler.getLineNumber()] = lineTokens;
+        tokenStream.push(Token(TokenType::EOL, positionHandler.getPos()));
         isLine = positionHandler.advanceLine();
     }
-    tokenDict[positionHandler.getLineNumber()+1].emplace_back(TokenType::EOF_, PositionHandler::nullPos);
-    return tokenDict;
+    tokenStream.beginLine();
+    tokenStream.push(Token(TokenType::EOF_, PositionHandler::nullPos));
+    return tokenStream;
 }
 
 
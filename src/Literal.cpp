@@ -3,19 +3,23 @@
 //
 
 #include <iostream>
-#include <cmath>
 #include <utility>
 
 
 #include "Context.h"
 #include "Error.h"
+#include "ExecutionStats.h"
 #include "Literal.h"
 #include "PositionHandler.h"
 
 
 //LITERAL DEFINITION
 Literal::Literal() : position(PositionHandler::nullPos), context(nullptr){
+    if (ExecutionStats* stats = ExecutionStats::getActive()) {stats->literalAllocations++;}
+}
 
+Literal::Literal(const Literal& other) : position(other.position), context(other.context) {
+    if (ExecutionStats* stats = ExecutionStats::getActive()) {stats->literalAllocations++;}
 }
 
 void Literal::setContext(Context* context) {
@@ -25,37 +29,9 @@ void Literal::setContext(Context* context) {
 
 Context* Literal::getContext() const {return context;}
 
-void Literal::setPosition(const std::map<std::string, std::string> &pos) {position = pos;}
-
-std::map<std::string, std::string> Literal::getPosition() const {return position;}
-
-std::unique_ptr<Literal> Literal::compareLT(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getNumberValue() < other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> Literal::compareLTE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getNumberValue() <= other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> Literal::compareGT(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getNumberValue() > other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> Literal::compareGTE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getNumberValue() >= other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> Literal::andWith(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getBoolValue() and other.getBoolValue()));
-}
-
-std::unique_ptr<Literal> Literal::orWith(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getBoolValue() or other.getBoolValue()));
-}
+void Literal::setPosition(const Position &pos) {position = pos;}
 
-std::unique_ptr<Literal> Literal::notSelf() const {
-    return setLiteral(std::make_unique<BoolLiteral>(not getBoolValue()));
-}
+Position Literal::getPosition() const {return position;}
 
 std::unique_ptr<Literal> Literal::setLiteral(std::unique_ptr<Literal> literal) const {
     if (context) {literal->setContext(context);}
@@ -96,104 +72,55 @@ std::string BoolLiteral::getStringValue() const {
     return "false";
 }
 
-std::unique_ptr<Literal> BoolLiteral::add(const Literal& other) const {
-    if (const auto* otherBool = dynamic_cast<const BoolLiteral*>(&other)) {
-        return setLiteral(std::make_unique<BoolLiteral>(this->getBoolValue() || otherBool->getBoolValue()));
-    }
-    else {
-        throw VisRunTimeError("cannot add a non boolean value to a boolean value");
-    }
-}
-
-std::unique_ptr<Literal> BoolLiteral::subtract(const Literal& other) const {
-    throw VisRunTimeError("cannot subtract with a bool");
-}
-
-std::unique_ptr<Literal> BoolLiteral::multiply(const Literal& other) const {
-    throw VisRunTimeError("cannot multiply with a bool");
-}
-
-std::unique_ptr<Literal> BoolLiteral::divide(const Literal& other) const {
-    throw VisRunTimeError("cannot divide with a bool");
-}
-
-std::unique_ptr<Literal> BoolLiteral::modulo(const Literal& other) const {
-    throw VisRunTimeError("cannot modulo with a bool");
-}
-
-std::unique_ptr<Literal> BoolLiteral::compareTE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getBoolValue() == other.getBoolValue()));
-}
-
-std::unique_ptr<Literal> BoolLiteral::compareNE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getBoolValue() != other.getBoolValue()));
-}
-
 std::unique_ptr<Literal> BoolLiteral::clone() const {return setLiteral(std::make_unique<BoolLiteral>(*this));}
 
 void BoolLiteral::printLiteral(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "BoolLiteral<" << std::endl;
     os << std::string(tabCount+1, '\t') << "Value: " << getStringValue() << std::endl;
-    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.at("line");
-    os << " | Pos:" << position.at("charPos") << "}" << std::endl;
+    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.line;
+    os << " | Pos:" << position.charPos << "}" << std::endl;
     os << std::string(tabCount, '\t') << "BoolLiteral>" << std::endl;
 }
 
 
 
 //STRING LITERAL DEFINITION
-StringLiteral::StringLiteral(const std::string &value) : Literal(), value(value) {}
+StringLiteral::StringLiteral(std::string value) : Literal(), storage(std::make_shared<std::string>(std::move(value))), length(storage->size()) {}
+
+StringLiteral::StringLiteral(std::shared_ptr<std::string> storage, const std::size_t length) :
+Literal(),
+storage(std::move(storage)),
+length(length) {}
 
 double StringLiteral::getNumberValue() const {
     double sum = 0;
-    for (const char c : value) {
+    for (const char c : getView()) {
         sum += static_cast<int>(c);
     }
     return sum;
 }
 
 bool StringLiteral::getBoolValue() const{
-    return !value.empty();
+    return length != 0;
 }
 
 std::string StringLiteral::getStringValue() const {
-    return value;
-}
-
-std::unique_ptr<Literal> StringLiteral::add(const Literal& other) const {
-    std::unique_ptr<Literal> returnLiteral;
-    if (const auto* otherString = dynamic_cast<const StringLiteral*>(&other)) {
-        std::string combined = this->getStringValue() + otherString->getStringValue();
-        returnLiteral = std::make_unique<StringLiteral>(combined);
-    }
-    else {
-        returnLiteral = std::make_unique<IntLiteral>(this->getNumberValue() + other.getNumberValue());
-    }
-    return setLiteral(std::move(returnLiteral));
-}
-
-std::unique_ptr<Literal> StringLiteral::subtract(const Literal& other) const {
-    return setLiteral(std::make_unique<IntLiteral>(this->getNumberValue() - other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> StringLiteral::multiply(const Literal& other) const {
-    return setLiteral(std::make_unique<IntLiteral>(this->getNumberValue() * other.getNumberValue()));
+    return std::string(getView());
 }
 
-std::unique_ptr<Literal> StringLiteral::divide(const Literal& other) const {
-    return setLiteral(std::make_unique<IntLiteral>(this->getNumberValue() / other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> StringLiteral::modulo(const Literal& other) const {
-    return setLiteral(std::make_unique<IntLiteral>(std::fmod(getNumberValue(), other.getNumberValue())));
-}
+std::string_view StringLiteral::getView() const {return std::string_view(storage->data(), length);}
 
-std::unique_ptr<Literal> StringLiteral::compareTE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getStringValue() == other.getStringValue()));
-}
-
-std::unique_ptr<Literal> StringLiteral::compareNE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getStringValue() != other.getStringValue()));
+// only the literal ending where the storage ends may write past it, older ones copy their prefix to a new storage
+std::shared_ptr<const StringLiteral> StringLiteral::append(const std::string_view tail) const {
+    if (length != storage->size()) {
+        auto copied = std::make_shared<std::string>();
+        copied->reserve(length + tail.size());
+        copied->append(storage->data(), length);
+        copied->append(tail);
+        return std::shared_ptr<const StringLiteral>(new StringLiteral(std::move(copied), length + tail.size()));
+    }
+    storage->append(tail.data(), tail.size()); // tail may view this storage, append reads it before freeing the old block
+    return std::shared_ptr<const StringLiteral>(new StringLiteral(storage, storage->size()));
 }
 
 std::unique_ptr<Literal> StringLiteral::clone() const {return setLiteral(std::make_unique<StringLiteral>(*this));}
@@ -201,8 +128,8 @@ std::unique_ptr<Literal> StringLiteral::clone() const {return setLiteral(std::ma
 void StringLiteral::printLiteral(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "StringLiteral<" << std::endl;
     os << std::string(tabCount+1, '\t') << "Value: " << getStringValue() << std::endl;
-    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.at("line");
-    os << " | Pos:" << position.at("charPos") << "}" << std::endl;
+    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.line;
+    os << " | Pos:" << position.charPos << "}" << std::endl;
     os << std::string(tabCount, '\t') << "StringLiteral>" << std::endl;
 }
 
@@ -211,58 +138,19 @@ void StringLiteral::printLiteral(std::ostream &os, const int tabCount) const {
 //NUMBER LITERAL DEFINITION
 NumberLiteral::NumberLiteral() : Literal(){}
 
-std::unique_ptr<Literal> NumberLiteral::add(const Literal& other) const {
-    return setLiteral(makeResultLiteral(getNumberValue() + other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> NumberLiteral::subtract(const Literal& other) const {
-    return setLiteral(makeResultLiteral(getNumberValue() - other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> NumberLiteral::multiply(const Literal& other) const {
-    return setLiteral(makeResultLiteral(getNumberValue() * other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> NumberLiteral::divide(const Literal& other) const {
-    if (other.getNumberValue() == 0) {
-        throw VisRunTimeError("Division by zero!");
-    }
-    return setLiteral(makeResultLiteral(getNumberValue() / other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> NumberLiteral::modulo(const Literal& other) const {
-    if (other.getNumberValue() == 0) {
-        throw VisRunTimeError("Division by zero!");
-    }
-    return setLiteral(makeResultLiteral(std::fmod(getNumberValue(), other.getNumberValue())));
-}
-
-std::unique_ptr<Literal> NumberLiteral::compareTE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getNumberValue() == other.getNumberValue()));
-}
-
-std::unique_ptr<Literal> NumberLiteral::compareNE(const Literal& other) const {
-    return setLiteral(std::make_unique<BoolLiteral>(getNumberValue() != other.getNumberValue()));
-}
-
 void NumberLiteral::printLiteral(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "NumberLiteral<" << std::endl;
     os << std::string(tabCount, '\t') << "NumberLiteral>" << std::endl;
 }
 
-std::unique_ptr<NumberLiteral> NumberLiteral::makeResultLiteral(float value) {
-    if (std::floor(value) == value) {
-        return std::make_unique<IntLiteral>(static_cast<int>(value));
-    }
-    return std::make_unique<FloatLiteral>(value);
-}
-
 
 
 //INT LITERAL DEFINITION
-IntLiteral::IntLiteral(const int value) : NumberLiteral(), value(value) {}
+IntLiteral::IntLiteral(const std::int64_t value) : NumberLiteral(), value(value) {}
+
+double IntLiteral::getNumberValue() const {return static_cast<double>(value);}
 
-double IntLiteral::getNumberValue() const {return value;}
+std::int64_t IntLiteral::getIntValue() const {return value;}
 
 bool IntLiteral::getBoolValue() const {return value != 0;}
 
@@ -273,15 +161,15 @@ std::unique_ptr<Literal> IntLiteral::clone() const {return std::make_unique<IntL
 void IntLiteral::printLiteral(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "IntLiteral<" << std::endl;
     os << std::string(tabCount+1, '\t') << "Value: " << value << std::endl;
-    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.at("line");
-    os << " | Pos:" << position.at("charPos") << "}" << std::endl;
+    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.line;
+    os << " | Pos:" << position.charPos << "}" << std::endl;
     os << std::string(tabCount, '\t') << "IntLiteral>" << std::endl;
 }
 
 
 
 //FLOAT LITERAL DEFINITION
-FloatLiteral::FloatLiteral(const float value) : NumberLiteral(), value(value){
+FloatLiteral::FloatLiteral(const double value) : NumberLiteral(), value(value){
 }
 
 double FloatLiteral::getNumberValue() const {return value;}
@@ -295,8 +183,8 @@ std::unique_ptr<Literal> FloatLiteral::clone() const {return std::make_unique<Fl
 void FloatLiteral::printLiteral(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "FloatLiteral<" << std::endl;
     os << std::string(tabCount+1, '\t') << "Value: " << value << std::endl;
-    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.at("line");
-    os << " | Pos:" << position.at("charPos") << "}" << std::endl;
+    os << std::string(tabCount+1, '\t') <<"Position: {line: " << position.line;
+    os << " | Pos:" << position.charPos << "}" << std::endl;
     os << std::string(tabCount, '\t') << "FloatLiteral>" << std::endl;
 }
 
@@ -308,6 +196,17 @@ FunctionLiteral::FunctionLiteral(
     std::vector<Token> args,
     std::vector<std::unique_ptr<Node>> body,
     std::unique_ptr<Context> scope) :
+FunctionLiteral(
+    std::move(name),
+    std::make_shared<const std::vector<Token>>(std::move(args)),
+    std::make_shared<const std::vector<std::unique_ptr<Node>>>(std::move(body)),
+    std::move(scope)) {}
+
+FunctionLiteral::FunctionLiteral(
+    std::string name,
+    std::shared_ptr<const std::vector<Token>> args,
+    std::shared_ptr<const std::vector<std::unique_ptr<Node>>> body,
+    std::unique_ptr<Context> scope) :
 Literal(),
 name(std::move(name)),
 argTokens(std::move(args)),
@@ -316,72 +215,69 @@ scopeContext(std::move(scope)) {}
 
 std::string FunctionLiteral::getName() const {return name;}
 
-const std::vector<Token>& FunctionLiteral::getArgs() const {return argTokens;}
+const std::vector<Token>& FunctionLiteral::getArgs() const {return *argTokens;}
 
-const std::vector<std::unique_ptr<Node>>& FunctionLiteral::getBody() const {return bodyNodes;}
+const std::vector<std::unique_ptr<Node>>& FunctionLiteral::getBody() const {return *bodyNodes;}
 
-std::unique_ptr<Literal> FunctionLiteral::add(const Literal &other) const {
-    throw VisRunTimeError("cannot add a function");
+double FunctionLiteral::getNumberValue() const {
+    throw VisRunTimeError("function contains no value");
 }
 
-std::unique_ptr<Literal> FunctionLiteral::subtract(const Literal &other) const {
-    throw VisRunTimeError("cannot subtract a function");
+bool FunctionLiteral::getBoolValue() const {
+    throw VisRunTimeError("function contains no value");
 }
 
-std::unique_ptr<Literal> FunctionLiteral::multiply(const Literal &other) const {
-    throw VisRunTimeError("cannot multiply a function");
+std::string FunctionLiteral::getStringValue() const {
+    throw VisRunTimeError("function contains no value");
 }
 
-std::unique_ptr<Literal> FunctionLiteral::divide(const Literal &other) const {
-    throw VisRunTimeError("cannot divide a function");
-}
+const std::unique_ptr<Context>& FunctionLiteral::getScopeContext() const {return scopeContext;}
 
-std::unique_ptr<Literal> FunctionLiteral::modulo(const Literal &other) const {
-    throw VisRunTimeError("cannot modulus a function");
-}
+void FunctionLiteral::setCode(std::shared_ptr<const FunctionProto> proto) {code = std::move(proto);}
 
-std::unique_ptr<Literal> FunctionLiteral::compareTE(const Literal &other) const {
-    throw VisRunTimeError("cannot compare a function");
-}
+const std::shared_ptr<const FunctionProto>& FunctionLiteral::getCode() const {return code;}
 
-std::unique_ptr<Literal> FunctionLiteral::compareNE(const Literal &other) const {
-    throw VisRunTimeError("cannot compare a function");
+void FunctionLiteral::setLocals(std::shared_ptr<const std::vector<std::string>> localNames) {
+    locals = std::move(localNames);
 }
 
-double FunctionLiteral::getNumberValue() const {
-    throw VisRunTimeError("function contains no value");
-}
+const std::shared_ptr<const std::vector<std::string>>& FunctionLiteral::getLocals() const {return locals;}
 
-bool FunctionLiteral::getBoolValue() const {
-    throw VisRunTimeError("function contains no value");
-}
+void FunctionLiteral::setCapturedSlots(std::shared_ptr<const std::vector<bool>> slots) {capturedSlots = std::move(slots);}
 
-std::string FunctionLiteral::getStringValue() const {
-    throw VisRunTimeError("function contains no value");
-}
+const std::shared_ptr<const std::vector<bool>>& FunctionLiteral::getCapturedSlots() const {return capturedSlots;}
 
-const std::unique_ptr<Context>& FunctionLiteral::getScopeContext() const {return scopeContext;}
+void FunctionLiteral::setSelfSlot(const std::int16_t slot) {selfSlot = slot;}
+
+std::int16_t FunctionLiteral::getSelfSlot() const {return selfSlot;}
+
+void FunctionLiteral::setCapturesFrame(const bool captures) {framesCaptured = captures;}
+
+bool FunctionLiteral::capturesFrame() const {return framesCaptured;}
 
+// arguments and body are immutable so clones share them, only the scope context is copied
 std::unique_ptr<Literal> FunctionLiteral::clone() const {
-    std::vector<Token> clonedArgs;
-    clonedArgs.reserve(this->argTokens.size());
-    for (const Token& token : this->argTokens) {clonedArgs.push_back(token.clone());}
-    std::vector<std::unique_ptr<Node>> clonedBody = Node::cloneNodeVector(bodyNodes);
     std::unique_ptr<Context> clonedContext;
     if (scopeContext) {clonedContext = scopeContext->clone();}
     else {clonedContext = nullptr;}
-    return setLiteral(std::make_unique<FunctionLiteral>(
+    auto clonedFunc = std::make_unique<FunctionLiteral>(
         name,
-        std::move(clonedArgs),
-        std::move(clonedBody),
+        argTokens,
+        bodyNodes,
         std::move(clonedContext)
-    ));
+    );
+    clonedFunc->setCode(code);
+    clonedFunc->setLocals(locals);
+    clonedFunc->setCapturedSlots(capturedSlots);
+    clonedFunc->setSelfSlot(selfSlot);
+    clonedFunc->setCapturesFrame(framesCaptured);
+    return setLiteral(std::move(clonedFunc));
 }
 
 void FunctionLiteral::printLiteral(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "FunctionLiteral<" << std::endl;
     os << std::string(tabCount+1, '\t') << "Name: " << name << std::endl;
-    os << std::string(tabCount+1, '\t') <<"Declared on line: " << stoi(position.at("line"))+1 << std::endl;
+    os << std::string(tabCount+1, '\t') <<"Declared on line: " << position.line+1 << std::endl;
     os << std::string(tabCount, '\t') << "FunctionLiteral>" << std::endl;
 }
 
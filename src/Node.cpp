@@ -1,17 +1,118 @@
 #include <iostream>
 #include <utility>
 #include "Node.h"
+#include "Error.h"
+#include "NodeArena.h"
+
+namespace {
+OperatorKind binaryOperatorKind(const Token& token) {
+    switch (token.getType()) {
+        case TokenType::PLUS: return OperatorKind::Add;
+        case TokenType::MINUS: return OperatorKind::Subtract;
+        case TokenType::MUL: return OperatorKind::Multiply;
+        case TokenType::DIV: return OperatorKind::Divide;
+        case TokenType::MOD: return OperatorKind::Modulo;
+        case TokenType::TRUEEQUALS: return OperatorKind::Equal;
+        case TokenType::NOTEQUAL: return OperatorKind::NotEqual;
+        case TokenType::LESSTHAN: return OperatorKind::Less;
+        case TokenType::LESSEQUAL: return OperatorKind::LessEqual;
+        case TokenType::GREATERTHAN: return OperatorKind::Greater;
+        case TokenType::GREATEREQUAL: return OperatorKind::GreaterEqual;
+        case TokenType::KEYWORD:
+            if (token.matches(TokenType::KEYWORD, "and")) {return OperatorKind::And;}
+            if (token.matches(TokenType::KEYWORD, "or")) {return OperatorKind::Or;}
+        default:
+            throw ParseError("did not recognise token <"
+                + tokenTypeToStr(token.getType())
+                + "> inside binary opertaion instead expected: PLUS, MINUS, MUL, DIV");
+    }
+}
+
+OperatorKind unaryOperatorKind(const Token& token) {
+    if (token.getType() == TokenType::MINUS) {return OperatorKind::Negate;}
+    if (token.matches(TokenType::KEYWORD, "not")) {return OperatorKind::Not;}
+    throw ParseError("unknown operator <"
+            + tokenTypeToStr(token.getType())
+            + "> for unary operation, expected MINUS or KEYWORD<not>");
+}
+
+// rebuilds the token a binary node was made from, only needed to print or clone it
+Token binaryOperatorToken(const OperatorKind kind, const Position& pos) {
+    switch (kind) {
+        case OperatorKind::Add: return Token(TokenType::PLUS, pos);
+        case OperatorKind::Subtract: return Token(TokenType::MINUS, pos);
+        case OperatorKind::Multiply: return Token(TokenType::MUL, pos);
+        case OperatorKind::Divide: return Token(TokenType::DIV, pos);
+        case OperatorKind::Modulo: return Token(TokenType::MOD, pos);
+        case OperatorKind::Equal: return Token(TokenType::TRUEEQUALS, pos);
+        case OperatorKind::NotEqual: return Token(TokenType::NOTEQUAL, pos);
+        case OperatorKind::Less: return Token(TokenType::LESSTHAN, pos);
+        case OperatorKind::LessEqual: return Token(TokenType::LESSEQUAL, pos);
+        case OperatorKind::Greater: return Token(TokenType::GREATERTHAN, pos);
+        case OperatorKind::GreaterEqual: return Token(TokenType::GREATEREQUAL, pos);
+        case OperatorKind::And: return Token(TokenType::KEYWORD, pos, "and");
+        case OperatorKind::Or: return Token(TokenType::KEYWORD, pos, "or");
+        default: throw InterpretError("not a binary operator");
+    }
+}
+}
+
+std::string nodeTypeToStr(const NodeType type) {
+    switch (type) {
+        case NodeType::EndOfFile: return "EndOfFile";
+        case NodeType::Number: return "Number";
+        case NodeType::String: return "String";
+        case NodeType::Operator: return "Operator";
+        case NodeType::UnaryOperator: return "UnaryOperator";
+        case NodeType::BinaryOperator: return "BinaryOperator";
+        case NodeType::VarAssgnment: return "VarAssignment";
+        case NodeType::VarAccess: return "VarAccess";
+        case NodeType::VarIncrement: return "VarIncrement";
+        case NodeType::VarDecrement: return "VarDecrement";
+        case NodeType::LibCall: return "LibCall";
+        case NodeType::IfStmt: return "IfStmt";
+        case NodeType::WhileStmt: return "WhileStmt";
+        case NodeType::ForStmt: return "ForStmt";
+        case NodeType::FuncDef: return "FuncDef";
+        case NodeType::FuncCall: return "FuncCall";
+        case NodeType::ReturnCall: return "ReturnCall";
+        default: return "Unknown";
+    }
+}
 
 //NODE DEFINTITION
-Node::Node(const Token &token, const NodeType type_) : tokenVector(std::vector<Token>{token}), type(type_){}
+Node::Node(const Token &token, const NodeType type_) : token(token), type(type_){}
 
-Token Node::getToken() const {return tokenVector[0];}
+static_assert(alignof(BinaryOperator) <= NodeArena::alignment && alignof(FuncDef) <= NodeArena::alignment
+    && alignof(ForStmt) <= NodeArena::alignment && alignof(IfStmt) <= NodeArena::alignment,
+    "nodes must fit the arena alignment");
+
+// every node is prefixed with the arena it came from, null when it was allocated on the heap
+void* Node::operator new(const std::size_t size) {
+    NodeArena* arena = NodeArena::getActive();
+    void* block = arena ? arena->allocate(size + NodeArena::alignment) : ::operator new(size + NodeArena::alignment);
+    *static_cast<NodeArena**>(block) = arena;
+    return static_cast<std::byte*>(block) + NodeArena::alignment;
+}
+
+// arena nodes are only destroyed here, their memory goes back when the whole arena is released
+void Node::operator delete(void* pointer) {
+    if (!pointer) {return;}
+    void* block = static_cast<std::byte*>(pointer) - NodeArena::alignment;
+    if (*static_cast<NodeArena**>(block) == nullptr) {::operator delete(block);}
+}
+
+const Token& Node::getToken() const {return token;}
 
 NodeType Node::getType() const {return type;}
 
+const SlotRef& Node::getSlotRef() const {return slotRef;}
+
+void Node::setSlotRef(const SlotRef& ref) {slotRef = ref;}
+
 void Node::printNode(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "Node<" << std::endl;
-    os << std::string(tabCount+1, '\t') << tokenVector[0] << std::endl;
+    os << std::string(tabCount+1, '\t') << token << std::endl;
     os << std::string(tabCount, '\t') << "Node>" << std::endl;
 }
 
@@ -48,7 +149,7 @@ Number::Number(const Token &token): Node(token, NodeType::Number) {}
 std::unique_ptr<Node> Number::clone() const {return std::make_unique<Number>(*this);}
 
 void Number::printNode(std::ostream &os, const int tabCount) const {
-    os << std::string(tabCount, '\t') << "Number Node <" << tokenVector[0] << ">" << std::endl;
+    os << std::string(tabCount, '\t') << "Number Node <" << token << ">" << std::endl;
 }
 
 
@@ -59,7 +160,7 @@ StringNode::StringNode(const Token &token): Node(token, NodeType::String) {}
 std::unique_ptr<Node> StringNode::clone() const {return std::make_unique<StringNode>(*this);}
 
 void StringNode::printNode(std::ostream &os, const int tabCount) const {
-    os << std::string(tabCount, '\t') << "String Node <" << tokenVector[0] << ">" << std::endl;
+    os << std::string(tabCount, '\t') << "String Node <" << token << ">" << std::endl;
 }
 
 
@@ -70,7 +171,7 @@ Operator::Operator(const Token &token) : Node(token, NodeType::Operator){}
 std::unique_ptr<Node> Operator::clone() const {return std::make_unique<Operator>(*this);}
 
 void Operator::printNode(std::ostream &os, const int tabCount) const {
-    os << std::string(tabCount, '\t') << "Operator Node <" << tokenVector[0] << ">" << std::endl;
+    os << std::string(tabCount, '\t') << "Operator Node <" << token << ">" << std::endl;
 }
 
 
@@ -78,23 +179,19 @@ void Operator::printNode(std::ostream &os, const int tabCount) const {
 //UNARY OPERATOR DEFINITION
 UnaryOperator::UnaryOperator(const Operator &operator_, std::unique_ptr<Node> node) :
                             Node(operator_.getToken(), NodeType::UnaryOperator),
-                            operatorNode(operator_), valueNode(std::move(node)) {
-    tokenVector = {operatorNode.getToken(), this->valueNode->getToken()};
-}
-
-std::vector<Token> UnaryOperator::getTokens() const {return tokenVector;}
+                            operatorKind(unaryOperatorKind(operator_.getToken())), valueNode(std::move(node)) {}
 
-Operator UnaryOperator::getOperator() const {return operatorNode;}
+OperatorKind UnaryOperator::getOperatorKind() const {return operatorKind;}
 
 const std::unique_ptr<Node>& UnaryOperator::getValue() const {return valueNode;}
 
 std::unique_ptr<Node> UnaryOperator::clone() const {
-    return std::make_unique<UnaryOperator>(operatorNode, valueNode->clone());
+    return std::make_unique<UnaryOperator>(Operator(token), valueNode->clone());
 }
 
 void UnaryOperator::printNode(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "UnaryOpNode<" << std::endl;
-    operatorNode.printNode(os, tabCount+1);
+    Operator(token).printNode(os, tabCount+1);
     valueNode->printNode(os, tabCount+1);
     os << std::string(tabCount, '\t') << "UnaryOpNode>" << std::endl;
 }
@@ -109,23 +206,20 @@ BinaryOperator::BinaryOperator(
     ):
         Node(leftNode->getToken(), NodeType::BinaryOperator),
         leftNode(std::move(leftNode)),
-        operatorNode(operatorNode),
-        rightNode(std::move(rightNode)) {
-    tokenVector = {this->leftNode->getToken(), operatorNode.getToken(), this->rightNode->getToken()};
-}
-
-std::vector<Token> BinaryOperator::getTokens() {return tokenVector;}
+        rightNode(std::move(rightNode)),
+        operatorKind(binaryOperatorKind(operatorNode.getToken())),
+        operatorPos(operatorNode.getToken().getPos()) {}
 
 const std::unique_ptr<Node>& BinaryOperator::getLeftNode() const {return leftNode;}
 
-Operator BinaryOperator::getOperatorNode() const {return operatorNode;}
+OperatorKind BinaryOperator::getOperatorKind() const {return operatorKind;}
 
 const std::unique_ptr<Node>& BinaryOperator::getRightNode() const {return rightNode;}
 
 std::unique_ptr<Node> BinaryOperator::clone() const {
     return std::make_unique<BinaryOperator>(
         leftNode->clone(),
-        operatorNode,
+        Operator(binaryOperatorToken(operatorKind, operatorPos)),
         rightNode->clone()
     );
 }
@@ -133,7 +227,7 @@ std::unique_ptr<Node> BinaryOperator::clone() const {
 void BinaryOperator::printNode(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "BinOpNode<" << std::endl;
     leftNode->printNode(os, tabCount+1);
-    operatorNode.printNode(os, tabCount+1);
+    Operator(binaryOperatorToken(operatorKind, operatorPos)).printNode(os, tabCount+1);
     rightNode->printNode(os, tabCount+1);
     os << std::string(tabCount, '\t') << "BinOpNode>" << std::endl;
 }
@@ -146,12 +240,14 @@ VarAssignment::VarAssignment(const Token &token, std::unique_ptr<Node> value_):
 const std::unique_ptr<Node>& VarAssignment::getValue() const {return value;}
 
 std::unique_ptr<Node> VarAssignment::clone() const {
-    return std::make_unique<VarAssignment>(getToken(), value->clone());
+    auto clonedAssignment = std::make_unique<VarAssignment>(getToken(), value->clone());
+    clonedAssignment->setSlotRef(slotRef);
+    return clonedAssignment;
 }
 
 void VarAssignment::printNode(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "VarAssignNode<" << std::endl;
-    os << std::string(tabCount+1, '\t') << tokenVector[0] << std::endl;
+    os << std::string(tabCount+1, '\t') << token << std::endl;
     value->printNode(os, tabCount+1);
     os << std::string(tabCount, '\t') << "VarAssignNode>" << std::endl;
 }
@@ -313,6 +409,118 @@ const std::unique_ptr<Node> & ForStmt::getStep() const {return step;}
 
 const std::vector<std::unique_ptr<Node>>& ForStmt::getForBlock() const {return forNodes;}
 
+namespace {
+struct LoopBodyUse {
+    bool writesCounter = false;
+    bool writesBound = false;
+    bool readsCounter = false;
+    bool calls = false;
+};
+
+const std::string& nameOf(const Node* node) {return std::get<std::string>(node->getToken().getValue());}
+
+// writes inside nested function bodies land in that function's own scope so only their reads matter
+void scanLoopBody(const Node* node, const std::string& counter, const std::string* bound, LoopBodyUse& use,
+                  const bool nested) {
+    if (!node) {return;}
+    const auto write = [&](const std::string& name) {
+        if (nested) {return;}
+        if (name == counter) {use.writesCounter = true;}
+        if (bound && name == *bound) {use.writesBound = true;}
+    };
+    const auto scanBlock = [&](const std::vector<std::unique_ptr<Node>>& nodes, const bool nestedBlock) {
+        for (const std::unique_ptr<Node>& blockNode : nodes) {scanLoopBody(blockNode.get(), counter, bound, use, nestedBlock);}
+    };
+    switch (node->getType()) {
+        case NodeType::VarAccess:
+            if (nameOf(node) == counter) {use.readsCounter = true;}
+            return;
+        case NodeType::VarIncrement: case NodeType::VarDecrement:
+            if (nameOf(node) == counter) {use.readsCounter = true;}
+            return write(nameOf(node));
+        case NodeType::VarAssgnment:
+            scanLoopBody(static_cast<const VarAssignment*>(node)->getValue().get(), counter, bound, use, nested);
+            return write(nameOf(node));
+        case NodeType::UnaryOperator:
+            return scanLoopBody(static_cast<const UnaryOperator*>(node)->getValue().get(), counter, bound, use, nested);
+        case NodeType::BinaryOperator: {
+            const auto* binaryNode = static_cast<const BinaryOperator*>(node);
+            scanLoopBody(binaryNode->getLeftNode().get(), counter, bound, use, nested);
+            return scanLoopBody(binaryNode->getRightNode().get(), counter, bound, use, nested);
+        }
+        case NodeType::LibCall:
+            return scanBlock(static_cast<const LibCall*>(node)->getArgumentNodes(), nested);
+        case NodeType::FuncCall:
+            use.calls = true; // the callee may read the variable through a closure or as a global
+            if (nameOf(node) == counter) {use.readsCounter = true;}
+            return scanBlock(static_cast<const FuncCall*>(node)->getArguments(), nested);
+        case NodeType::ReturnCall:
+            return scanLoopBody(static_cast<const ReturnCall*>(node)->getExpression().get(), counter, bound, use, nested);
+        case NodeType::IfStmt: {
+            const auto* ifNode = static_cast<const IfStmt*>(node);
+            scanLoopBody(ifNode->getComparison().get(), counter, bound, use, nested);
+            scanBlock(ifNode->getIfBlock(), nested);
+            return scanBlock(ifNode->getElseBlock(), nested);
+        }
+        case NodeType::WhileStmt: {
+            const auto* whileNode = static_cast<const WhileStmt*>(node);
+            scanLoopBody(whileNode->getComparison().get(), counter, bound, use, nested);
+            return scanBlock(whileNode->getWhileBlock(), nested);
+        }
+        case NodeType::ForStmt: {
+            const auto* forNode = static_cast<const ForStmt*>(node);
+            scanLoopBody(forNode->getVarDeclare().get(), counter, bound, use, nested);
+            scanLoopBody(forNode->getCondition().get(), counter, bound, use, nested);
+            scanLoopBody(forNode->getStep().get(), counter, bound, use, nested);
+            return scanBlock(forNode->getForBlock(), nested);
+        }
+        case NodeType::FuncDef:
+            write(nameOf(node));
+            return scanBlock(static_cast<const FuncDef*>(node)->getFunctionBody(), true);
+        default:
+            return;
+    }
+}
+}
+
+const CountedLoop& ForStmt::getCountedLoop() const {
+    if (!loopAnalysed) {
+        countedLoop = analyseCountedLoop();
+        loopAnalysed = true;
+    }
+    return countedLoop;
+}
+
+CountedLoop ForStmt::analyseCountedLoop() const {
+    CountedLoop loop;
+    if (!varDeclare || !condition || !step || varDeclare->getType() != NodeType::VarAssgnment ||
+        condition->getType() != NodeType::BinaryOperator) {return loop;}
+    const std::string& counter = nameOf(varDeclare.get());
+    if ((step->getType() != NodeType::VarIncrement && step->getType() != NodeType::VarDecrement) ||
+        nameOf(step.get()) != counter) {return loop;}
+    const auto* test = static_cast<const BinaryOperator*>(condition.get());
+    const Node* left = test->getLeftNode().get();
+    const Node* right = test->getRightNode().get();
+    if (left->getType() != NodeType::VarAccess || nameOf(left) != counter) {return loop;}
+    const OperatorKind comparison = test->getOperatorKind();
+    if (comparison != OperatorKind::Less && comparison != OperatorKind::LessEqual && comparison != OperatorKind::Greater &&
+        comparison != OperatorKind::GreaterEqual && comparison != OperatorKind::NotEqual) {return loop;}
+    const std::string* bound = nullptr; // a literal bound is invariant by construction
+    if (right->getType() == NodeType::VarAccess) {
+        bound = &nameOf(right);
+        if (*bound == counter) {return loop;}
+    }
+    else if (right->getType() != NodeType::Number) {return loop;}
+    LoopBodyUse use;
+    for (const std::unique_ptr<Node>& bodyNode : forNodes) {scanLoopBody(bodyNode.get(), counter, bound, use, false);}
+    if (use.writesCounter || use.writesBound) {return loop;}
+    loop.counted = true;
+    loop.comparison = comparison;
+    loop.step = step->getType() == NodeType::VarIncrement ? 1 : -1;
+    loop.writesBack = use.readsCounter || use.calls;
+    return loop;
+}
+
 std::unique_ptr<Node> ForStmt::clone() const {
     std::vector<std::unique_ptr<Node>> clonedBody = cloneNodeVector(forNodes);
     return std::make_unique<ForStmt>(
@@ -349,33 +557,59 @@ FuncDef::FuncDef(
     std::vector<std::unique_ptr<Node>> bodyNodes
     ) :
 Node(token, NodeType::FuncDef),
-arguments(std::move(arguments)),
-bodyNodes(std::move(bodyNodes)) {}
+arguments(std::make_shared<const std::vector<Token>>(std::move(arguments))),
+bodyNodes(std::make_shared<std::vector<std::unique_ptr<Node>>>(std::move(bodyNodes))) {} // left non const for the ConstantFolder
+
+const std::string& FuncDef::getName() const {return std::get<std::string>(getToken().getValue());}
+
+const std::vector<Token>& FuncDef::getArguments() const {return *arguments;}
+
+const std::shared_ptr<const std::vector<Token>>& FuncDef::getSharedArguments() const {return arguments;}
 
-std::string FuncDef::getName() const {return std::get<std::string>(getToken().getValue());}
+const std::vector<std::unique_ptr<Node>> & FuncDef::getFunctionBody() const {return *bodyNodes;}
 
-const std::vector<Token>& FuncDef::getArguments() const {return arguments;}
+const std::shared_ptr<const std::vector<std::unique_ptr<Node>>>& FuncDef::getSharedBody() const {return bodyNodes;}
 
-const std::vector<std::unique_ptr<Node>> & FuncDef::getFunctionBody() const {return bodyNodes;}
+const std::shared_ptr<const std::vector<std::string>>& FuncDef::getLocals() const {return locals;}
+
+void FuncDef::setLocals(std::shared_ptr<const std::vector<std::string>> localNames) {locals = std::move(localNames);}
+
+const std::shared_ptr<const std::vector<bool>>& FuncDef::getCapturedSlots() const {return capturedSlots;}
+
+void FuncDef::setCapturedSlots(std::shared_ptr<const std::vector<bool>> slots) {capturedSlots = std::move(slots);}
+
+std::int16_t FuncDef::getSelfSlot() const {return selfSlot;}
+
+void FuncDef::setSelfSlot(const std::int16_t slot) {selfSlot = slot;}
+
+bool FuncDef::definesFunctions() const {return hasFunctionDefinitions;}
+
+void FuncDef::setDefinesFunctions(const bool defines) {hasFunctionDefinitions = defines;}
 
 std::unique_ptr<Node> FuncDef::clone() const {
     std::vector<Token> clonedArgs = {};
-    clonedArgs.reserve(this->arguments.size());
-    for (const Token& token : this->arguments) {clonedArgs.push_back(token.clone());}
-    std::vector<std::unique_ptr<Node>> clonedBody = cloneNodeVector(bodyNodes);
-    return std::make_unique<FuncDef>(getToken(), std::move(clonedArgs), std::move(clonedBody));
+    clonedArgs.reserve(arguments->size());
+    for (const Token& token : *arguments) {clonedArgs.push_back(token.clone());}
+    std::vector<std::unique_ptr<Node>> clonedBody = cloneNodeVector(*bodyNodes);
+    auto clonedDef = std::make_unique<FuncDef>(getToken(), std::move(clonedArgs), std::move(clonedBody));
+    clonedDef->setSlotRef(slotRef);
+    clonedDef->setLocals(locals);
+    clonedDef->setCapturedSlots(capturedSlots);
+    clonedDef->setSelfSlot(selfSlot);
+    clonedDef->setDefinesFunctions(hasFunctionDefinitions);
+    return clonedDef;
 }
 
 void FuncDef::printNode(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "FunctionDeclerationNode<" << std::endl;
     os << std::string(tabCount+1, '\t') << "Name: " << std::get<std::string>(getToken().getValue()) << std::endl;
     os << std::string(tabCount+1, '\t') << "Arguments<" << std::endl;
-    for (const auto& token : arguments) {
+    for (const auto& token : *arguments) {
         os << std::string(tabCount+2, '\t') << "Name: " << std::get<std::string>(token.getValue()) << std::endl;
     }
     os << std::string(tabCount+1, '\t') << "Arguments>" << std::endl;
     os << std::string(tabCount+1, '\t') << "StatementNodes<" << std::endl;
-    for (const auto& node : bodyNodes) {node->printNode(os, tabCount+2);}
+    for (const auto& node : *bodyNodes) {node->printNode(os, tabCount+2);}
     os << std::string(tabCount+1, '\t') << "StatementNodes>" << std::endl;
     os << std::string(tabCount, '\t') << "FunctionDeclerationNode>" << std::endl;
 }
@@ -388,22 +622,30 @@ FuncCall::FuncCall(
     std::vector<std::unique_ptr<Node>> argumentNodes
     ) :
 Node(token, NodeType::FuncCall),
-name(std::get<std::string>(getToken().getValue())),
 argumentNodes(std::move(argumentNodes)) {}
 
-std::string FuncCall::getName() const {return name;}
+const std::string& FuncCall::getName() const {return std::get<std::string>(token.getValue());}
 
 const std::vector<std::unique_ptr<Node>> & FuncCall::getArguments() const {return argumentNodes;}
 
+CallSiteCache& FuncCall::getCallSiteCache() const {return callSiteCache;}
+
+bool FuncCall::isTailCall() const {return tailCall;}
+
+void FuncCall::setTailCall(const bool tail) {tailCall = tail;}
+
 std::unique_ptr<Node> FuncCall::clone() const {
     std::vector<std::unique_ptr<Node>> clonedArgs = cloneNodeVector(argumentNodes);
 
-    return std::make_unique<FuncCall>(getToken(), std::move(clonedArgs));
+    auto clonedCall = std::make_unique<FuncCall>(getToken(), std::move(clonedArgs));
+    clonedCall->setSlotRef(slotRef);
+    clonedCall->setTailCall(tailCall);
+    return clonedCall;
 }
 
 void FuncCall::printNode(std::ostream &os, const int tabCount) const {
     os << std::string(tabCount, '\t') << "FunctionCallNode<" << std::endl;
-    os << std::string(tabCount+1, '\t') << "Name: " << name << std::endl;
+    os << std::string(tabCount+1, '\t') << "Name: " << getName() << std::endl;
     os << std::string(tabCount+1, '\t') << "Arguments<" << std::endl;
     for (const auto& node : argumentNodes) {node->printNode(os, tabCount+2);}
     os << std::string(tabCount+1, '\t') << "Arguments>" << std::endl;
@@ -421,7 +663,7 @@ expression(std::move(expressionNode)){
 const std::unique_ptr<Node> & ReturnCall::getExpression() const {return expression;}
 
 std::unique_ptr<Node> ReturnCall::clone() const {
-    return std::make_unique<ReturnCall>(getToken(), expression->clone());
+    return std::make_unique<ReturnCall>(getToken(), expression ? expression->clone() : nullptr);
 }
 
 void ReturnCall::printNode(std::ostream &os, const int tabCount) const {
@@ -0,0 +1,68 @@
+#include <iterator>
+
+#include "NodeArena.h"
+
+thread_local NodeArena* NodeArena::active = nullptr;
+
+NodeArena::NodeArena(const std::size_t blockSize) : blockSize(blockSize), offset(0), capacity(0), bytesUsed(0),
+adoptedBytes(0) {}
+
+// oversized requests get a block of their own so the current block keeps its free space
+void* NodeArena::allocate(std::size_t size) {
+    size = (size + alignment - 1) & ~(alignment - 1);
+    bytesUsed += size;
+    if (size > blockSize) {
+        largeBlocks.push_back(std::unique_ptr<std::byte[]>(new std::byte[size]));
+        return largeBlocks.back().get();
+    }
+    if (offset + size > capacity) {
+        blocks.push_back(std::unique_ptr<std::byte[]>(new std::byte[blockSize])); // left uninitialised, nodes construct over it
+        offset = 0;
+        capacity = blockSize;
+    }
+    void* result = blocks.back().get() + offset;
+    offset += size;
+    return result;
+}
+
+NodeArena::Mark NodeArena::getMark() const {return Mark{blocks.size(), largeBlocks.size(), offset, bytesUsed};}
+
+// drops everything allocated after the mark, only valid once the nodes living there have been destroyed
+void NodeArena::rewind(const Mark& mark) {
+    largeBlocks.resize(mark.largeBlockCount);
+    bytesUsed = mark.bytesUsed;
+    if (blocks.size() <= mark.blockCount) {
+        offset = mark.offset;
+        return;
+    }
+    if (mark.blockCount == 0) { // keep the first block around for the next statement
+        blocks.resize(1);
+        offset = 0;
+        return;
+    }
+    blocks.resize(mark.blockCount);
+    offset = mark.offset;
+}
+
+// used for nodes parsed on other threads, their blocks move over as they are so the nodes stay where they are
+void NodeArena::adopt(NodeArena&& other) {
+    for (std::vector<std::unique_ptr<std::byte[]>>* source : {&other.blocks, &other.largeBlocks, &other.adoptedBlocks}) {
+        std::move(source->begin(), source->end(), std::back_inserter(adoptedBlocks));
+        source->clear();
+    }
+    adoptedBytes += other.bytesUsed + other.adoptedBytes;
+    other.offset = 0;
+    other.capacity = 0;
+    other.bytesUsed = 0;
+    other.adoptedBytes = 0;
+}
+
+std::size_t NodeArena::getBytesUsed() const {return bytesUsed + adoptedBytes;}
+
+std::size_t NodeArena::getBlockCount() const {return blocks.size() + largeBlocks.size() + adoptedBlocks.size();}
+
+NodeArena* NodeArena::getActive() {return active;}
+
+NodeArena::Scope::Scope(NodeArena& arena) : previous(active) {active = &arena;}
+
+NodeArena::Scope::~Scope() {active = previous;}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+#include "OutputBuffer.h"
+#include "Error.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define VIS_HAS_ISATTY
+#endif
+
+thread_local OutputBuffer* OutputBuffer::active = nullptr;
+
+OutputBuffer::OutputBuffer(std::ostream& target, const bool lineBuffered, const std::size_t capacity) :
+target(&target),
+lineBuffered(lineBuffered),
+capacity(std::max(capacity, numberSpace)),
+buffer(std::make_unique<char[]>(this->capacity)) {}
+
+OutputBuffer::~OutputBuffer() {flush();}
+
+// makes room for length more bytes, returns null when the text is too long to ever fit and must bypass the buffer
+char* OutputBuffer::reserve(const std::size_t length) {
+    if (capacity - size < length) {
+        flush();
+        if (length > capacity) {return nullptr;}
+    }
+    return buffer.get() + size;
+}
+
+void OutputBuffer::write(const std::string_view text) {
+    char* destination = reserve(text.size());
+    if (!destination) {
+        target->write(text.data(), static_cast<std::streamsize>(text.size()));
+        return;
+    }
+    std::memcpy(destination, text.data(), text.size());
+    size += text.size();
+}
+
+// floats keep the six fixed decimals std::to_string gave them so output is unchanged
+void OutputBuffer::write(const Value& value) {
+    switch (value.getType()) {
+        case ValueType::Bool:
+            write(value.getBoolValue() ? std::string_view("true") : std::string_view("false"));
+            return;
+        case ValueType::Int: case ValueType::Float: {
+            char* destination = reserve(numberSpace);
+            const std::to_chars_result result = value.getType() == ValueType::Int
+                ? std::to_chars(destination, destination + numberSpace, value.getIntValue())
+                : std::to_chars(destination, destination + numberSpace, value.getNumberValue(), std::chars_format::fixed, 6);
+            if (result.ec != std::errc()) {throw InterpretError("number too wide for the output buffer");}
+            size = static_cast<std::size_t>(result.ptr - buffer.get());
+            return;
+        }
+        case ValueType::String:
+            write(value.getStringView());
+            return;
+        default:
+            write(value.getStringValue()); // throws the same errors as before for functions and null
+    }
+}
+
+void OutputBuffer::endLine() {
+    write(std::string_view("\n"));
+    if (lineBuffered) {flush();}
+}
+
+void OutputBuffer::flush() {
+    if (size > 0) {
+        target->write(buffer.get(), static_cast<std::streamsize>(size));
+        size = 0;
+    }
+    target->flush();
+}
+
+OutputBuffer::StreamAdapter::int_type OutputBuffer::StreamAdapter::overflow(const int_type character) {
+    if (traits_type::eq_int_type(character, traits_type::eof())) {return traits_type::not_eof(character);}
+    const char text = traits_type::to_char_type(character);
+    output.write(std::string_view(&text, 1));
+    return character;
+}
+
+std::streamsize OutputBuffer::StreamAdapter::xsputn(const char* text, const std::streamsize count) {
+    output.write(std::string_view(text, static_cast<std::size_t>(count)));
+    return count;
+}
+
+// std::endl lands here, so a line buffered listing still appears line by line
+int OutputBuffer::StreamAdapter::sync() {
+    if (output.lineBuffered) {output.flush();}
+    return 0;
+}
+
+OutputBuffer& OutputBuffer::current() {
+    if (active) {return *active;}
+    static thread_local OutputBuffer standardOutput(std::cout, true);
+    return standardOutput;
+}
+
+bool OutputBuffer::isInteractive() {
+#ifdef VIS_HAS_ISATTY
+    return isatty(STDOUT_FILENO) != 0;
+#else
+    return false;
+#endif
+}
+
+OutputBuffer::Scope::Scope(OutputBuffer* output) : previous(active) {active = output;}
+
+OutputBuffer::Scope::~Scope() {active = previous;}
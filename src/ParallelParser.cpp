@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "ParallelParser.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+#include "WorkerThreads.h"
+
+namespace {
+bool startsFunction(const std::string_view line) {
+    const std::size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos || line.compare(start, 4, "func") != 0) {return false;}
+    const std::size_t after = start + 4;
+    return after == line.size() || !(std::isalnum(static_cast<unsigned char>(line[after])) || line[after] == '_');
+}
+}
+
+ParallelParser::ParallelParser(const std::string& fileName, std::shared_ptr<const SourceBuffer> source,
+    const unsigned threadCount, const std::size_t pieceSize) :
+ParallelParser(SourceTable::registerFile(fileName, source), source, threadCount, pieceSize) {}
+
+ParallelParser::ParallelParser(const std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source,
+    const unsigned threadCount, std::size_t pieceSize) :
+source(std::move(source)),
+fileId(fileId),
+threadCount(std::max(threadCount, 1u)) {
+    if (pieceSize == 0) {pieceSize = std::max<std::size_t>(this->source->size() / (this->threadCount * 4), 1);}
+    for (const Piece& piece : split(this->source->getText(), pieceSize)) {
+        results.push_back(PieceResult{piece, {}, nullptr, {}, nullptr});
+    }
+    runOnThreads(results.size(), this->threadCount, [this](const std::size_t index) {
+        PieceResult& result = results[index];
+        try {
+            PositionHandler positionHandler(this->fileId, this->source, result.piece.text, result.piece.firstLine);
+            result.tokenStream = Lexer(positionHandler).tokenise();
+        }
+        catch (...) {result.error = std::current_exception();}
+    });
+    for (const PieceResult& result : results) {
+        if (result.error) {std::rethrow_exception(result.error);}
+    }
+}
+
+// pieces are parsed into arenas of their own that the caller's arena takes over once every thread has finished
+void ParallelParser::parsePieces() {
+    parsed = true;
+    NodeArena* callerArena = NodeArena::getActive();
+    runOnThreads(results.size(), threadCount, [this, callerArena](const std::size_t index) {
+        PieceResult& result = results[index];
+        std::optional<NodeArena::Scope> arenaScope; // without a caller arena nodes go on the heap as usual
+        if (callerArena) {
+            result.arena = std::make_unique<NodeArena>();
+            arenaScope.emplace(*result.arena);
+        }
+        try {
+            Parser parser(std::move(result.tokenStream));
+            while (true) {
+                std::unique_ptr<Node> nodeTree = parser.parse();
+                if (!nodeTree) {continue;}
+                if (nodeTree->getType() == NodeType::EndOfFile) {break;}
+                result.statements.push_back(std::move(nodeTree));
+            }
+        }
+        catch (...) {result.error = std::current_exception();}
+    });
+    if (callerArena) {
+        for (PieceResult& result : results) {callerArena->adopt(std::move(*result.arena));}
+    }
+}
+
+std::unique_ptr<Node> ParallelParser::parse() {
+    if (!parsed) {parsePieces();}
+    while (pieceIndex < results.size()) {
+        PieceResult& result = results[pieceIndex];
+        if (statementIndex < result.statements.size()) {return std::move(result.statements[statementIndex++]);}
+        if (result.error) {
+            pieceIndex = results.size();
+            std::rethrow_exception(result.error);
+        }
+        pieceIndex++;
+        statementIndex = 0;
+    }
+    return std::make_unique<EndOfFile>(Token(TokenType::EOF_, PositionHandler::nullPos));
+}
+
+std::size_t ParallelParser::getPieceCount() const {return results.size();}
+
+// change in brace and parenthesis depth over one line, skipping strings and comments the way the lexer does
+int ParallelParser::depthChange(const std::string_view line) {
+    int change = 0;
+    for (std::size_t index = 0; index < line.size(); index++) {
+        switch (line[index]) {
+            case '~': return change;
+            case '"': {
+                const std::size_t close = line.find('"', index + 1);
+                if (close == std::string_view::npos) {return change;}
+                index = close;
+                break;
+            }
+            case '{': case '(': change++; break;
+            case '}': case ')': change--; break;
+            default: break;
+        }
+    }
+    return change;
+}
+
+// a piece ends before a func line once it holds pieceSize bytes, unbalanced input is kept in one piece from there on
+std::vector<ParallelParser::Piece> ParallelParser::split(const std::string_view text, const std::size_t pieceSize) {
+    std::vector<Piece> pieces;
+    std::size_t pieceStart = 0;
+    int pieceFirstLine = 0;
+    std::size_t lineStart = 0;
+    int line = 0;
+    int depth = 0;
+    while (lineStart < text.size()) {
+        std::size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {lineEnd = text.size();}
+        const std::string_view lineText = text.substr(lineStart, lineEnd - lineStart);
+        if (depth == 0 && lineStart - pieceStart >= pieceSize && lineStart > pieceStart && startsFunction(lineText)) {
+            pieces.push_back(Piece{text.substr(pieceStart, lineStart - pieceStart), pieceFirstLine});
+            pieceStart = lineStart;
+            pieceFirstLine = line;
+        }
+        if (depth >= 0) {depth += depthChange(lineText);}
+        lineStart = lineEnd + 1;
+        line++;
+    }
+    pieces.push_back(Piece{text.substr(pieceStart), pieceFirstLine});
+    return pieces;
+}
+
+unsigned ParallelParser::chooseThreadCount(const std::size_t sourceSize) {
+    if (sourceSize < minimumSourceSize) {return 1;}
+    const std::size_t worthwhile = sourceSize / minimumPieceSize;
+    return static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(), worthwhile)));
+}
@@ -13,39 +13,59 @@
 #include "Token.h"
 
 
-Parser::Parser(std::map<int, std::vector<Token>> tokenizedFile):
-lineIndex(-1),
-tokenIndex(-1),
-tokenDict(std::move(tokenizedFile)),
-tokenVector(tokenizedFile[lineIndex]),
+// the parser takes ownership of the stream and walks it in place, tokens are never copied per line
+Parser::Parser(TokenStream tokenStream):
+lineIndex(0),
+tokenIndex(0),
+lineBegin(0),
+lineEnd(0),
+tokenStream(std::move(tokenStream)),
 currentToken(nullptr) {
-    advanceLine();
+    if (this->tokenStream.lineCount() > 0) {
+        lineEnd = this->tokenStream.lineEnd(0);
+        if (lineBegin < lineEnd) {currentToken = &this->tokenStream[0];}
+    }
 }
 
 bool Parser::advanceLine() { // returns true if advanced
-    if (lineIndex+1 > tokenDict.rbegin()->first) {
+    if (lineIndex + 1 >= tokenStream.lineCount()) {
         return false;
     }
     lineIndex++;
-    tokenIndex = -1;
-    tokenVector = tokenDict[lineIndex];
-    advanceToken();
+    lineBegin = tokenStream.lineStart(lineIndex);
+    lineEnd = tokenStream.lineEnd(lineIndex);
+    tokenIndex = lineBegin;
+    if (tokenIndex < lineEnd) {currentToken = &tokenStream[tokenIndex];}
     return true;
 }
 
-Token* Parser::advanceToken() {
-    tokenIndex++;
-    if ( tokenIndex < tokenVector.size()) {
-        currentToken = &tokenVector[tokenIndex];
+const Token* Parser::advanceToken() {
+    if (tokenIndex < lineEnd) {tokenIndex++;}
+    if (tokenIndex < lineEnd) {
+        currentToken = &tokenStream[tokenIndex];
     }
     return currentToken;
 }
 
+// once the end of file is reached only the EOF token is kept, the rest of the stream is freed
+void Parser::releaseTokens() {
+    TokenStream remaining;
+    remaining.beginLine();
+    remaining.push(*currentToken);
+    tokenStream = std::move(remaining);
+    lineIndex = 0;
+    tokenIndex = 0;
+    lineBegin = 0;
+    lineEnd = 1;
+    currentToken = &tokenStream[0];
+}
+
 std::unique_ptr<Node> Parser::parse() {
     std::unique_ptr<Node> returnNode = nullptr;
-    if (!tokenVector.empty()) {
+    if (lineBegin < lineEnd) {
         if (currentToken->getType() == TokenType::EOF_) {
             returnNode = std::make_unique<EndOfFile>(*currentToken);
+            if (tokenStream.size() > 1) {releaseTokens();}
         }
         else if (currentToken->matches(TokenType::KEYWORD, "func")) {
             returnNode = funcDef();
@@ -60,12 +80,12 @@ std::unique_ptr<Node> Parser::parse() {
     return returnNode;
 }
 
-InvalidSyntaxError Parser::makeSyntaxError(std::map<std::string, std::string> position,
+InvalidSyntaxError Parser::makeSyntaxError(const Position &position,
                                             const std::string &expectedType) {
     std::ostringstream oss;
-    oss << "\nError in file: " << position["name"]
-    << "\n>>> line: " << std::to_string(stoi(position["line"]) + 1)
-    << " | " << position["lineText"] << "<<<"
+    oss << "\nError in file: " << SourceTable::getFileName(position.fileId)
+    << "\n>>> line: " << std::to_string(position.line + 1)
+    << " | " << SourceTable::getLineText(position) << "<<<"
     << "\nexpected >>> " << expectedType << " <<< "
     << "instead recieved >>> " << PositionHandler::getWordFromLine(position) << " <<<";
     return InvalidSyntaxError(oss.str());
@@ -353,7 +373,7 @@ std::unique_ptr<Node> Parser::compExpr() {
 
 std::unique_ptr<Node> Parser::comparision() {
     if (currentToken->matches(TokenType::KEYWORD, "not")) {
-        Token* opToken = currentToken;
+        const Token* opToken = currentToken;
         advanceToken();
         std::unique_ptr<Node> valueNode = comparision();
         return std::make_unique<UnaryOperator>(Operator(*opToken), std::move(valueNode));
@@ -380,7 +400,7 @@ std::unique_ptr<Node> Parser::term() {
 }
 
 std::unique_ptr<Node> Parser::factor() {
-    Token* token = currentToken;
+    const Token* token = currentToken;
     if (token->getType() == TokenType::PLUS or token->getType() == TokenType::MINUS) {
         advanceToken();
         std::unique_ptr<Node> valueNode = call();
@@ -411,7 +431,7 @@ std::unique_ptr<Node> Parser::call() {
 }
 
 std::unique_ptr<Node> Parser::atom() {
-    Token* token = currentToken;
+    const Token* token = currentToken;
     if (token->getType() == TokenType::EOL) {
         advanceLine();
         return nullptr;
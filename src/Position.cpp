@@ -0,0 +1,80 @@
+#include "Position.h"
+
+// file id 0 is reserved for positions that do not point into a file
+std::vector<SourceTable::SourceFile> SourceTable::files = {SourceFile{"null", {}, {}}};
+std::vector<std::uint32_t> SourceTable::releasedIds;
+std::mutex SourceTable::filesMutex;
+
+bool operator==(const Position& left, const Position& right) {
+    return left.fileId == right.fileId && left.line == right.line && left.charPos == right.charPos;
+}
+
+bool operator!=(const Position& left, const Position& right) {return !(left == right);}
+
+void SourceTable::indexLines(const SourceBuffer& source, std::vector<std::string_view>& lines) {
+    const std::string_view text = source.getText();
+    for (std::size_t lineStart = 0; lineStart < text.size();) {
+        std::size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {lineEnd = text.size();}
+        lines.push_back(text.substr(lineStart, lineEnd - lineStart));
+        lineStart = lineEnd + 1;
+    }
+}
+
+// lines are indexed up front, outside the lock, so lexers on other threads never write to the table
+std::uint32_t SourceTable::registerFile(const std::string& fileName, std::shared_ptr<const SourceBuffer> source) {
+    std::vector<std::string_view> lines;
+    std::vector<std::shared_ptr<const SourceBuffer>> sources;
+    if (source) {
+        indexLines(*source, lines);
+        sources.push_back(std::move(source));
+    }
+    const std::lock_guard<std::mutex> lock(filesMutex);
+    if (!releasedIds.empty()) {
+        const std::uint32_t fileId = releasedIds.back();
+        releasedIds.pop_back();
+        files[fileId] = SourceFile{fileName, std::move(sources), std::move(lines)};
+        return fileId;
+    }
+    files.push_back(SourceFile{fileName, std::move(sources), std::move(lines)});
+    return static_cast<std::uint32_t>(files.size() - 1);
+}
+
+int SourceTable::appendSource(const std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source) {
+    std::vector<std::string_view> lines;
+    indexLines(*source, lines);
+    const std::lock_guard<std::mutex> lock(filesMutex);
+    if (fileId == 0 || fileId >= files.size()) {return 0;}
+    SourceFile& file = files[fileId];
+    const int firstLine = static_cast<int>(file.lines.size());
+    file.lines.insert(file.lines.end(), lines.begin(), lines.end());
+    file.sources.push_back(std::move(source));
+    return firstLine;
+}
+
+void SourceTable::releaseFile(const std::uint32_t fileId) {
+    const std::lock_guard<std::mutex> lock(filesMutex);
+    if (fileId == 0 || fileId >= files.size()) {return;}
+    files[fileId] = SourceFile{"null", {}, {}};
+    releasedIds.push_back(fileId);
+}
+
+std::string SourceTable::getFileName(const std::uint32_t fileId) {
+    const std::lock_guard<std::mutex> lock(filesMutex);
+    if (fileId >= files.size()) {return "null";}
+    return files[fileId].name;
+}
+
+std::string SourceTable::getLineText(const Position& pos) {
+    const std::lock_guard<std::mutex> lock(filesMutex);
+    if (pos.fileId >= files.size()) {return "";}
+    const std::vector<std::string_view>& lines = files[pos.fileId].lines;
+    if (pos.line < 0 || pos.line >= static_cast<int>(lines.size())) {return "";}
+    return std::string(lines[pos.line]);
+}
+
+SourceRegistration::SourceRegistration(const std::uint32_t fileId) : fileId(fileId) {}
+
+SourceRegistration::~SourceRegistration() {SourceTable::releaseFile(fileId);}
+
+std::uint32_t SourceRegistration::getFileId() const {return fileId;}
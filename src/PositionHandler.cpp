@@ -1,23 +1,41 @@
 #include <string>
 #include "PositionHandler.h"
-#include <fstream>
 #include <utility>
 
-const std::map<std::string, std::string> PositionHandler::nullPos = {
-    {"name", "null"},
-    {"line", "null"},
-    {"charPos", "null"},
-    {"lineText", "null"},
-    {"character", "null"}
-};
+const Position PositionHandler::nullPos = Position{};
 
-PositionHandler::PositionHandler(std::string fileName, std::istream &file):
-file(file),
+PositionHandler::PositionHandler(std::string fileName, std::shared_ptr<const SourceBuffer> source):
+source(std::move(source)),
+text(this->source->getText()),
+lineStart(0),
+nextLineStart(0),
 charPos(-1),
 currentChar('\0'),
 line(-1),
+firstLine(0),
+fileId(SourceTable::registerFile(fileName, this->source)),
 fileName(std::move(fileName)) {}
 
+PositionHandler::PositionHandler(const std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source,
+    const std::string_view piece, const int firstLine):
+source(std::move(source)),
+text(piece),
+lineStart(0),
+nextLineStart(0),
+charPos(-1),
+currentChar('\0'),
+line(firstLine - 1),
+firstLine(firstLine),
+fileId(fileId),
+fileName(SourceTable::getFileName(fileId)) {}
+
+PositionHandler::PositionHandler(const std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source):
+PositionHandler(fileId, source, source->getText(), 0) {}
+
+// streams have no backing file to map so they are read into memory up front
+PositionHandler::PositionHandler(std::string fileName, std::istream &file):
+PositionHandler(std::move(fileName), SourceBuffer::fromStream(file)) {}
+
 // advance to the next character
 char PositionHandler::advanceCharacter() {
     if (charPos < static_cast<int>(lineText.length()) - 1) {
@@ -32,16 +50,16 @@ char PositionHandler::advanceCharacter() {
 
 // advance to the next line returns false if line dosent exist
 bool PositionHandler::advanceLine() {
-    if (!file) return false; // Stream might already be in bad state
-
-    if (std::getline(file, lineText)) {
-        line++;
-        charPos = 0;
-        currentChar = lineText.empty() ? '\0' : lineText[charPos];
-        return true;
-    }
-
-    return false; // No file.close() — not needed for istream
+    if (nextLineStart >= text.size()) {return false;}
+    lineStart = nextLineStart;
+    std::size_t lineEnd = text.find('\n', lineStart);
+    if (lineEnd == std::string_view::npos) {lineEnd = text.size();}
+    nextLineStart = lineEnd + 1;
+    lineText = text.substr(lineStart, lineEnd - lineStart);
+    line++;
+    charPos = 0;
+    currentChar = lineText.empty() ? '\0' : lineText[charPos];
+    return true;
 }
 
 // returns next character without advancing
@@ -53,17 +71,16 @@ char PositionHandler::peek() const{
 // reset position
 void PositionHandler::resetPos() {
     charPos = -1;
-    line = -1;
+    line = firstLine - 1;
     currentChar = '\0';
-    lineText.clear();
+    lineStart = 0;
+    nextLineStart = 0;
+    lineText = {};
 }
 
-std::string PositionHandler::getWordFromLine(const std::map<std::string, std::string>& pos) {
-    const auto lineTextIt = pos.find("lineText");
-    const auto charPosIt = pos.find("charPos");
-    if (lineTextIt == pos.end() || charPosIt == pos.end()) {return "";}
-    const std::string& lineText = lineTextIt->second;
-    const int position = std::stoi(charPosIt->second);
+std::string PositionHandler::getWordFromLine(const Position& pos) {
+    const std::string lineText = SourceTable::getLineText(pos);
+    const int position = pos.charPos;
     if (position < 0 || position >= static_cast<int>(lineText.length())) {return "";}
     auto isWordChar = [](char c) {
         return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
@@ -84,12 +101,13 @@ char PositionHandler::getChar() const {return currentChar;}
 int PositionHandler::getLineNumber() const {return line;}
 
 // get current position details
-std::map<std::string, std::string> PositionHandler::getPos() const {
-    return {
-            {"name", fileName},
-            {"line", std::to_string(line)},
-            {"charPos", std::to_string(charPos)},
-            {"lineText", lineText},
-            {"character", std::string(1, currentChar)}
-    };
+Position PositionHandler::getPos() const {return Position{fileId, line, charPos};}
+
+// view of the current line from startPos up to and including the current character
+std::string_view PositionHandler::getLineSlice(const int startPos) const {
+    return lineText.substr(startPos, charPos - startPos + 1);
 }
+
+std::size_t PositionHandler::getOffset() const {return lineStart + charPos;}
+
+std::size_t PositionHandler::getSourceSize() const {return text.size();}
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+#include "Profiler.h"
+
+thread_local Profiler* Profiler::active = nullptr;
+
+Profiler::Profiler(std::string rootName, const std::uint32_t sampleInterval) :
+sampleInterval(std::max<std::uint32_t>(sampleInterval, 1)),
+countdown(this->sampleInterval) {
+    functionNames.push_back(std::move(rootName));
+    functionCalls.push_back(0);
+    functionIds.emplace(functionNames.back(), 0);
+    frames.push_back(Frame{0});
+}
+
+// recursion and loops call the same function over and over, so the last one is compared before hashing
+std::uint32_t Profiler::internFunction(const std::string& function) {
+    if (functionNames[lastFunction] == function) {return lastFunction;}
+    const auto [entry, inserted] = functionIds.try_emplace(function, static_cast<std::uint32_t>(functionNames.size()));
+    if (inserted) {
+        functionNames.push_back(function);
+        functionCalls.push_back(0);
+    }
+    lastFunction = entry->second;
+    return lastFunction;
+}
+
+// the caller stays at the call site's line until the callee leaves
+void Profiler::enter(const std::string& function, const Position& callSite) {
+    frames.back().fileId = callSite.fileId;
+    frames.back().line = callSite.line;
+    const std::uint32_t id = internFunction(function);
+    functionCalls[id]++;
+    frames.push_back(Frame{id});
+}
+
+void Profiler::replace(const std::string& function) {
+    const std::uint32_t id = internFunction(function);
+    functionCalls[id]++;
+    frames.back() = Frame{id};
+}
+
+void Profiler::leave() {
+    if (frames.size() > 1) {frames.pop_back();}
+}
+
+void Profiler::pause() {
+    charge();
+    running = false;
+}
+
+void Profiler::resume() {
+    running = true;
+    last = std::chrono::steady_clock::now();
+}
+
+void Profiler::sample(const Position& pos) {
+    countdown = sampleInterval;
+    frames.back().fileId = pos.fileId;
+    frames.back().line = pos.line;
+    charge();
+}
+
+void Profiler::charge() {
+    if (!running) {return;}
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    callTree[currentNode()].self += now - last;
+    last = now;
+}
+
+// frames under the top are suspended at their call site, so only the frames above the deepest still valid one are looked up
+std::uint32_t Profiler::currentNode() {
+    std::size_t valid = frames.size();
+    while (valid > 0 && (frames[valid - 1].node == noNode || frames[valid - 1].nodeLine != frames[valid - 1].line)) {
+        valid--;
+    }
+    std::uint32_t node = valid == 0 ? noNode : frames[valid - 1].node;
+    for (std::size_t i = valid; i < frames.size(); i++) {
+        node = childNode(node, frames[i]);
+        frames[i].node = node;
+        frames[i].nodeLine = frames[i].line;
+    }
+    return node;
+}
+
+std::uint32_t Profiler::childNode(const std::uint32_t parent, const Frame& frame) {
+    const auto [entry, inserted] = children.try_emplace(ChildKey{parent, frame.function, frame.line},
+        static_cast<std::uint32_t>(callTree.size()));
+    if (inserted) {callTree.push_back(CallNode{parent, frame.function, Position{frame.fileId, frame.line, -1}});}
+    return entry->second;
+}
+
+// inclusive time counts a recursive function or line once per stack, however many frames it has on it
+std::vector<Profiler::FunctionProfile> Profiler::getFunctionProfiles() const {
+    std::vector<FunctionProfile> profiles(functionNames.size());
+    for (std::size_t i = 0; i < functionNames.size(); i++) {
+        profiles[i].name = functionNames[i];
+        profiles[i].calls = functionCalls[i];
+    }
+    std::vector<std::size_t> seenAt(functionNames.size(), SIZE_MAX);
+    for (std::size_t i = 0; i < callTree.size(); i++) {
+        const std::chrono::nanoseconds self = callTree[i].self;
+        if (self.count() == 0) {continue;}
+        profiles[callTree[i].function].exclusive += self;
+        for (std::uint32_t node = static_cast<std::uint32_t>(i); node != noNode; node = callTree[node].parent) {
+            if (seenAt[callTree[node].function] == i) {continue;}
+            seenAt[callTree[node].function] = i;
+            profiles[callTree[node].function].inclusive += self;
+        }
+    }
+    std::stable_sort(profiles.begin(), profiles.end(), [](const FunctionProfile& left, const FunctionProfile& right) {
+        return left.exclusive != right.exclusive ? left.exclusive > right.exclusive : left.inclusive > right.inclusive;
+    });
+    return profiles;
+}
+
+std::vector<Profiler::LineProfile> Profiler::getLineProfiles() const {
+    std::vector<LineProfile> profiles;
+    std::unordered_map<std::uint64_t, std::size_t> lineIndex;
+    std::vector<std::size_t> seenAt;
+    const auto profileFor = [&](const Position& position) -> std::size_t {
+        const std::uint64_t key = static_cast<std::uint64_t>(position.fileId) << 32 | static_cast<std::uint32_t>(position.line);
+        const auto [entry, inserted] = lineIndex.try_emplace(key, profiles.size());
+        if (inserted) {
+            profiles.push_back(LineProfile{Position{position.fileId, position.line, -1}});
+            seenAt.push_back(SIZE_MAX);
+        }
+        return entry->second;
+    };
+    for (std::size_t i = 0; i < callTree.size(); i++) {
+        const std::chrono::nanoseconds self = callTree[i].self;
+        if (callTree[i].position.line < 0) {continue;}
+        profiles[profileFor(callTree[i].position)].exclusive += self;
+        for (std::uint32_t node = static_cast<std::uint32_t>(i); node != noNode; node = callTree[node].parent) {
+            if (callTree[node].position.line < 0) {continue;}
+            const std::size_t line = profileFor(callTree[node].position);
+            if (seenAt[line] == i) {continue;}
+            seenAt[line] = i;
+            profiles[line].inclusive += self;
+        }
+    }
+    std::stable_sort(profiles.begin(), profiles.end(), [](const LineProfile& left, const LineProfile& right) {
+        return left.exclusive != right.exclusive ? left.exclusive > right.exclusive : left.inclusive > right.inclusive;
+    });
+    return profiles;
+}
+
+// frames are written as name:line, stacks that were never charged any time are left out
+void Profiler::writeCollapsedStacks(std::ostream& os) const {
+    std::vector<std::uint32_t> path;
+    for (std::size_t i = 0; i < callTree.size(); i++) {
+        if (callTree[i].self.count() == 0) {continue;}
+        path.clear();
+        for (std::uint32_t node = static_cast<std::uint32_t>(i); node != noNode; node = callTree[node].parent) {
+            path.push_back(node);
+        }
+        for (auto node = path.rbegin(); node != path.rend(); ++node) {
+            if (node != path.rbegin()) {os << ';';}
+            os << functionNames[callTree[*node].function];
+            if (callTree[*node].position.line >= 0) {os << ':' << callTree[*node].position.line + 1;}
+        }
+        os << ' ' << callTree[i].self.count() << '\n';
+    }
+}
+
+void Profiler::print(std::ostream& os, const std::string& title) const {
+    constexpr std::size_t shownLines = 20;
+    const auto milliseconds = [](const std::chrono::nanoseconds time) {
+        return std::chrono::duration<double, std::milli>(time).count();
+    };
+    std::ostringstream report;
+    report << "profile for " << title << std::endl << std::fixed << std::setprecision(3);
+    report << "  " << std::left << std::setw(24) << "function" << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "incl (ms)" << std::setw(14) << "excl (ms)" << std::endl;
+    for (const FunctionProfile& profile : getFunctionProfiles()) {
+        report << "  " << std::left << std::setw(24) << profile.name << std::right << std::setw(12) << profile.calls
+            << std::setw(14) << milliseconds(profile.inclusive) << std::setw(14) << milliseconds(profile.exclusive)
+            << std::endl;
+    }
+    const std::vector<LineProfile> lines = getLineProfiles();
+    report << "  " << std::left << std::setw(24) << "line" << std::right << std::setw(12) << ""
+        << std::setw(14) << "incl (ms)" << std::setw(14) << "excl (ms)" << std::endl;
+    for (std::size_t i = 0; i < lines.size() && i < shownLines; i++) {
+        std::string text = SourceTable::getLineText(lines[i].position);
+        text.erase(0, text.find_first_not_of(" \t"));
+        report << "  " << std::left << std::setw(36) << lines[i].position.line + 1 << std::right
+            << std::setw(14) << milliseconds(lines[i].inclusive) << std::setw(14) << milliseconds(lines[i].exclusive)
+            << "  | " << text << std::endl;
+    }
+    os << report.str();
+}
+
+Profiler::Scope::Scope(Profiler* profiler) : previous(active) {active = profiler;}
+
+Profiler::Scope::~Scope() {active = previous;}
+
+Profiler::Call::Call(Profiler* profiler, const std::string& function, const Position& callSite) : profiler(profiler) {
+    if (profiler) {profiler->enter(function, callSite);}
+}
+
+Profiler::Call::~Call() {
+    if (profiler) {profiler->leave();}
+}
@@ -0,0 +1,432 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ProgramFile.h"
+#include "Compiler.h"
+#include "ConstantFolder.h"
+#include "Error.h"
+#include "Lexer.h"
+#include "NodeArena.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+#include "Resolver.h"
+
+namespace {
+constexpr char magic[4] = {'V', 'I', 'S', 'C'};
+
+class ProgramWriter {
+public:
+    explicit ProgramWriter(std::string& bytes) : bytes(bytes) {}
+    template <typename T>
+    void raw(const T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void string(const std::string& text) {
+        raw(static_cast<std::uint32_t>(text.size()));
+        bytes.append(text);
+    }
+    void position(const Position& pos) {
+        raw(pos.line);
+        raw(pos.charPos);
+    }
+    void token(const Token& token) {
+        raw(static_cast<std::uint8_t>(token.getType()));
+        position(token.getPos());
+        const ValueLiteral& value = token.getValue();
+        raw(static_cast<std::uint8_t>(value.index()));
+        if (const auto* boolValue = std::get_if<bool>(&value)) {raw(static_cast<std::uint8_t>(*boolValue));}
+        else if (const auto* intValue = std::get_if<int>(&value)) {raw(*intValue);}
+        else if (const auto* doubleValue = std::get_if<double>(&value)) {raw(*doubleValue);}
+        else if (const auto* stringValue = std::get_if<std::string>(&value)) {string(*stringValue);}
+    }
+    void constant(const Value& value) {
+        raw(static_cast<std::uint8_t>(value.getType()));
+        switch (value.getType()) {
+            case ValueType::Bool: raw(static_cast<std::uint8_t>(value.getBoolValue())); break;
+            case ValueType::Int: raw(value.getIntValue()); break;
+            case ValueType::Float: raw(value.getNumberValue()); break;
+            case ValueType::String: string(value.getStringValue()); break;
+            default: throw ProgramFileError("cannot store a " + valueTypeToStr(value.getType()) + " constant");
+        }
+    }
+    void chunk(const Chunk& chunk) {
+        raw(static_cast<std::uint32_t>(chunk.code.size()));
+        for (std::size_t i = 0; i < chunk.code.size(); i++) {
+            raw(static_cast<std::uint8_t>(chunk.code[i].op));
+            raw(chunk.code[i].count);
+            raw(chunk.code[i].operand);
+            position(chunk.positions[i]);
+        }
+        raw(static_cast<std::uint32_t>(chunk.constants.size()));
+        for (const Value& value : chunk.constants) {constant(value);}
+        raw(static_cast<std::uint32_t>(chunk.names.size()));
+        for (const std::string& name : chunk.names) {string(name);}
+        raw(static_cast<std::uint32_t>(chunk.functions.size()));
+        for (const std::shared_ptr<FunctionProto>& proto : chunk.functions) {
+            string(proto->name);
+            position(proto->position);
+            raw(static_cast<std::uint32_t>(proto->args->size()));
+            for (const Token& argument : *proto->args) {token(argument);}
+            raw(static_cast<std::uint8_t>(proto->locals != nullptr));
+            if (proto->locals) {
+                raw(static_cast<std::uint32_t>(proto->locals->size()));
+                for (const std::string& local : *proto->locals) {string(local);}
+                for (std::size_t j = 0; j < proto->locals->size(); j++) {
+                    raw(static_cast<std::uint8_t>(!proto->capturedSlots || (*proto->capturedSlots)[j]));
+                }
+                raw(proto->selfSlot);
+            }
+            this->chunk(proto->chunk);
+        }
+    }
+private:
+    std::string& bytes;
+};
+
+// every read is bounds checked, a truncated file throws instead of reading past the mapping
+class ProgramReader {
+public:
+    ProgramReader(const std::string_view bytes, const std::uint32_t fileId) : bytes(bytes), fileId(fileId) {}
+    template <typename T>
+    T raw() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+    std::string string() {
+        const auto length = raw<std::uint32_t>();
+        return std::string(take(length), length);
+    }
+    Position position() {
+        Position pos{fileId};
+        pos.line = raw<std::int32_t>();
+        pos.charPos = raw<std::int32_t>();
+        return pos;
+    }
+    Token token() {
+        const auto type = static_cast<TokenType>(raw<std::uint8_t>());
+        const Position pos = position();
+        switch (raw<std::uint8_t>()) {
+            case 0: return Token(type, pos);
+            case 1: return Token(type, pos, raw<std::uint8_t>() != 0);
+            case 2: return Token(type, pos, raw<int>());
+            case 3: return Token(type, pos, raw<double>());
+            case 4: return Token(type, pos, string());
+            default: throw ProgramFileError("unknown token value");
+        }
+    }
+    Value constant() {
+        switch (static_cast<ValueType>(raw<std::uint8_t>())) {
+            case ValueType::Bool: return Value(raw<std::uint8_t>() != 0);
+            case ValueType::Int: return Value(raw<std::int64_t>());
+            case ValueType::Float: return Value(raw<double>());
+            case ValueType::String: return Value(std::shared_ptr<const Literal>(std::make_shared<StringLiteral>(string())));
+            default: throw ProgramFileError("unknown constant type");
+        }
+    }
+    void chunk(Chunk& chunk) {
+        const auto codeSize = raw<std::uint32_t>();
+        chunk.code.reserve(codeSize);
+        chunk.positions.reserve(codeSize);
+        for (std::uint32_t i = 0; i < codeSize; i++) {
+            const auto op = raw<std::uint8_t>();
+            if (op > static_cast<std::uint8_t>(OpCode::RETURN_NULL)) {throw ProgramFileError("unknown instruction");}
+            const auto count = raw<std::uint16_t>();
+            const auto operand = raw<std::int32_t>();
+            chunk.code.push_back(Instruction{static_cast<OpCode>(op), count, operand});
+            chunk.positions.push_back(position());
+        }
+        const auto constantCount = raw<std::uint32_t>();
+        chunk.constants.reserve(constantCount);
+        for (std::uint32_t i = 0; i < constantCount; i++) {chunk.constants.push_back(constant());}
+        const auto nameCount = raw<std::uint32_t>();
+        chunk.names.reserve(nameCount);
+        for (std::uint32_t i = 0; i < nameCount; i++) {chunk.names.push_back(string());}
+        chunk.callSiteCaches.resize(nameCount);
+        const auto functionCount = raw<std::uint32_t>();
+        for (std::uint32_t i = 0; i < functionCount; i++) {
+            auto proto = std::make_shared<FunctionProto>();
+            proto->name = string();
+            proto->position = position();
+            const auto argumentCount = raw<std::uint32_t>();
+            std::vector<Token> arguments;
+            for (std::uint32_t j = 0; j < argumentCount; j++) {arguments.push_back(token());}
+            proto->args = std::make_shared<const std::vector<Token>>(std::move(arguments));
+            if (raw<std::uint8_t>() != 0) {
+                const auto localCount = raw<std::uint32_t>();
+                std::vector<std::string> locals;
+                for (std::uint32_t j = 0; j < localCount; j++) {locals.push_back(string());}
+                proto->locals = std::make_shared<const std::vector<std::string>>(std::move(locals));
+                std::vector<bool> capturedSlots;
+                for (std::uint32_t j = 0; j < localCount; j++) {capturedSlots.push_back(raw<std::uint8_t>() != 0);}
+                proto->capturedSlots = std::make_shared<const std::vector<bool>>(std::move(capturedSlots));
+                proto->selfSlot = raw<std::int16_t>();
+                if (proto->selfSlot < -1 || proto->selfSlot >= static_cast<std::int64_t>(localCount)) {
+                    throw ProgramFileError("function " + proto->name + " binds itself outside its locals");
+                }
+            }
+            enclosingLocals.push_back(proto->locals ? proto->locals->size() : 0);
+            this->chunk(proto->chunk);
+            enclosingLocals.pop_back();
+            chunk.functions.push_back(std::move(proto));
+        }
+        verify(chunk);
+    }
+    [[nodiscard]] bool atEnd() const {return offset == bytes.size();}
+private:
+    std::string_view bytes;
+    std::size_t offset = 0;
+    std::uint32_t fileId;
+    std::vector<std::size_t> enclosingLocals; // slot counts of the functions around the chunk being read, innermost last
+
+    // values an instruction needs on the stack and how many it leaves in their place
+    static std::pair<std::size_t, std::size_t> stackEffect(const Instruction& instruction) {
+        switch (instruction.op) {
+            case OpCode::POP: case OpCode::JUMP_IF_FALSE: case OpCode::OUT_VALUE: case OpCode::RETURN:
+                return {1, 0};
+            case OpCode::DUP:
+                return {1, 2};
+            case OpCode::SET_VAR: case OpCode::SET_LOCAL: case OpCode::NEGATE: case OpCode::NOT: case OpCode::FOR_STEP:
+                return {1, 1};
+            case OpCode::ADD: case OpCode::SUBTRACT: case OpCode::MULTIPLY: case OpCode::DIVIDE: case OpCode::MODULO:
+            case OpCode::COMPARE_TE: case OpCode::COMPARE_NE: case OpCode::COMPARE_LT: case OpCode::COMPARE_LTE:
+            case OpCode::COMPARE_GT: case OpCode::COMPARE_GTE: case OpCode::AND: case OpCode::OR:
+                return {2, 1};
+            case OpCode::FOR_TEST:
+                return {2, 2};
+            case OpCode::CALL: case OpCode::TAIL_CALL:
+                return {instruction.count, 1};
+            case OpCode::CALL_VALUE: case OpCode::TAIL_CALL_VALUE:
+                return {instruction.count + 1, 1};
+            case OpCode::JUMP: case OpCode::RETURN_NULL:
+                return {0, 0};
+            default:
+                return {0, 1};
+        }
+    }
+
+    // the vm trusts its bytecode, so every operand has to point into the chunk's own tables, every jump has to land
+    // inside the chunk and no path through it may pop more values than it pushed
+    void verify(const Chunk& chunk) const {
+        const std::size_t codeSize = chunk.code.size();
+        const auto inRange = [](const std::int32_t operand, const std::size_t size) {
+            return operand >= 0 && static_cast<std::size_t>(operand) < size;
+        };
+        for (const Instruction& instruction : chunk.code) {
+            bool valid = true;
+            switch (instruction.op) {
+                case OpCode::CONSTANT:
+                    valid = inRange(instruction.operand, chunk.constants.size());
+                    break;
+                case OpCode::GET_VAR: case OpCode::SET_VAR: case OpCode::INCREMENT_VAR: case OpCode::DECREMENT_VAR:
+                case OpCode::CALL: case OpCode::CALL_VALUE: case OpCode::TAIL_CALL: case OpCode::TAIL_CALL_VALUE:
+                    valid = inRange(instruction.operand, chunk.names.size());
+                    break;
+                case OpCode::MAKE_FUNCTION:
+                    valid = inRange(instruction.operand, chunk.functions.size());
+                    break;
+                case OpCode::GET_LOCAL: case OpCode::SET_LOCAL: case OpCode::INCREMENT_LOCAL: case OpCode::DECREMENT_LOCAL:
+                    valid = instruction.count < enclosingLocals.size() &&
+                        inRange(instruction.operand, enclosingLocals[enclosingLocals.size() - 1 - instruction.count]);
+                    break;
+                case OpCode::FOR_TEST:
+                    valid = instruction.count >= static_cast<std::uint16_t>(OpCode::COMPARE_TE) &&
+                        instruction.count <= static_cast<std::uint16_t>(OpCode::COMPARE_GTE) &&
+                        inRange(instruction.operand, codeSize + 1);
+                    break;
+                case OpCode::JUMP: case OpCode::JUMP_IF_FALSE: case OpCode::FOR_STEP:
+                    valid = inRange(instruction.operand, codeSize + 1); // the end of the chunk is a valid target
+                    break;
+                default:
+                    break;
+            }
+            if (!valid) {throw ProgramFileError(opCodeToStr(instruction.op) + " instruction has an invalid operand");}
+        }
+        // lowest stack height each instruction can be reached with, lowering an entry walks its successors again
+        constexpr std::size_t unreached = static_cast<std::size_t>(-1);
+        std::vector<std::size_t> heights(codeSize + 1, unreached);
+        std::vector<std::size_t> pending{0};
+        heights[0] = 0;
+        while (!pending.empty()) {
+            const std::size_t ip = pending.back();
+            pending.pop_back();
+            if (ip == codeSize) {continue;}
+            const Instruction& instruction = chunk.code[ip];
+            const auto [needed, pushed] = stackEffect(instruction);
+            if (heights[ip] < needed) {throw ProgramFileError(opCodeToStr(instruction.op) + " instruction pops an empty stack");}
+            const std::size_t height = heights[ip] - needed + pushed;
+            const auto reach = [&heights, &pending, height](const std::size_t target) {
+                if (heights[target] == unreached || height < heights[target]) {
+                    heights[target] = height;
+                    pending.push_back(target);
+                }
+            };
+            switch (instruction.op) {
+                case OpCode::TAIL_CALL: case OpCode::TAIL_CALL_VALUE: case OpCode::RETURN: case OpCode::RETURN_NULL:
+                    break;
+                case OpCode::JUMP: case OpCode::FOR_STEP:
+                    reach(instruction.operand);
+                    break;
+                case OpCode::JUMP_IF_FALSE: case OpCode::FOR_TEST:
+                    reach(instruction.operand);
+                    reach(ip + 1);
+                    break;
+                default:
+                    reach(ip + 1);
+            }
+        }
+    }
+    const char* take(const std::size_t length) {
+        if (bytes.size() - offset < length) {throw ProgramFileError("file is truncated");}
+        const char* data = bytes.data() + offset;
+        offset += length;
+        return data;
+    }
+};
+
+// header: magic, format version, source hash, payload hash, then the source name and the payload itself
+constexpr std::size_t headerSize = sizeof(magic) + sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+}
+
+bool ProgramFile::isProgram(const std::string_view bytes) {
+    return bytes.size() >= sizeof(magic) && std::memcmp(bytes.data(), magic, sizeof(magic)) == 0;
+}
+
+std::uint64_t ProgramFile::hashBytes(const std::string_view bytes) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const char character : bytes) {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// mirrors Interpreter::interpretFile without running anything, so a syntax error anywhere in the file is reported
+Chunk ProgramFile::compile(const std::string& filename) {
+    std::shared_ptr<const SourceBuffer> source = SourceBuffer::fromFile(filename);
+    if (!source) {throw std::runtime_error("Error: Could not open file: " + filename);}
+    return compile(filename, std::move(source));
+}
+
+Chunk ProgramFile::compile(const std::string& sourceName, std::shared_ptr<const SourceBuffer> source) {
+    const SourceRegistration sourceFile(SourceTable::registerFile(sourceName, source));
+    return compile(sourceFile.getFileId(), std::move(source));
+}
+
+Chunk ProgramFile::compile(const std::uint32_t fileId, std::shared_ptr<const SourceBuffer> source) {
+    NodeArena nodeArena;
+    NodeArena::Scope arenaScope(nodeArena);
+    PositionHandler positionHandler(fileId, std::move(source));
+    Parser parser(Lexer(positionHandler).tokenise());
+    Chunk chunk;
+    Compiler compiler(chunk);
+    ConstantFolder constantFolder;
+    Resolver resolver;
+    std::vector<std::unique_ptr<Node>> functionDefinitions; // kept until the end like the interpreter keeps them
+    while (true) {
+        const NodeArena::Mark statementMark = nodeArena.getMark();
+        std::unique_ptr<Node> nodeTree = parser.parse();
+        if (!nodeTree) {continue;}
+        if (nodeTree->getType() == NodeType::EndOfFile) {break;}
+        constantFolder.fold(nodeTree);
+        resolver.resolve(nodeTree);
+        compiler.compile(nodeTree);
+        if (nodeTree->getType() == NodeType::FuncDef) {functionDefinitions.push_back(std::move(nodeTree));}
+        else {
+            nodeTree.reset();
+            nodeArena.rewind(statementMark);
+        }
+    }
+    return chunk;
+}
+
+void ProgramFile::write(std::ostream& os, const Chunk& chunk, const std::uint64_t sourceHash, const std::string& sourceName) {
+    std::string payload;
+    ProgramWriter payloadWriter(payload);
+    payloadWriter.string(sourceName);
+    payloadWriter.chunk(chunk);
+    std::string header;
+    ProgramWriter headerWriter(header);
+    header.append(magic, sizeof(magic));
+    headerWriter.raw(formatVersion);
+    headerWriter.raw(sourceHash);
+    headerWriter.raw(hashBytes(payload));
+    os.write(header.data(), static_cast<std::streamsize>(header.size()));
+    os.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if (!os) {throw ProgramFileError("could not write program");}
+}
+
+// written to a temporary file first and renamed into place, so a concurrent run or batch job never maps half a program
+void ProgramFile::save(const std::string& path, const Chunk& chunk, const std::uint64_t sourceHash,
+    const std::string& sourceName) {
+    const std::filesystem::path target(path);
+    std::error_code error;
+    if (target.has_parent_path()) {std::filesystem::create_directories(target.parent_path(), error);}
+    const std::string temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+        "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) {throw ProgramFileError("could not create " + temporary);}
+        write(file, chunk, sourceHash, sourceName);
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw ProgramFileError("could not write " + path);
+    }
+}
+
+// the stored source name is skipped, a cached program is shared by every file with the same text so positions are
+// stamped with the file the caller is running instead
+Chunk ProgramFile::read(const std::string_view bytes, const std::uint64_t expectedHash, const std::uint32_t fileId) {
+    if (!isProgram(bytes) || bytes.size() < headerSize) {throw ProgramFileError("not a compiled VIS program");}
+    ProgramReader header(bytes.substr(sizeof(magic), headerSize - sizeof(magic)), 0);
+    if (header.raw<std::uint32_t>() != formatVersion) {throw ProgramFileError("compiled by a different VIS version");}
+    if (const auto sourceHash = header.raw<std::uint64_t>(); expectedHash != 0 && sourceHash != expectedHash) {
+        throw ProgramFileError("compiled from a different source");
+    }
+    const std::string_view payload = bytes.substr(headerSize);
+    if (header.raw<std::uint64_t>() != hashBytes(payload)) {throw ProgramFileError("file is corrupt");}
+    ProgramReader nameReader(payload, 0);
+    const std::size_t nameSize = sizeof(std::uint32_t) + nameReader.string().size();
+    ProgramReader reader(payload.substr(nameSize), fileId);
+    Chunk chunk;
+    reader.chunk(chunk);
+    if (!reader.atEnd()) {throw ProgramFileError("unexpected data after the program");}
+    return chunk;
+}
+
+std::string ProgramFile::cachePath(const std::string& cacheDirectory, const std::uint64_t sourceHash) {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << sourceHash << ".visc";
+    return (std::filesystem::path(cacheDirectory) / name.str()).string();
+}
+
+// VIS_CACHE_DIR wins and may be set empty to turn caching off, then the platform's per user cache directory
+std::string ProgramFile::defaultCacheDirectory() {
+    if (const char* directory = std::getenv("VIS_CACHE_DIR")) {return directory;}
+    if (const char* directory = std::getenv("XDG_CACHE_HOME"); directory && *directory) {
+        return (std::filesystem::path(directory) / "vis").string();
+    }
+#ifdef _WIN32
+    if (const char* directory = std::getenv("LOCALAPPDATA"); directory && *directory) {
+        return (std::filesystem::path(directory) / "vis").string();
+    }
+#else
+    if (const char* directory = std::getenv("HOME"); directory && *directory) {
+        return (std::filesystem::path(directory) / ".cache" / "vis").string();
+    }
+#endif
+    return "";
+}
@@ -0,0 +1,128 @@
+#include <cctype>
+#include <string_view>
+
+#include "Repl.h"
+#include "ConstantFolder.h"
+#include "Lexer.h"
+#include "ParallelParser.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+#include "Resolver.h"
+
+namespace {
+std::string_view trimStart(const std::string_view text) {
+    const std::size_t start = text.find_first_not_of(" \t");
+    return start == std::string_view::npos ? std::string_view() : text.substr(start);
+}
+
+bool startsWithWord(const std::string_view text, const std::string_view word) {
+    if (text.compare(0, word.size(), word) != 0) {return false;}
+    return text.size() == word.size() || !(std::isalnum(static_cast<unsigned char>(text[word.size()])) || text[word.size()] == '_');
+}
+
+// statements whose value is echoed back, assignments, definitions and control flow stay quiet like out() does
+bool isExpression(const NodeType type) {
+    switch (type) {
+        case NodeType::Number: case NodeType::String: case NodeType::UnaryOperator: case NodeType::BinaryOperator:
+        case NodeType::VarAccess: case NodeType::FuncCall:
+            return true;
+        default:
+            return false;
+    }
+}
+}
+
+Repl::Repl(std::ostream& os, std::ostream& errors) :
+errors(errors),
+output(os, true),
+sourceFile(SourceTable::registerFile("<repl>")),
+globals(Context::makeGlobal("<repl>")),
+compiler(chunk),
+vm(globals.get()) {}
+
+void Repl::run(std::istream& is, const bool prompts) {
+    bool continuing = false;
+    std::string line;
+    while (true) {
+        if (prompts) {
+            output.write(continuing ? "...  " : "vis> ");
+            output.flush();
+        }
+        if (!std::getline(is, line)) {break;}
+        if (!line.empty() && line.back() == '\r') {line.pop_back();}
+        continuing = addLine(line);
+    }
+    finish();
+    if (prompts) {output.endLine();}
+}
+
+bool Repl::addLine(const std::string& line) {
+    const std::string_view trimmed = trimStart(line);
+    if (awaitingElse) {
+        awaitingElse = false;
+        if (startsWithWord(trimmed, "else")) {hasElse = true;}
+        else {finish();}
+    }
+    if (pending.empty() && trimmed.empty()) {return false;}
+    if (depth == 1 && !trimmed.empty() && trimmed[0] == '}' && startsWithWord(trimStart(trimmed.substr(1)), "else")) {
+        hasElse = true; // the closing brace of the if and its else share a line
+    }
+    pending += line;
+    pending += '\n';
+    depth += ParallelParser::depthChange(line);
+    if (depth > 0) {return true;}
+    if (!hasElse && startsWithWord(trimStart(pending), "if")) {
+        awaitingElse = true;
+        return true;
+    }
+    finish();
+    return false;
+}
+
+void Repl::finish() {
+    if (!pending.empty()) {execute(pending);}
+    pending.clear();
+    depth = 0;
+    awaitingElse = false;
+    hasElse = false;
+}
+
+// a failed input leaves no code behind, definitions it made before failing stay in the globals
+void Repl::execute(const std::string& source) {
+    const NodeArena::Mark inputMark = nodeArena.getMark();
+    const Compiler::Mark compiledMark = compiler.getMark();
+    try {
+        bool echo = false;
+        {
+            NodeArena::Scope arenaScope(nodeArena);
+            const std::shared_ptr<const SourceBuffer> buffer = SourceBuffer::fromString(source);
+            const int firstLine = SourceTable::appendSource(sourceFile.getFileId(), buffer);
+            PositionHandler positionHandler(sourceFile.getFileId(), buffer, buffer->getText(), firstLine);
+            Parser parser(Lexer(positionHandler).tokenise());
+            ConstantFolder constantFolder;
+            Resolver resolver;
+            while (true) {
+                std::unique_ptr<Node> nodeTree = parser.parse();
+                if (!nodeTree) {continue;}
+                if (nodeTree->getType() == NodeType::EndOfFile) {break;}
+                constantFolder.fold(nodeTree);
+                resolver.resolve(nodeTree);
+                compiler.compile(nodeTree);
+                echo = isExpression(nodeTree->getType());
+            }
+        }
+        nodeArena.rewind(inputMark);
+        OutputBuffer::Scope outputScope(&output);
+        const Value result = vm.run(chunk, compiledMark.code);
+        if (echo && !result.isNull() && result.getType() != ValueType::Function) {
+            output.write(result);
+            output.endLine();
+        }
+    }
+    catch (const std::exception& error) {
+        nodeArena.rewind(inputMark);
+        compiler.rewind(compiledMark);
+        output.flush();
+        errors << error.what() << std::endl;
+    }
+}
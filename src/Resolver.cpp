@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "Resolver.h"
+#include "Error.h"
+
+namespace {
+void addName(std::vector<std::string>& names, const std::string& name) {
+    if (std::find(names.begin(), names.end(), name) == names.end()) {names.push_back(name);}
+}
+}
+
+// resolves a single top level statement, top level names stay global and are looked up by name
+void Resolver::resolve(const std::unique_ptr<Node>& node) {
+    functionsDefined = false;
+    if (node) {resolveNode(node.get());}
+}
+
+bool Resolver::definedFunctions() const {return functionsDefined;}
+
+void Resolver::resolveNode(Node* node) {
+    switch (node->getType()) {
+        case NodeType::Number: case NodeType::String: case NodeType::EndOfFile:
+            return;
+        case NodeType::BinaryOperator: {
+            const auto* binaryNode = dynamic_cast<BinaryOperator*>(node);
+            resolveNode(binaryNode->getLeftNode().get());
+            resolveNode(binaryNode->getRightNode().get());
+            return;
+        }
+        case NodeType::UnaryOperator:
+            return resolveNode(dynamic_cast<UnaryOperator*>(node)->getValue().get());
+        case NodeType::VarAccess: case NodeType::VarIncrement: case NodeType::VarDecrement:
+            return resolveName(node, std::get<std::string>(node->getToken().getValue()));
+        case NodeType::VarAssgnment:
+            resolveNode(dynamic_cast<VarAssignment*>(node)->getValue().get());
+            return resolveName(node, std::get<std::string>(node->getToken().getValue()));
+        case NodeType::LibCall:
+            return resolveBlock(dynamic_cast<LibCall*>(node)->getArgumentNodes());
+        case NodeType::IfStmt: {
+            const auto* ifNode = dynamic_cast<IfStmt*>(node);
+            resolveNode(ifNode->getComparison().get());
+            resolveBlock(ifNode->getIfBlock());
+            return resolveBlock(ifNode->getElseBlock());
+        }
+        case NodeType::WhileStmt: {
+            const auto* whileNode = dynamic_cast<WhileStmt*>(node);
+            resolveNode(whileNode->getComparison().get());
+            return resolveBlock(whileNode->getWhileBlock());
+        }
+        case NodeType::ForStmt: {
+            const auto* forNode = dynamic_cast<ForStmt*>(node);
+            resolveNode(forNode->getVarDeclare().get());
+            resolveNode(forNode->getCondition().get());
+            resolveNode(forNode->getStep().get());
+            return resolveBlock(forNode->getForBlock());
+        }
+        case NodeType::FuncDef:
+            return resolveFuncDef(dynamic_cast<FuncDef*>(node));
+        case NodeType::FuncCall: {
+            auto* callNode = dynamic_cast<FuncCall*>(node);
+            resolveBlock(callNode->getArguments());
+            return resolveName(callNode, callNode->getName());
+        }
+        case NodeType::ReturnCall:
+            if (const auto& expression = dynamic_cast<ReturnCall*>(node)->getExpression()) {
+                resolveNode(expression.get());
+                if (!scopes.empty() && expression->getType() == NodeType::FuncCall) { // nothing is left to run after the call
+                    scopes.back().tailCalls.push_back(dynamic_cast<FuncCall*>(expression.get()));
+                }
+            }
+            return;
+        default:
+            throw InterpretError("resolve node method not defined");
+    }
+}
+
+void Resolver::resolveBlock(const std::vector<std::unique_ptr<Node>>& nodes) {
+    for (const std::unique_ptr<Node>& node : nodes) {resolveNode(node.get());}
+}
+
+// arguments take the first slots, every name written anywhere in the body is hoisted into a slot after them
+void Resolver::resolveFuncDef(FuncDef* node) {
+    functionsDefined = true;
+    resolveName(node, node->getName());
+    std::vector<std::string> locals;
+    for (const Token& argToken : node->getArguments()) {locals.push_back(std::get<std::string>(argToken.getValue()));}
+    for (const std::unique_ptr<Node>& bodyNode : node->getFunctionBody()) {
+        collectDeclarations(bodyNode.get(), locals);
+    }
+    if (locals.size() >= INT16_MAX) {throw InterpretError("function " + node->getName() + " has too many locals");}
+    if (!scopes.empty()) {scopes.back().capturesFrame = true;}
+    std::vector<int> writes(locals.size(), 0);
+    std::fill_n(writes.begin(), node->getArguments().size(), 1);
+    scopes.push_back(Scope{node, locals, std::vector<bool>(locals.size(), false), std::move(writes), {}, false, {}});
+    resolveBlock(node->getFunctionBody());
+    Scope& scope = scopes.back();
+    node->setDefinesFunctions(scope.capturesFrame);
+    if (!scope.capturesFrame) {
+        for (FuncCall* callNode : scope.tailCalls) {callNode->setTailCall(true);}
+    }
+    node->setLocals(std::make_shared<const std::vector<std::string>>(std::move(locals)));
+    bindSelfReferences(scope);
+    node->setCapturedSlots(std::make_shared<const std::vector<bool>>(std::move(scope.captured)));
+    scopes.pop_back();
+}
+
+void Resolver::resolveName(Node* node, const std::string& name) {
+    const SlotRef ref = lookup(name);
+    node->setSlotRef(ref);
+    switch (node->getType()) {
+        case NodeType::VarAssgnment: case NodeType::VarIncrement: case NodeType::VarDecrement: case NodeType::FuncDef:
+            if (ref.depth == 0) {scopes.back().writes[ref.slot]++;}
+            break;
+        case NodeType::VarAccess: case NodeType::FuncCall:
+            if (ref.depth == 1 && name == scopes.back().function->getName()) {return addSelfReference(node, ref);}
+            break;
+        default:
+            break;
+    }
+    markCaptured(name);
+}
+
+SlotRef Resolver::lookup(const std::string& name) const {
+    for (std::size_t depth = 0; depth < scopes.size(); depth++) {
+        const std::vector<std::string>& names = scopes[scopes.size() - 1 - depth].names;
+        const auto it = std::find(names.rbegin(), names.rend(), name); // last match so repeated arguments bind like sets
+        if (it != names.rend()) {
+            return SlotRef{static_cast<std::int16_t>(depth), static_cast<std::int16_t>(names.rend() - it - 1)};
+        }
+    }
+    return SlotRef{};
+}
+
+// an unwritten slot falls back to the enclosing frames by name, so every outer slot with the name is kept
+void Resolver::markCaptured(const std::string& name) {
+    for (std::size_t depth = 1; depth < scopes.size(); depth++) {
+        Scope& scope = scopes[scopes.size() - 1 - depth];
+        for (std::size_t slot = 0; slot < scope.names.size(); slot++) {
+            if (scope.names[slot] == name) {scope.captured[slot] = true;}
+        }
+    }
+}
+
+// a function reading its own name is left for the enclosing scope to decide, once all of its writes are known
+void Resolver::addSelfReference(Node* node, const SlotRef& ref) {
+    FuncDef* function = scopes.back().function;
+    std::vector<SelfReference>& references = scopes[scopes.size() - 2].selfReferences;
+    for (SelfReference& reference : references) {
+        if (reference.function == function) {return reference.nodes.push_back(node);}
+    }
+    references.push_back(SelfReference{function, ref.slot, {node}});
+}
+
+// when only the definition writes the slot a function reads itself through, the call binds the function into a slot
+// of its own frame instead, so a closure calling itself does not need the frame it was defined in to stay alive
+void Resolver::bindSelfReferences(Scope& scope) {
+    for (const SelfReference& reference : scope.selfReferences) {
+        FuncDef* function = reference.function;
+        if (scope.writes[reference.slot] != 1) {
+            scope.captured[reference.slot] = true;
+            markCaptured(function->getName());
+            continue;
+        }
+        std::vector<std::string> locals = *function->getLocals();
+        locals.push_back(function->getName());
+        std::vector<bool> capturedSlots = *function->getCapturedSlots();
+        capturedSlots.push_back(false);
+        const SlotRef selfRef{0, static_cast<std::int16_t>(locals.size() - 1)};
+        for (Node* node : reference.nodes) {node->setSlotRef(selfRef);}
+        function->setLocals(std::make_shared<const std::vector<std::string>>(std::move(locals)));
+        function->setCapturedSlots(std::make_shared<const std::vector<bool>>(std::move(capturedSlots)));
+        function->setSelfSlot(selfRef.slot);
+    }
+}
+
+// collects names a function writes to, nested function bodies have their own scope and are skipped
+void Resolver::collectDeclarations(const Node* node, std::vector<std::string>& names) {
+    if (!node) {return;}
+    switch (node->getType()) {
+        case NodeType::VarAssgnment:
+            collectDeclarations(dynamic_cast<const VarAssignment*>(node)->getValue().get(), names);
+            return addName(names, std::get<std::string>(node->getToken().getValue()));
+        case NodeType::VarIncrement: case NodeType::VarDecrement:
+            return addName(names, std::get<std::string>(node->getToken().getValue()));
+        case NodeType::FuncDef:
+            return addName(names, dynamic_cast<const FuncDef*>(node)->getName());
+        case NodeType::BinaryOperator: {
+            const auto* binaryNode = dynamic_cast<const BinaryOperator*>(node);
+            collectDeclarations(binaryNode->getLeftNode().get(), names);
+            return collectDeclarations(binaryNode->getRightNode().get(), names);
+        }
+        case NodeType::UnaryOperator:
+            return collectDeclarations(dynamic_cast<const UnaryOperator*>(node)->getValue().get(), names);
+        case NodeType::LibCall:
+            for (const auto& argNode : dynamic_cast<const LibCall*>(node)->getArgumentNodes()) {
+                collectDeclarations(argNode.get(), names);
+            }
+            return;
+        case NodeType::FuncCall:
+            for (const auto& argNode : dynamic_cast<const FuncCall*>(node)->getArguments()) {
+                collectDeclarations(argNode.get(), names);
+            }
+            return;
+        case NodeType::IfStmt: {
+            const auto* ifNode = dynamic_cast<const IfStmt*>(node);
+            collectDeclarations(ifNode->getComparison().get(), names);
+            for (const auto& blockNode : ifNode->getIfBlock()) {collectDeclarations(blockNode.get(), names);}
+            for (const auto& blockNode : ifNode->getElseBlock()) {collectDeclarations(blockNode.get(), names);}
+            return;
+        }
+        case NodeType::WhileStmt: {
+            const auto* whileNode = dynamic_cast<const WhileStmt*>(node);
+            collectDeclarations(whileNode->getComparison().get(), names);
+            for (const auto& blockNode : whileNode->getWhileBlock()) {collectDeclarations(blockNode.get(), names);}
+            return;
+        }
+        case NodeType::ForStmt: {
+            const auto* forNode = dynamic_cast<const ForStmt*>(node);
+            collectDeclarations(forNode->getVarDeclare().get(), names);
+            collectDeclarations(forNode->getCondition().get(), names);
+            collectDeclarations(forNode->getStep().get(), names);
+            for (const auto& blockNode : forNode->getForBlock()) {collectDeclarations(blockNode.get(), names);}
+            return;
+        }
+        case NodeType::ReturnCall:
+            return collectDeclarations(dynamic_cast<const ReturnCall*>(node)->getExpression().get(), names);
+        default:
+            return;
+    }
+}
@@ -0,0 +1,63 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "SourceBuffer.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VIS_HAS_MMAP 1
+#endif
+
+// returns nullptr when the file cannot be opened, "-" reads standard input
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromFile(const std::string& path) {
+    if (path == "-") {return fromStream(std::cin);}
+#ifdef VIS_HAS_MMAP
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {return nullptr;}
+    struct stat fileStat {};
+    if (::fstat(descriptor, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+        const auto length = static_cast<std::size_t>(fileStat.st_size);
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped != MAP_FAILED) {
+            ::close(descriptor);
+            std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+            buffer->mapping = mapped;
+            buffer->mappingSize = length;
+            buffer->text = std::string_view(static_cast<const char*>(mapped), length);
+            return buffer;
+        }
+    }
+    // pipes, character devices, empty files or a failed map are read in chunks instead
+    std::string contents;
+    char chunk[1 << 16];
+    ssize_t bytesRead;
+    while ((bytesRead = ::read(descriptor, chunk, sizeof(chunk))) > 0) {contents.append(chunk, bytesRead);}
+    ::close(descriptor);
+    return fromString(std::move(contents));
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {return nullptr;}
+    return fromStream(file);
+#endif
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromStream(std::istream& stream) {
+    return fromString(std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()));
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromString(std::string text) {
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+    buffer->ownedText = std::move(text);
+    buffer->text = buffer->ownedText;
+    return buffer;
+}
+
+SourceBuffer::~SourceBuffer() {
+#ifdef VIS_HAS_MMAP
+    if (mapping) {::munmap(mapping, mappingSize);}
+#endif
+}
@@ -35,16 +35,16 @@ std::string tokenTypeToStr(TokenType type) {
     }
 }
 
-Token::Token(const TokenType type_, const std::map<std::string, std::string>& pos, ValueLiteral  value_):
+Token::Token(const TokenType type_, const Position& pos, ValueLiteral  value_):
     type(type_),
     value(std::move(value_)),
     position(pos) {}
 
 TokenType Token::getType() const {return type;}
 
-ValueLiteral Token::getValue() const {return value;}
+const ValueLiteral& Token::getValue() const {return value;}
 
-std::map<std::string, std::string> Token::getPos() const {return position;}
+Position Token::getPos() const {return position;}
 
 bool Token::matches(const TokenType type_, const std::string &value_) const {
     if (std::holds_alternative<std::string>(value)) {
@@ -59,7 +59,7 @@ Token Token::clone() const {return Token(type, position, value);}
 
 std::ostream& operator<<(std::ostream& os,  const Token& token) {
     os << "Token(Type: " << tokenTypeToStr(token.getType()) << ", ";
-    os << "Position: {line: " << token.getPos()["line"] << " | Pos: " << token.getPos()["charPos"] << "}, ";
+    os << "Position: {line: " << token.getPos().line << " | Pos: " << token.getPos().charPos << "}, ";
     os << "Value: ";
 
     if (std::holds_alternative<std::monostate>(token.getValue())) {
@@ -68,8 +68,8 @@ std::ostream& operator<<(std::ostream& os,  const Token& token) {
     else if (std::holds_alternative<int>(token.getValue())) {
         os << std::get<int>(token.getValue());
     }
-    else if (std::holds_alternative<float>(token.getValue())) {
-        os << std::get<float>(token.getValue());
+    else if (std::holds_alternative<double>(token.getValue())) {
+        os << std::get<double>(token.getValue());
     }
     else if (std::holds_alternative<std::string>(token.getValue())) {
         os << std::get<std::string>(token.getValue());
@@ -86,3 +86,34 @@ std::ostream& operator<<(std::ostream& os,  const Token& token) {
 
 
 
+
+// missing line numbers become empty lines so line indexes keep matching the source
+TokenStream::TokenStream(const std::map<int, std::vector<Token>>& lines) {
+    if (lines.empty()) {return;}
+    for (int line = 0; line <= lines.rbegin()->first; line++) {
+        beginLine();
+        const auto it = lines.find(line);
+        if (it == lines.end()) {continue;}
+        for (const Token& token : it->second) {tokens.push_back(token);}
+    }
+}
+
+void TokenStream::beginLine() {lineStarts.push_back(tokens.size());}
+
+void TokenStream::push(Token token) {tokens.push_back(std::move(token));}
+
+std::size_t TokenStream::lineCount() const {return lineStarts.size();}
+
+std::size_t TokenStream::lineStart(const std::size_t line) const {return lineStarts[line];}
+
+std::size_t TokenStream::lineEnd(const std::size_t line) const {
+    return line + 1 < lineStarts.size() ? lineStarts[line + 1] : tokens.size();
+}
+
+TokenLine TokenStream::getLine(const std::size_t line) const {
+    return TokenLine{tokens.data() + lineStart(line), tokens.data() + lineEnd(line)};
+}
+
+std::size_t TokenStream::size() const {return tokens.size();}
+
+const Token& TokenStream::operator[](const std::size_t index) const {return tokens[index];}
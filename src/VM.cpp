@@ -0,0 +1,326 @@
+#include "VM.h"
+#include "Error.h"
+#include "ExecutionStats.h"
+#include "OutputBuffer.h"
+#include "Profiler.h"
+
+VM::VM(Context* globalContext) : globalContext(globalContext) {}
+
+void VM::setGlobalContext(Context* context) {globalContext = context;}
+
+Value VM::pop() {
+    Value value = std::move(stack.back());
+    stack.pop_back();
+    return value;
+}
+
+void VM::push(Value value) {stack.push_back(std::move(value));}
+
+// runs chunk from startIp until the top level code is exhausted and returns the value left behind
+Value VM::run(const Chunk& chunk, const std::size_t startIp) {
+    return ExecutionStats::getActive() || Profiler::getActive() ? execute<true>(chunk, startIp) : execute<false>(chunk, startIp);
+}
+
+template <bool Instrumented>
+Value VM::execute(const Chunk& chunk, const std::size_t startIp) {
+    ExecutionStats* stats = Instrumented ? ExecutionStats::getActive() : nullptr;
+    Profiler* profiler = Instrumented ? Profiler::getActive() : nullptr;
+    OutputBuffer& output = OutputBuffer::current();
+    stack.clear();
+    frames.clear();
+    frames.push_back(CallFrame{&chunk, nullptr, startIp, 0, nullptr, false});
+    CallFrame* frame = &frames.back();
+    Context* context = globalContext;
+    while (true) {
+        if (frame->ip >= frame->chunk->code.size()) {
+            if (frames.size() > 1) {throw InterpretError("function body ended without a return instruction");}
+            break;
+        }
+        const Instruction& instruction = frame->chunk->code[frame->ip++];
+        if constexpr (Instrumented) {
+            if (stats) {stats->instructions[static_cast<std::size_t>(instruction.op)]++;}
+            if (profiler && profiler->tick()) {profiler->sample(frame->chunk->positions[frame->ip - 1]);}
+        }
+        switch (instruction.op) {
+            case OpCode::CONSTANT:
+                push(frame->chunk->constants[instruction.operand]);
+                break;
+            case OpCode::NULL_:
+                push(Value());
+                break;
+            case OpCode::POP:
+                stack.pop_back();
+                break;
+            case OpCode::DUP:
+                push(stack.back());
+                break;
+            case OpCode::GET_VAR: {
+                const std::string& varName = frame->chunk->names[instruction.operand];
+                push(context->getSymbolTable().getValue(varName));
+                break;
+            }
+            case OpCode::SET_VAR: {
+                const std::string& varName = frame->chunk->names[instruction.operand];
+                if (stack.back().isNull()) {throw VisRunTimeError("cannot assign a null value to variable " + varName);}
+                context->getSymbolTable().set(varName, stack.back());
+                break;
+            }
+            case OpCode::INCREMENT_VAR: case OpCode::DECREMENT_VAR: {
+                const std::string& varName = frame->chunk->names[instruction.operand];
+                const Value& value = context->getSymbolTable().getValue(varName);
+                Value result = instruction.op == OpCode::INCREMENT_VAR ? value.add(Value(1)) : value.subtract(Value(1));
+                context->getSymbolTable().set(varName, result);
+                push(std::move(result));
+                break;
+            }
+            case OpCode::GET_LOCAL:
+                push(context->getResolved(SlotRef{static_cast<std::int16_t>(instruction.count),
+                    static_cast<std::int16_t>(instruction.operand)}));
+                break;
+            case OpCode::SET_LOCAL: {
+                if (stack.back().isNull()) {
+                    throw VisRunTimeError("cannot assign a null value to variable " +
+                        context->getAncestor(instruction.count)->getSlotName(instruction.operand));
+                }
+                context->getAncestor(instruction.count)->getSlot(instruction.operand) = stack.back();
+                break;
+            }
+            case OpCode::INCREMENT_LOCAL: case OpCode::DECREMENT_LOCAL: {
+                const Value& value = context->getResolved(SlotRef{static_cast<std::int16_t>(instruction.count),
+                    static_cast<std::int16_t>(instruction.operand)});
+                Value result = instruction.op == OpCode::INCREMENT_LOCAL ? value.add(Value(1)) : value.subtract(Value(1));
+                context->getAncestor(instruction.count)->getSlot(instruction.operand) = result;
+                push(std::move(result));
+                break;
+            }
+            case OpCode::ADD: case OpCode::SUBTRACT: case OpCode::MULTIPLY: case OpCode::DIVIDE:
+            case OpCode::MODULO: case OpCode::COMPARE_TE: case OpCode::COMPARE_NE: case OpCode::COMPARE_LT:
+            case OpCode::COMPARE_LTE: case OpCode::COMPARE_GT: case OpCode::COMPARE_GTE: case OpCode::AND:
+            case OpCode::OR: {
+                const Value right = pop();
+                const Value left = pop();
+                if (left.isNull() || right.isNull()) {
+                    throw VisRunTimeError("cannot apply " + opCodeToStr(instruction.op) + " to a null value");
+                }
+                switch (instruction.op) {
+                    case OpCode::ADD: push(left.add(right)); break;
+                    case OpCode::SUBTRACT: push(left.subtract(right)); break;
+                    case OpCode::MULTIPLY: push(left.multiply(right)); break;
+                    case OpCode::DIVIDE: push(left.divide(right)); break;
+                    case OpCode::MODULO: push(left.modulo(right)); break;
+                    case OpCode::COMPARE_TE: push(left.compareTE(right)); break;
+                    case OpCode::COMPARE_NE: push(left.compareNE(right)); break;
+                    case OpCode::COMPARE_LT: push(left.compareLT(right)); break;
+                    case OpCode::COMPARE_LTE: push(left.compareLTE(right)); break;
+                    case OpCode::COMPARE_GT: push(left.compareGT(right)); break;
+                    case OpCode::COMPARE_GTE: push(left.compareGTE(right)); break;
+                    case OpCode::AND: push(left.andWith(right)); break;
+                    default: push(left.orWith(right)); break;
+                }
+                break;
+            }
+            case OpCode::NEGATE: case OpCode::NOT: {
+                const Value value = pop();
+                if (value.isNull()) {throw VisRunTimeError("cannot apply " + opCodeToStr(instruction.op) + " to a null value");}
+                push(instruction.op == OpCode::NEGATE ? value.negate() : value.notSelf());
+                break;
+            }
+            case OpCode::JUMP:
+                frame->ip = instruction.operand;
+                break;
+            case OpCode::FOR_TEST: { // stack holds the loop bound under the counter, both stay until the loop exits
+                const Value& counter = stack.back();
+                const Value& bound = stack[stack.size() - 2];
+                bool proceed;
+                if (counter.getType() == ValueType::Int && bound.getType() == ValueType::Int) {
+                    const std::int64_t left = counter.getIntValue();
+                    const std::int64_t right = bound.getIntValue();
+                    switch (static_cast<OpCode>(instruction.count)) {
+                        case OpCode::COMPARE_LT: proceed = left < right; break;
+                        case OpCode::COMPARE_LTE: proceed = left <= right; break;
+                        case OpCode::COMPARE_GT: proceed = left > right; break;
+                        case OpCode::COMPARE_GTE: proceed = left >= right; break;
+                        default: proceed = left != right; break;
+                    }
+                }
+                else {
+                    if (counter.isNull() || bound.isNull()) {
+                        throw VisRunTimeError("cannot apply " + opCodeToStr(static_cast<OpCode>(instruction.count)) +
+                            " to a null value");
+                    }
+                    switch (static_cast<OpCode>(instruction.count)) {
+                        case OpCode::COMPARE_LT: proceed = counter.compareLT(bound).getBoolValue(); break;
+                        case OpCode::COMPARE_LTE: proceed = counter.compareLTE(bound).getBoolValue(); break;
+                        case OpCode::COMPARE_GT: proceed = counter.compareGT(bound).getBoolValue(); break;
+                        case OpCode::COMPARE_GTE: proceed = counter.compareGTE(bound).getBoolValue(); break;
+                        default: proceed = counter.compareNE(bound).getBoolValue(); break;
+                    }
+                }
+                if (!proceed) {frame->ip = instruction.operand;}
+                break;
+            }
+            case OpCode::FOR_STEP: {
+                Value& counter = stack.back();
+                counter = instruction.count == 1 ? counter.add(Value(1)) : counter.subtract(Value(1));
+                frame->ip = instruction.operand;
+                break;
+            }
+            case OpCode::JUMP_IF_FALSE: {
+                const Value condition = pop();
+                if (condition.isNull()) {throw VisRunTimeError("condition evaluated to a null value");}
+                if (!condition.getBoolValue()) {frame->ip = instruction.operand;}
+                break;
+            }
+            case OpCode::OUT_VALUE: {
+                if (const Value value = pop(); !value.isNull()) {
+                    output.write(value);
+                    output.write(" ");
+                }
+                break;
+            }
+            case OpCode::OUT_END:
+                output.endLine();
+                push(Value());
+                break;
+            case OpCode::FLUSH:
+                output.flush();
+                push(Value());
+                break;
+            case OpCode::MAKE_FUNCTION:
+                makeFunction(frame->chunk->functions[instruction.operand], context);
+                frame->captured = true;
+                break;
+            case OpCode::CALL: case OpCode::CALL_VALUE: {
+                const std::string& name = frame->chunk->names[instruction.operand];
+                const Value callee = instruction.op == OpCode::CALL
+                    ? context->getSymbolTable().getCachedValue(name, frame->chunk->callSiteCaches[instruction.operand])
+                    : pop();
+                callFunction(callee, name, instruction.count);
+                if constexpr (Instrumented) {
+                    if (stats) {stats->functionCalls++;}
+                    if (profiler) {
+                        const CallFrame& caller = frames[frames.size() - 2];
+                        profiler->enter(callee.getFunction()->getName(), caller.chunk->positions[caller.ip - 1]);
+                    }
+                }
+                frame = &frames.back();
+                context = frame->context.get();
+                break;
+            }
+            case OpCode::TAIL_CALL: case OpCode::TAIL_CALL_VALUE: {
+                if (frames.size() == 1) {throw InterpretError("tail call compiled outside of a function");}
+                const std::string& name = frame->chunk->names[instruction.operand];
+                const Value callee = instruction.op == OpCode::TAIL_CALL
+                    ? context->getSymbolTable().getCachedValue(name, frame->chunk->callSiteCaches[instruction.operand])
+                    : pop();
+                tailCallFunction(*frame, callee, name, instruction.count);
+                if constexpr (Instrumented) {
+                    if (stats) {stats->functionCalls++;}
+                    if (profiler) {profiler->replace(callee.getFunction()->getName());}
+                }
+                context = frame->context.get();
+                break;
+            }
+            case OpCode::RETURN: case OpCode::RETURN_NULL: {
+                if (frames.size() == 1) {throw VisRunTimeError("return called outside of a function");}
+                Value returnValue = instruction.op == OpCode::RETURN ? pop() : Value();
+                stack.resize(frame->stackBase);
+                if (frame->captured) { // the closures made here may still need it
+                    Context::releaseFrame(frame->context, frame->function->capturedSlots.get());
+                }
+                else {
+                    frame->context->release();
+                    contextPool.push_back(std::move(frame->context));
+                }
+                frames.pop_back();
+                frame = &frames.back();
+                if constexpr (Instrumented) {if (profiler) {profiler->leave();}}
+                context = frame->context ? frame->context.get() : globalContext;
+                push(std::move(returnValue));
+                break;
+            }
+            default:
+                throw InterpretError("VM instruction not defined: " + opCodeToStr(instruction.op));
+        }
+    }
+    Value result = stack.empty() ? Value() : pop();
+    frames.clear();
+    return result;
+}
+
+void VM::makeFunction(const std::shared_ptr<FunctionProto>& proto, Context* context) {
+    auto contextForFunc = std::make_unique<Context>(proto->name);
+    contextForFunc->setParentContext(context);
+    contextForFunc->setSymbolTable(SymbolTable(&context->getSymbolTable()));
+    static const auto noBody = std::make_shared<const std::vector<std::unique_ptr<Node>>>();
+    auto funcLiteral = std::make_shared<FunctionLiteral>(
+        proto->name,
+        proto->args,
+        noBody,
+        std::move(contextForFunc)
+        );
+    funcLiteral->setCode(proto);
+    funcLiteral->setLocals(proto->locals);
+    funcLiteral->setContext(context);
+    funcLiteral->setPosition(proto->position);
+    push(Value(std::shared_ptr<const Literal>(std::move(funcLiteral))));
+}
+
+// binds the arguments on top of the stack into a recycled activation frame and pushes it for the callee
+void VM::callFunction(const Value& callee, const std::string& name, const std::uint16_t argCount) {
+    const FunctionLiteral* funcLiteral = checkCallee(callee, name, argCount);
+    std::shared_ptr<Context> callContext = acquireContext();
+    callContext->bindFrame(*funcLiteral->getScopeContext(), funcLiteral->getLocals());
+    bindArguments(*callContext, funcLiteral, argCount);
+    const FunctionProto* function = funcLiteral->getCode().get();
+    if (function->selfSlot >= 0) {callContext->getSlot(function->selfSlot) = callee;}
+    frames.push_back(CallFrame{&function->chunk, function, 0, stack.size(), std::move(callContext), false});
+}
+
+// rebinds the calling frame to the callee in place, so tail recursion runs in a constant number of frames
+// the Resolver only marks tail calls in functions that define no closures, so nothing else points at the frame
+void VM::tailCallFunction(CallFrame& frame, const Value& callee, const std::string& name, const std::uint16_t argCount) {
+    const FunctionLiteral* funcLiteral = checkCallee(callee, name, argCount);
+    frame.context->bindFrame(*funcLiteral->getScopeContext(), funcLiteral->getLocals());
+    bindArguments(*frame.context, funcLiteral, argCount);
+    stack.resize(frame.stackBase);
+    frame.function = funcLiteral->getCode().get();
+    frame.chunk = &frame.function->chunk;
+    if (frame.function->selfSlot >= 0) {frame.context->getSlot(frame.function->selfSlot) = callee;}
+    frame.ip = 0;
+}
+
+const FunctionLiteral* VM::checkCallee(const Value& callee, const std::string& name, const std::uint16_t argCount) {
+    const FunctionLiteral* funcLiteral = callee.getFunction();
+    if (!funcLiteral) {
+        throw VisRunTimeError("function >>> " + name + " <<< called but does not point to a function");
+    }
+    const std::shared_ptr<const FunctionProto>& proto = funcLiteral->getCode();
+    if (!proto) {throw InterpretError("function >>> " + name + " <<< has no compiled body");}
+    if (proto->args->size() != argCount) {
+        throw VisRunTimeError("function >>> " + name + " <<< was called with incorrect arguments");
+    }
+    return funcLiteral;
+}
+
+std::shared_ptr<Context> VM::acquireContext() {
+    if (contextPool.empty()) {return std::make_shared<Context>("");}
+    std::shared_ptr<Context> callContext = std::move(contextPool.back());
+    contextPool.pop_back();
+    return callContext;
+}
+
+// moves the arguments off the top of the stack into the callee's slots, or its symbol table when it has no slots
+void VM::bindArguments(Context& callContext, const FunctionLiteral* funcLiteral, const std::uint16_t argCount) {
+    const std::size_t argBase = stack.size() - argCount;
+    for (std::size_t i = 0; i < argCount; i++) {
+        if (stack[argBase + i].isNull()) {throw InterpretError("function argument evaluated to a null ptr");}
+        if (funcLiteral->getLocals()) {
+            callContext.getSlot(static_cast<int>(i)) = std::move(stack[argBase + i]);
+            continue;
+        }
+        const std::string& argName = std::get<std::string>(funcLiteral->getArgs()[i].getValue());
+        callContext.getSymbolTable().set(argName, std::move(stack[argBase + i]));
+    }
+    stack.resize(argBase);
+}
@@ -0,0 +1,316 @@
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "Value.h"
+#include "Error.h"
+#include "Literal.h"
+
+std::string valueTypeToStr(const ValueType type) {
+    switch (type) {
+        case ValueType::Null: return "Null";
+        case ValueType::Bool: return "Bool";
+        case ValueType::Int: return "Int";
+        case ValueType::Float: return "Float";
+        case ValueType::String: return "String";
+        case ValueType::Function: return "Function";
+        default: return "Unknown";
+    }
+}
+
+Value::Value() : type(ValueType::Null), intValue(0) {}
+
+Value::Value(const bool value) : type(ValueType::Bool), boolValue(value) {}
+
+Value::Value(const int value) : Value(static_cast<std::int64_t>(value)) {}
+
+Value::Value(const std::int64_t value) : type(ValueType::Int), intValue(value) {}
+
+Value::Value(const double value) : type(ValueType::Float), floatValue(value) {}
+
+Value::Value(std::shared_ptr<const Literal> literal) : type(ValueType::Null), intValue(0), boxed(std::move(literal)) {
+    if (dynamic_cast<const StringLiteral*>(boxed.get())) {type = ValueType::String;}
+    else if (dynamic_cast<const FunctionLiteral*>(boxed.get())) {type = ValueType::Function;}
+    else {throw InterpretError("only string and function literals can be boxed inside a value");}
+}
+
+Value Value::fromString(std::string text) {
+    return Value(std::shared_ptr<const Literal>(std::make_shared<StringLiteral>(std::move(text))));
+}
+
+// unpacks numbers and booleans, strings and functions keep the literal as their box
+Value Value::fromLiteral(std::unique_ptr<Literal> literal) {
+    if (!literal) {return Value();}
+    if (const auto* boolLiteral = dynamic_cast<const BoolLiteral*>(literal.get())) {
+        return Value(boolLiteral->getBoolValue());
+    }
+    if (const auto* intLiteral = dynamic_cast<const IntLiteral*>(literal.get())) {
+        return Value(intLiteral->getIntValue());
+    }
+    if (const auto* floatLiteral = dynamic_cast<const FloatLiteral*>(literal.get())) {
+        return Value(floatLiteral->getNumberValue());
+    }
+    return Value(std::shared_ptr<const Literal>(std::move(literal)));
+}
+
+ValueType Value::getType() const {return type;}
+
+bool Value::isNull() const {return type == ValueType::Null;}
+
+double Value::getNumberValue() const {
+    switch (type) {
+        case ValueType::Bool: return boolValue ? 1 : 0;
+        case ValueType::Int: return intValue;
+        case ValueType::Float: return floatValue;
+        case ValueType::String: return boxed->getNumberValue();
+        case ValueType::Function: throw VisRunTimeError("function contains no value");
+        default: throw VisRunTimeError("null value contains no value");
+    }
+}
+
+// exact for ints, every other type goes through its number value
+std::int64_t Value::getIntValue() const {
+    if (type == ValueType::Int) {return intValue;}
+    return static_cast<std::int64_t>(getNumberValue());
+}
+
+bool Value::getBoolValue() const {
+    switch (type) {
+        case ValueType::Bool: return boolValue;
+        case ValueType::Int: return intValue != 0;
+        case ValueType::Float: return floatValue != 0;
+        case ValueType::String: return boxed->getBoolValue();
+        case ValueType::Function: throw VisRunTimeError("function contains no value");
+        default: throw VisRunTimeError("null value contains no value");
+    }
+}
+
+std::string Value::getStringValue() const {
+    switch (type) {
+        case ValueType::Bool: return boolValue ? "true" : "false";
+        case ValueType::Int: return std::to_string(intValue);
+        case ValueType::Float: return std::to_string(floatValue);
+        case ValueType::String: return boxed->getStringValue();
+        case ValueType::Function: throw VisRunTimeError("function contains no value");
+        default: throw VisRunTimeError("null value contains no value");
+    }
+}
+
+std::string_view Value::getStringView() const {
+    if (type != ValueType::String) {return {};}
+    return static_cast<const StringLiteral*>(boxed.get())->getView();
+}
+
+const FunctionLiteral* Value::getFunction() const {
+    if (type != ValueType::Function) {return nullptr;}
+    return static_cast<const FunctionLiteral*>(boxed.get());
+}
+
+// how many values and literals hold the boxed string or function, a count of one means no other value sees it
+long Value::getShareCount() const {return boxed.use_count();}
+
+// boxes the value back into a literal for callers still working with the literal hierarchy
+std::unique_ptr<Literal> Value::toLiteral() const {
+    switch (type) {
+        case ValueType::Bool: return std::make_unique<BoolLiteral>(boolValue);
+        case ValueType::Int: return std::make_unique<IntLiteral>(intValue);
+        case ValueType::Float: return std::make_unique<FloatLiteral>(floatValue);
+        case ValueType::String: case ValueType::Function: return boxed->clone();
+        default: return nullptr;
+    }
+}
+
+namespace {
+bool addOverflows(const std::int64_t left, const std::int64_t right, std::int64_t* result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_add_overflow(left, right, result);
+#else
+    if ((right > 0 && left > std::numeric_limits<std::int64_t>::max() - right) ||
+        (right < 0 && left < std::numeric_limits<std::int64_t>::min() - right)) {return true;}
+    *result = left + right;
+    return false;
+#endif
+}
+
+bool subtractOverflows(const std::int64_t left, const std::int64_t right, std::int64_t* result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_sub_overflow(left, right, result);
+#else
+    if ((right < 0 && left > std::numeric_limits<std::int64_t>::max() + right) ||
+        (right > 0 && left < std::numeric_limits<std::int64_t>::min() + right)) {return true;}
+    *result = left - right;
+    return false;
+#endif
+}
+
+bool multiplyOverflows(const std::int64_t left, const std::int64_t right, std::int64_t* result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_mul_overflow(left, right, result);
+#else
+    if (left != 0 && right != 0) {
+        const std::int64_t product = static_cast<std::int64_t>(static_cast<std::uint64_t>(left) * static_cast<std::uint64_t>(right));
+        if ((left == -1 && right == std::numeric_limits<std::int64_t>::min()) ||
+            (right == -1 && left == std::numeric_limits<std::int64_t>::min()) || product / right != left) {return true;}
+    }
+    *result = left * right;
+    return false;
+#endif
+}
+}
+
+// ints and bools are integral operands, mixing in a float or string moves the operation to doubles
+bool Value::isIntegral() const {return type == ValueType::Int || type == ValueType::Bool;}
+
+// exact int64 kernel, overflow is an error rather than a silent wrap or rounding
+Value Value::integerArithmetic(const std::int64_t left, const std::int64_t right, const char op) {
+    std::int64_t result = 0;
+    switch (op) {
+        case '+':
+            if (addOverflows(left, right, &result)) {throw VisRunTimeError("integer overflow in addition");}
+            return Value(result);
+        case '-':
+            if (subtractOverflows(left, right, &result)) {throw VisRunTimeError("integer overflow in subtraction");}
+            return Value(result);
+        case '*':
+            if (multiplyOverflows(left, right, &result)) {throw VisRunTimeError("integer overflow in multiplication");}
+            return Value(result);
+        case '/':
+            if (right == 0) {throw VisRunTimeError("Division by zero!");}
+            if (right == -1) { // the only quotient that can overflow
+                if (left == std::numeric_limits<std::int64_t>::min()) {throw VisRunTimeError("integer overflow in division");}
+                return Value(-left);
+            }
+            if (left % right == 0) {return Value(left / right);}
+            return Value(static_cast<double>(left) / static_cast<double>(right)); // inexact quotients become floats
+        default:
+            if (right == 0) {throw VisRunTimeError("Division by zero!");}
+            if (right == -1) {return Value(std::int64_t{0});}
+            return Value(left % right);
+    }
+}
+
+Value Value::floatArithmetic(const double left, const double right, const char op) {
+    if ((op == '/' || op == '%') && right == 0) {
+        throw VisRunTimeError("Division by zero!");
+    }
+    switch (op) {
+        case '+': return Value(left + right);
+        case '-': return Value(left - right);
+        case '*': return Value(left * right);
+        case '/': return Value(left / right);
+        default: return Value(std::fmod(left, right));
+    }
+}
+
+Value Value::arithmetic(const Value& other, const char op) const {
+    switch (type) {
+        case ValueType::Bool:
+            if (op == '+') {
+                if (other.type != ValueType::Bool) {
+                    throw VisRunTimeError("cannot add a non boolean value to a boolean value");
+                }
+                return Value(boolValue || other.boolValue);
+            }
+            if (op == '-') {throw VisRunTimeError("cannot subtract with a bool");}
+            if (op == '*') {throw VisRunTimeError("cannot multiply with a bool");}
+            if (op == '/') {throw VisRunTimeError("cannot divide with a bool");}
+            throw VisRunTimeError("cannot modulo with a bool");
+        case ValueType::String: {
+            if (op == '+' && other.type == ValueType::String) { // grows the left string's storage in place when it can
+                return Value(std::shared_ptr<const Literal>(static_cast<const StringLiteral*>(boxed.get())->append(other.getStringView())));
+            }
+            const double left = getNumberValue();
+            const double right = other.getNumberValue();
+            switch (op) {
+                case '+': return Value(static_cast<int>(left + right));
+                case '-': return Value(static_cast<int>(left - right));
+                case '*': return Value(static_cast<int>(left * right));
+                case '/': return Value(static_cast<int>(left / right));
+                default: return Value(static_cast<int>(std::fmod(left, right)));
+            }
+        }
+        case ValueType::Int:
+            if (other.isIntegral()) {return integerArithmetic(intValue, other.getIntValue(), op);}
+            return floatArithmetic(static_cast<double>(intValue), other.getNumberValue(), op);
+        case ValueType::Float:
+            return floatArithmetic(floatValue, other.getNumberValue(), op);
+        case ValueType::Function:
+            if (op == '+') {throw VisRunTimeError("cannot add a function");}
+            if (op == '-') {throw VisRunTimeError("cannot subtract a function");}
+            if (op == '*') {throw VisRunTimeError("cannot multiply a function");}
+            if (op == '/') {throw VisRunTimeError("cannot divide a function");}
+            throw VisRunTimeError("cannot modulus a function");
+        default:
+            throw VisRunTimeError("cannot apply arithmetic to a null value");
+    }
+}
+
+Value Value::add(const Value& other) const {return arithmetic(other, '+');}
+
+Value Value::subtract(const Value& other) const {return arithmetic(other, '-');}
+
+Value Value::multiply(const Value& other) const {return arithmetic(other, '*');}
+
+Value Value::divide(const Value& other) const {return arithmetic(other, '/');}
+
+Value Value::modulo(const Value& other) const {return arithmetic(other, '%');}
+
+// equality compares using the left hand side's own representation
+Value Value::compareTE(const Value& other) const {
+    switch (type) {
+        case ValueType::Bool: return Value(boolValue == other.getBoolValue());
+        case ValueType::String:
+            if (other.type == ValueType::String) {return Value(getStringView() == other.getStringView());}
+            return Value(getStringValue() == other.getStringValue());
+        case ValueType::Int:
+            if (other.isIntegral()) {return Value(intValue == other.getIntValue());}
+            return Value(getNumberValue() == other.getNumberValue());
+        case ValueType::Float: return Value(getNumberValue() == other.getNumberValue());
+        case ValueType::Function: throw VisRunTimeError("cannot compare a function");
+        default: throw VisRunTimeError("cannot compare a null value");
+    }
+}
+
+Value Value::compareNE(const Value& other) const {return Value(!compareTE(other).boolValue);}
+
+// two ints order exactly, anything else is ordered by its number value
+Value Value::compareLT(const Value& other) const {
+    if (type == ValueType::Int && other.type == ValueType::Int) {return Value(intValue < other.intValue);}
+    return Value(getNumberValue() < other.getNumberValue());
+}
+
+Value Value::compareLTE(const Value& other) const {
+    if (type == ValueType::Int && other.type == ValueType::Int) {return Value(intValue <= other.intValue);}
+    return Value(getNumberValue() <= other.getNumberValue());
+}
+
+Value Value::compareGT(const Value& other) const {
+    if (type == ValueType::Int && other.type == ValueType::Int) {return Value(intValue > other.intValue);}
+    return Value(getNumberValue() > other.getNumberValue());
+}
+
+Value Value::compareGTE(const Value& other) const {
+    if (type == ValueType::Int && other.type == ValueType::Int) {return Value(intValue >= other.intValue);}
+    return Value(getNumberValue() >= other.getNumberValue());
+}
+
+Value Value::andWith(const Value& other) const {return Value(getBoolValue() and other.getBoolValue());}
+
+Value Value::orWith(const Value& other) const {return Value(getBoolValue() or other.getBoolValue());}
+
+Value Value::notSelf() const {return Value(not getBoolValue());}
+
+Value Value::negate() const {return multiply(Value(-1));}
+
+void Value::printValue(std::ostream& os, const int tabCount) const {
+    if (type == ValueType::Null) {
+        os << std::string(tabCount, '\t') << "NullValue" << std::endl;
+        return;
+    }
+    toLiteral()->printLiteral(os, tabCount);
+}
+
+std::ostream& operator<<(std::ostream& os, const Value& value) {
+    value.printValue(os, 0);
+    return os;
+}
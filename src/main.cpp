@@ -1,27 +1,147 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <optional>
 #include <string>
 
+#include "BatchRunner.h"
 #include "Interpreter.h"
+#include "OutputBuffer.h"
+#include "ProgramFile.h"
+#include "Repl.h"
+#include "SourceBuffer.h"
+
+// runs every script under path on jobs threads, printing each script's output in order and a timing report at the end
+int runBatch(const std::string& path, const unsigned jobs, const bool treeWalk, const std::string& cacheDirectory) {
+    const std::vector<std::string> scripts = BatchRunner::collectScripts(path);
+    const BatchRunner runner(jobs, treeWalk, cacheDirectory);
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<BatchRunner::Result> results = runner.run(scripts, [](const BatchRunner::Result& result) {
+        std::cout << "==> " << result.filename << " <==" << std::endl << result.output << std::flush;
+        if (!result.error.empty()) {std::cerr << result.filename << ": " << result.error << std::endl;}
+    });
+    const double wallMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    BatchRunner::printReport(std::cerr, results, wallMilliseconds, runner.getJobs());
+    const bool failed = std::any_of(results.begin(), results.end(), [](const BatchRunner::Result& result) {return !result.error.empty();});
+    return failed ? 1 : 0;
+}
+
+// a positive thread count, nullopt for anything else so bad input gets the usage message instead of wrapping around
+std::optional<unsigned> parseJobs(const std::string& text) {
+    const auto isDigit = [](const char c) {return std::isdigit(static_cast<unsigned char>(c)) != 0;};
+    if (text.empty() || text.size() > 4 || !std::all_of(text.begin(), text.end(), isDigit)) {return std::nullopt;}
+    const unsigned jobs = static_cast<unsigned>(std::stoul(text));
+    if (jobs == 0) {return std::nullopt;}
+    return jobs;
+}
+
+// writes the bytecode for source to target so later runs can load it without lexing or parsing
+int compileProgram(const std::string& source, const std::string& target) {
+    const std::shared_ptr<const SourceBuffer> sourceBuffer = SourceBuffer::fromFile(source);
+    if (!sourceBuffer) {
+        std::cerr << "Error: Could not open file: " << source << std::endl;
+        return 1;
+    }
+    ProgramFile::save(target, ProgramFile::compile(source, sourceBuffer), ProgramFile::hashBytes(sourceBuffer->getText()), source);
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
+    const std::string usage = std::string("Usage: ") + argv[0] + " <filename> [--verbose] [--tree-walk] [--stats] [--profile] [--line-buffered] [--no-cache]"
+        + "\n       " + argv[0] + " --compile <filename> [-o <output>]"
+        + "\n       " + argv[0] + " --batch <directory|listfile> [--jobs <n>] [--tree-walk] [--no-cache]"
+        + "\n       " + argv[0] + " --repl";
     if (argc < 2) { // check filename argument is given
-        std::cerr << "Usage: " << argv[0] << " <filename> [--verbose]" << std::endl;
+        std::cerr << usage << std::endl;
         return 1;
     }
     std::string filename = argv[1];
+    if (filename == "--compile") {
+        if (argc == 3) {return compileProgram(argv[2], std::string(argv[2]) + "c");}
+        if (argc == 5 && std::string(argv[3]) == "-o") {return compileProgram(argv[2], argv[4]);}
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    if (filename == "--repl") {
+        if (argc != 2) { // the session takes no options, rather than running a file called --repl
+            std::cerr << "--repl takes no other options" << std::endl;
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+        Repl repl(std::cout, std::cerr);
+        repl.run(std::cin, OutputBuffer::isInteractive());
+        return 0;
+    }
+    if (filename == "--batch") {
+        if (argc < 3) {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+        unsigned jobs = 0;
+        bool treeWalk = false;
+        bool cache = true;
+        for (int i = 3; i < argc; i++) {
+            const std::string flag = argv[i];
+            if ((flag == "--jobs" || flag == "-j") && i + 1 < argc) {
+                const std::optional<unsigned> parsed = parseJobs(argv[++i]);
+                if (!parsed) {
+                    std::cerr << "Invalid job count: " << argv[i] << std::endl;
+                    std::cerr << usage << std::endl;
+                    return 1;
+                }
+                jobs = *parsed;
+            }
+            else if (flag == "--tree-walk" || flag == "-t") {treeWalk = true;}
+            else if (flag == "--no-cache") {cache = false;}
+            else {
+                std::cerr << "Unknown batch option: " << flag << std::endl;
+                std::cerr << usage << std::endl;
+                return 1;
+            }
+        }
+        return runBatch(argv[2], jobs, treeWalk, cache ? ProgramFile::defaultCacheDirectory() : "");
+    }
     bool verbose = false;
-    if (argc >= 3) {
-        std::string flag = argv[2];
+    bool treeWalk = false;
+    bool stats = false;
+    bool profile = false;
+    bool lineBuffered = false;
+    bool cache = true;
+    for (int i = 2; i < argc; i++) {
+        std::string flag = argv[i];
         if (flag == "--verbose" || flag == "-v") {
             verbose = true;
         }
+        else if (flag == "--tree-walk" || flag == "-t") {
+            treeWalk = true;
+        }
+        else if (flag == "--stats" || flag == "-s") {
+            stats = true;
+        }
+        else if (flag == "--profile" || flag == "-p") {
+            profile = true;
+        }
+        else if (flag == "--line-buffered" || flag == "-l") {
+            lineBuffered = true;
+        }
+        else if (flag == "--no-cache") {
+            cache = false;
+        }
         else {
             std::cerr << "Unknown option: " << flag << std::endl;
-            std::cerr << "Usage: " << argv[0] << " <filename> [--verbose]" << std::endl;
+            std::cerr << usage << std::endl;
             return 1;
         }
     }
-    auto interpreter = Interpreter(filename, verbose);
+    OutputBuffer output(std::cout, lineBuffered || OutputBuffer::isInteractive());
+    OutputBuffer::Scope outputScope(&output);
+    const std::string cacheDirectory = cache ? ProgramFile::defaultCacheDirectory() : "";
+    try {auto interpreter = Interpreter(filename, verbose, treeWalk, stats, profile, cacheDirectory);}
+    catch (...) {
+        output.flush(); // whatever was printed before the error is still shown
+        throw;
+    }
     return 0;
 }
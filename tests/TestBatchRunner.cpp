@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <iomanip>
+#include "BatchRunner.h"
+#include "TestHelpers.h"
+
+namespace {
+// a fresh directory under the system temp directory holding one script per source, named in order
+std::vector<std::string> writeScripts(const std::filesystem::path& directory, const std::vector<std::string>& sources) {
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::vector<std::string> scripts;
+    for (std::size_t index = 0; index < sources.size(); index++) {
+        std::ostringstream name;
+        name << "script" << std::setw(3) << std::setfill('0') << index << ".vis";
+        scripts.push_back((directory / name.str()).string());
+        std::ofstream(scripts.back()) << sources[index];
+    }
+    return scripts;
+}
+}
+
+TEST(BatchRunnerTest, ScriptsRunIsolatedAndReportInOrder) {
+    std::vector<std::string> sources;
+    for (int index = 0; index < 24; index++) {
+        sources.push_back("func count(n){\n    var total = 0\n    while(n > 0){\n        var total = total + n\n        var n --\n"
+            "    }\n    return total\n}\nvar shared = " + std::to_string(index) + "\nout(shared, count(" +
+            std::to_string(index * 500) + "))\n");
+    }
+    sources.push_back("out(shared)\n"); // globals from the other scripts are never visible
+    sources.push_back("out(\"before\")\nout(1 / 0)\n");
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vis_batch_test";
+    const std::vector<std::string> scripts = writeScripts(directory, sources);
+
+    for (const bool treeWalk : {false, true}) {
+        std::vector<std::string> reported;
+        const BatchRunner runner(4, treeWalk);
+        const std::vector<BatchRunner::Result> results = runner.run(scripts, [&reported](const BatchRunner::Result& result) {
+            reported.push_back(result.filename);
+        });
+        ASSERT_EQ(results.size(), scripts.size());
+        EXPECT_EQ(reported, scripts);
+        for (std::size_t index = 0; index < 24; index++) {
+            EXPECT_EQ(results[index].filename, scripts[index]);
+            EXPECT_EQ(results[index].output, runVisSource(sources[index], treeWalk));
+            EXPECT_TRUE(results[index].error.empty());
+        }
+        EXPECT_EQ(results[24].output, "");
+        EXPECT_FALSE(results[24].error.empty());
+        EXPECT_EQ(results[25].output, "before \n"); // output printed before an error is kept
+        EXPECT_NE(results[25].error.find("Division by zero"), std::string::npos);
+    }
+
+    std::ostringstream report;
+    BatchRunner::printReport(report, BatchRunner(2).run(scripts), 10.0, 2);
+    EXPECT_NE(report.str().find("batch of 26 scripts on 2 jobs"), std::string::npos);
+    EXPECT_NE(report.str().find("failed"), std::string::npos);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(BatchRunnerTest, CollectsScriptsFromDirectoriesAndListFiles) {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vis_batch_collect";
+    const std::vector<std::string> scripts = writeScripts(directory, {"out(1)\n", "out(2)\n"});
+    std::filesystem::create_directories(directory / "nested");
+    std::ofstream(directory / "nested" / "inner.vis") << "out(3)\n";
+    std::ofstream(directory / "notes.txt") << "not a script\n";
+    EXPECT_EQ(BatchRunner::collectScripts(directory.string()),
+        std::vector<std::string>({(directory / "nested" / "inner.vis").string(), scripts[0], scripts[1]}));
+
+    const std::string listFile = (directory / "list.txt").string();
+    std::ofstream(listFile) << scripts[1] << "\r\n\n   \n" << scripts[0] << "\n";
+    EXPECT_EQ(BatchRunner::collectScripts(listFile), std::vector<std::string>({scripts[1], scripts[0]}));
+    EXPECT_THROW((void)BatchRunner::collectScripts((directory / "missing.txt").string()), std::runtime_error);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(BatchRunnerTest, FinishedScriptsLeaveNothingInTheSourceTable) {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vis_batch_sources";
+    const std::vector<std::string> scripts = writeScripts(directory, {"out(1)\n", "out(1 / 0)\n", "out(3)\n"});
+    const std::uint32_t freeId = SourceTable::registerFile("probe.vis");
+    SourceTable::releaseFile(freeId);
+    (void)BatchRunner(1).run(scripts);
+    const SourceRegistration after(SourceTable::registerFile("after.vis")); // every script gave back the id it took
+    EXPECT_EQ(after.getFileId(), freeId);
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "ConstantFolder.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+#include "TestHelpers.h"
+
+namespace {
+std::unique_ptr<Node> parseFirstStatement(const std::string& source) {
+    std::istringstream stream(source);
+    PositionHandler positionHandler("mock.vis", stream);
+    Lexer lexer(positionHandler);
+    Parser parser(lexer.tokenise());
+    return parser.parse();
+}
+}
+
+TEST(ConstantFolderTest, FoldsConstantSubtreesIntoLiterals) {
+    std::unique_ptr<Node> node = parseFirstStatement("var x = (2 + 3) * 4 - y % (10 / 5)\n");
+    ConstantFolder folder;
+    EXPECT_EQ(folder.fold(node), 6u);
+    const auto* assignment = dynamic_cast<VarAssignment*>(node.get());
+    ASSERT_NE(assignment, nullptr);
+    const auto* subtraction = dynamic_cast<BinaryOperator*>(assignment->getValue().get());
+    ASSERT_NE(subtraction, nullptr);
+    ASSERT_EQ(subtraction->getLeftNode()->getType(), NodeType::Number);
+    EXPECT_EQ(std::get<int>(subtraction->getLeftNode()->getToken().getValue()), 20);
+    const auto* modulo = dynamic_cast<BinaryOperator*>(subtraction->getRightNode().get());
+    ASSERT_NE(modulo, nullptr);
+    EXPECT_EQ(std::get<int>(modulo->getRightNode()->getToken().getValue()), 2);
+}
+
+TEST(ConstantFolderTest, LeavesErrorsAndBooleansForRunTime) {
+    std::unique_ptr<Node> division = parseFirstStatement("out(1 / 0)\n");
+    std::unique_ptr<Node> comparison = parseFirstStatement("out(1 < 2)\n");
+    ConstantFolder folder;
+    EXPECT_EQ(folder.fold(division), 0u);
+    EXPECT_EQ(folder.fold(comparison), 0u);
+    EXPECT_THROW(runVisSource("out(1 / 0)\n"), VisRunTimeError);
+    EXPECT_EQ(runVisSource("out(1 < 2, -3 * 2, \"a\" + \"b\")\n"), "true -6 ab \n");
+}
+
+TEST(ConstantFolderTest, PrunesDeadBranchesAndLoops) {
+    std::unique_ptr<Node> node = parseFirstStatement(
+        "func f(x){\n"
+        "    if (1 == 2) {\n"
+        "        out(\"never\")\n"
+        "    }\n"
+        "    else {\n"
+        "        out(x)\n"
+        "    }\n"
+        "    while (3 < 2) {\n"
+        "        out(x)\n"
+        "    }\n"
+        "    return x\n"
+        "}\n");
+    ConstantFolder folder;
+    EXPECT_GT(folder.fold(node), 0u);
+    const auto* funcDef = dynamic_cast<FuncDef*>(node.get());
+    ASSERT_NE(funcDef, nullptr);
+    const auto& body = funcDef->getFunctionBody();
+    ASSERT_EQ(body.size(), 2u);
+    EXPECT_EQ(body[0]->getType(), NodeType::LibCall);
+    EXPECT_EQ(body[1]->getType(), NodeType::ReturnCall);
+    EXPECT_EQ(folder.getRemovedCount(), 12u);
+
+    const std::string source = "if (2 > 1) {\n    out(\"taken\")\n}\nelse {\n    out(\"dead\")\n}\n";
+    EXPECT_EQ(runVisSource(source), "taken \n");
+    EXPECT_EQ(runVisSource(source, true), "taken \n");
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "Engine.h"
+#include "Error.h"
+#include "ProgramFile.h"
+#include "TestHelpers.h"
+
+namespace {
+const std::string ruleSource =
+    "func discount(total){\n"
+    "    if(total > 100){\n"
+    "        return total / 10\n"
+    "    }\n"
+    "    return 0\n"
+    "}\n"
+    "out(customer, discount(total))\n"
+    "total - discount(total)\n";
+}
+
+TEST(EngineTest, ProgramRunsManyTimesWithHostGlobals) {
+    const Program program = Engine::compile(ruleSource, "rule.vis");
+    EXPECT_EQ(program.getName(), "rule.vis");
+    Engine engine;
+    for (int total = 50; total <= 250; total += 100) {
+        const std::unique_ptr<Context> globals = Engine::makeContext();
+        Engine::setGlobal(*globals, "customer", Value::fromString("ada"));
+        Engine::setGlobal(*globals, "total", Value(static_cast<double>(total)));
+        const Engine::Result result = engine.run(program, *globals);
+        const double discount = total > 100 ? total / 10.0 : 0;
+        EXPECT_DOUBLE_EQ(result.value.getNumberValue(), total - discount);
+        EXPECT_EQ(result.output, runVisSource("var customer = \"ada\"\nvar total = " + std::to_string(total) + ".0\n" + ruleSource));
+    }
+    EXPECT_THROW(engine.run(program), VisRunTimeError); // fresh globals know nothing about customer
+}
+
+TEST(EngineTest, PersistentGlobalsKeepDefinitionsBetweenRuns) {
+    Engine engine;
+    const std::unique_ptr<Context> globals = Engine::makeContext("session");
+    Engine::setGlobal(*globals, "count", Value(0));
+    const Program increment = Engine::compile("var count = count + 1\nfunc twice(n){\n    return n * 2\n}\n");
+    for (int run = 0; run < 3; run++) {(void)engine.run(increment, *globals);}
+    EXPECT_EQ(Engine::getGlobal(*globals, "count").getIntValue(), 3);
+
+    const Program useFunction = Engine::compile("out(\"doubled\")\ntwice(count)\n");
+    const Engine::Result result = engine.run(useFunction, *globals);
+    EXPECT_EQ(result.value.getIntValue(), 6);
+    EXPECT_EQ(result.output, "doubled \n");
+    EXPECT_THROW((void)Engine::getGlobal(*Engine::makeContext(), "count"), VisRunTimeError);
+}
+
+TEST(EngineTest, ErrorsLeaveTheEngineUsable) {
+    EXPECT_THROW((void)Engine::compile("var = 2\n"), InvalidSyntaxError);
+    Engine engine;
+    const Program failing = Engine::compile("out(\"lost\")\nout(1 / 0)\n");
+    EXPECT_THROW(engine.run(failing), Error);
+    const Engine::Result result = engine.run(Engine::compile("out(\"kept\")\n\"text\"\n"));
+    EXPECT_EQ(result.output, "kept \n"); // nothing the failed run printed carries over
+    EXPECT_EQ(result.value.getStringValue(), "text");
+
+    const std::string filename = (std::filesystem::temp_directory_path() / "vis_engine_test.visc").string();
+    ProgramFile::save(filename, ProgramFile::compile("engine.vis", SourceBuffer::fromString(ruleSource)), 0, "engine.vis");
+    const std::unique_ptr<Context> globals = Engine::makeContext();
+    Engine::setGlobal(*globals, "customer", Value::fromString("bo"));
+    Engine::setGlobal(*globals, "total", Value(300));
+    EXPECT_EQ(engine.run(Engine::compileFile(filename), *globals).value.getIntValue(), 270);
+    std::filesystem::remove(filename);
+}
+
+TEST(EngineTest, ProgramsReleaseTheirSourceWhenDropped) {
+    const std::uint32_t freeId = SourceTable::registerFile("probe.vis");
+    SourceTable::releaseFile(freeId);
+    {
+        const Program program = Engine::compile("out(1)\n", "held.vis");
+        const Program copy = program;
+        EXPECT_EQ(SourceTable::getFileName(freeId), "held.vis");
+        EXPECT_EQ(SourceTable::getLineText(program.getChunk().positions.front()), "out(1)");
+    }
+    EXPECT_EQ(SourceTable::getFileName(freeId), "null");
+    EXPECT_THROW((void)Engine::compile("var = 2\n", "broken.vis"), InvalidSyntaxError);
+    const SourceRegistration after(SourceTable::registerFile("after.vis")); // neither compile kept an entry
+    EXPECT_EQ(after.getFileId(), freeId);
+}
@@ -5,10 +5,15 @@
 #include "Token.h"
 #include "Literal.h"
 #include "Context.h"
+#include "Interpreter.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 
-const std::map<std::string, std::string> dummyPos = { {"line", "0"}, {"charPos", "0"} };
+const Position dummyPos = {0, 0, 0};
 
 static const std::vector<TokenType> allTokenTypes = {
     TokenType::NULL_,
@@ -54,4 +59,23 @@ inline std::unique_ptr<Node> makeNumbernode(int number) {
     return std::make_unique<Number>(Token(TokenType::INT, dummyPos, number));
 }
 
+// writes source to a temporary file, interprets it and returns everything printed to std::cout
+inline std::string runVisSource(const std::string& source, const bool treeWalk = false) {
+    const std::string filename = "temp_run.vis";
+    std::ofstream tempFile(filename);
+    tempFile << source;
+    tempFile.close();
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+    try {Interpreter::interpretFile(filename, false, treeWalk);}
+    catch (...) {
+        std::cout.rdbuf(oldCout);
+        std::remove(filename.c_str());
+        throw;
+    }
+    std::cout.rdbuf(oldCout);
+    std::remove(filename.c_str());
+    return buffer.str();
+}
+
 #endif //THESTHELPERS_H
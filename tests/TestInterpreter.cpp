@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <sstream>
@@ -7,6 +8,8 @@
 #include "Parser.h"
 #include "Literal.h"
 #include "Context.h"
+#include "ExecutionStats.h"
+#include "Profiler.h"
 
 
 TEST(HelperFunctionsTest, testPrintTokens) {
@@ -169,7 +172,7 @@ TEST(InterpreterTest, testVisitIfStatementNode) {
     std::unique_ptr<Node> comparison = makeNumbernode(10);
 
     std::vector<std::unique_ptr<Node>> ifNodes;
-    ifNodes.push_back(std::make_unique<Number>(Token(TokenType::FLOAT, dummyPos, 5.5f)));
+    ifNodes.push_back(std::make_unique<Number>(Token(TokenType::FLOAT, dummyPos, 5.5)));
     std::vector<std::unique_ptr<Node>> elseNodes;
     elseNodes.push_back(std::make_unique<StringNode>(Token(TokenType::STRING, dummyPos, "testString")));
 
@@ -196,7 +199,7 @@ TEST(InterpreterTest, testVisitWhileStatementNode) {
     auto* boolLiteral = dynamic_cast<BoolLiteral*>(result.get());
     ASSERT_NE(boolLiteral, nullptr);
     EXPECT_EQ(boolLiteral->getNumberValue(), true);
-    EXPECT_EQ(context.getSymbolTable().getLiteral("x")->getNumberValue(), 10);
+    EXPECT_EQ(context.getSymbolTable().getValue("x").getNumberValue(), 10);
 }
 
 TEST(InterpreterTest, testVisitLibCall) {
@@ -226,10 +229,45 @@ TEST(InterpreterTest, testVisitFuncDefinition) {
     ASSERT_NE(result, nullptr);
     auto* funcLiteral = dynamic_cast<FunctionLiteral*>(result.get());
     ASSERT_NE(funcLiteral, nullptr);
-    auto* symbolFuncLiteral = dynamic_cast<FunctionLiteral*>(context.getSymbolTable().getLiteral("testFunc"));
+    const FunctionLiteral* symbolFuncLiteral = context.getSymbolTable().getValue("testFunc").getFunction();
     ASSERT_NE(symbolFuncLiteral, nullptr);
 }
 
+TEST(InterpreterTest, testFuncDefinitionSharesBody) {
+    auto context = makeMockContext();
+    std::vector<Token> args;
+    args.push_back(Token(TokenType::IDENTIFIER, dummyPos, "argName"));
+    std::vector<std::unique_ptr<Node>> body;
+    body.push_back(std::make_unique<ReturnCall>(Token(TokenType::KEYWORD, dummyPos, "return"), makeNumbernode(10)));
+    const std::unique_ptr<Node> mockNode = std::make_unique<FuncDef>(
+        Token(TokenType::IDENTIFIER, dummyPos, "testFunc"),
+        std::move(args),
+        std::move(body));
+    Interpreter::visit(mockNode, &context);
+    const FunctionLiteral* funcLiteral = context.getSymbolTable().getValue("testFunc").getFunction();
+    ASSERT_NE(funcLiteral, nullptr);
+    const auto* funcDef = dynamic_cast<FuncDef*>(mockNode.get());
+    EXPECT_EQ(&funcLiteral->getBody(), funcDef->getSharedBody().get());
+    EXPECT_EQ(&funcLiteral->getArgs(), funcDef->getSharedArguments().get());
+    const std::unique_ptr<Literal> copy = funcLiteral->clone();
+    EXPECT_EQ(&dynamic_cast<FunctionLiteral*>(copy.get())->getBody(), &funcLiteral->getBody());
+}
+
+TEST(InterpreterTest, testFunctionsDefinedInBlocksOutliveTheirStatement) {
+    const std::string source =
+        "if (true) {\n"
+        "    func f(x) {\n"
+        "        return x * 2 + 1\n"
+        "    }\n"
+        "}\n"
+        "var a = 1 + 2\n"
+        "var b = \"some text\"\n"
+        "out(a, b)\n"
+        "out(f(10))\n";
+    EXPECT_EQ(runVisSource(source, true), "3 some text \n21 \n");
+    EXPECT_EQ(runVisSource(source), "3 some text \n21 \n");
+}
+
 TEST(InterpreterTest, testVisitFuncCall) {
     auto context = makeMockContext();
     std::unique_ptr<Context> funcContext = std::make_unique<Context>(makeMockContext());
@@ -255,3 +293,147 @@ TEST(InterpreterTest, testVisitFuncCall) {
 }
 
 
+
+TEST(InterpreterTest, testReturnStopsEnclosingLoops) {
+    const std::string source =
+        "func firstOver(limit){\n"
+        "    for (var i = 0, i < 100, var i ++){\n"
+        "        while (i > limit){\n"
+        "            return i\n"
+        "        }\n"
+        "    }\n"
+        "    out(\"unreachable\")\n"
+        "}\n"
+        "out(firstOver(3), firstOver(7))\n";
+    EXPECT_EQ(runVisSource(source, true), "4 8 \n");
+    EXPECT_THROW(runVisSource("return 5\n", true), VisRunTimeError);
+}
+
+TEST(InterpreterTest, testTailCallsRunInConstantStack) {
+    const std::string source =
+        "func sum(n, total){\n"
+        "    if (n == 0) {\n"
+        "        return total\n"
+        "    }\n"
+        "    return sum(n - 1, total + n)\n"
+        "}\n"
+        "func isEven(n){\n"
+        "    if (n == 0) {\n"
+        "        return true\n"
+        "    }\n"
+        "    return isOdd(n - 1)\n"
+        "}\n"
+        "func isOdd(n){\n"
+        "    if (n == 0) {\n"
+        "        return false\n"
+        "    }\n"
+        "    return isEven(n - 1)\n"
+        "}\n"
+        "func depth(n){\n"
+        "    if (n == 0) {\n"
+        "        return 0\n"
+        "    }\n"
+        "    return 1 + depth(n - 1)\n"
+        "}\n"
+        "out(sum(200000, 0), isEven(100001), depth(50))\n";
+    EXPECT_EQ(runVisSource(source, true), "20000100000 false 50 \n");
+}
+
+TEST(InterpreterTest, testContextCompletionRecord) {
+    auto context = makeMockContext();
+    EXPECT_FALSE(context.isInterrupted());
+    context.complete(Completion::Return, Value(3));
+    EXPECT_EQ(context.getCompletion(), Completion::Return);
+    const Value returned = context.takeCompletionValue();
+    EXPECT_EQ(returned.getNumberValue(), 3);
+    EXPECT_FALSE(context.isInterrupted());
+}
+
+TEST(InterpreterTest, testCallSiteCacheTracksBindings) {
+    SymbolTable global;
+    global.set("f", Value(1));
+    SymbolTable frame(&global);
+    CallSiteCache cache;
+    const Value* binding = &frame.getCachedValue("f", cache);
+    EXPECT_EQ(cache.owner, &global);
+    global.set("f", Value(2)); // rebinding updates the cached binding in place
+    EXPECT_EQ(&frame.getCachedValue("f", cache), binding);
+    EXPECT_EQ(frame.getCachedValue("f", cache).getNumberValue(), 2);
+    frame.set("f", Value(3)); // a shadowing binding in a nearer table is never skipped
+    EXPECT_EQ(frame.getCachedValue("f", cache).getNumberValue(), 3);
+    EXPECT_EQ(cache.owner, &frame);
+    const std::uint64_t version = frame.getVersion();
+    frame.remove("f");
+    EXPECT_NE(frame.getVersion(), version);
+    EXPECT_EQ(frame.getCachedValue("f", cache).getNumberValue(), 2);
+    global.remove("f");
+    EXPECT_THROW((void)frame.getCachedValue("f", cache), VisRunTimeError);
+}
+
+TEST(InterpreterTest, testExecutionStatsOnlyCountWhileActive) {
+    const std::string source = "func twice(x){\n    return x * 2\n}\nout(twice(2), twice(3))\n";
+    ExecutionStats treeStats;
+    {
+        ExecutionStats::Scope statsScope(&treeStats);
+        Interpreter::setInstrumented(true);
+        EXPECT_EQ(runVisSource(source, true), "4 6 \n");
+        Interpreter::setInstrumented(false);
+    }
+    EXPECT_EQ(treeStats.functionCalls, 2u);
+    EXPECT_EQ(treeStats.nodeVisits[static_cast<std::size_t>(NodeType::FuncCall)], 2u);
+    EXPECT_EQ(treeStats.nodeVisits[static_cast<std::size_t>(NodeType::BinaryOperator)], 2u);
+    EXPECT_EQ(treeStats.symbolLookups, 2u);
+    EXPECT_GT(treeStats.literalAllocations, 0u);
+
+    ExecutionStats vmStats;
+    {
+        ExecutionStats::Scope statsScope(&vmStats);
+        EXPECT_EQ(runVisSource(source), "4 6 \n");
+    }
+    EXPECT_EQ(vmStats.functionCalls, 2u);
+    EXPECT_EQ(vmStats.instructions[static_cast<std::size_t>(OpCode::CALL)], 2u);
+    EXPECT_EQ(vmStats.instructions[static_cast<std::size_t>(OpCode::MULTIPLY)], 2u);
+    runVisSource(source);
+    EXPECT_EQ(vmStats.functionCalls, 2u);
+
+    std::ostringstream report;
+    vmStats.print(report, "mock.vis");
+    EXPECT_NE(report.str().find("function calls"), std::string::npos);
+    EXPECT_NE(report.str().find("CALL"), std::string::npos);
+}
+
+TEST(InterpreterTest, testProfilerAttributesCallsAndLines) {
+    const std::string source = "func twice(x){\n    return x * 2\n}\nout(twice(2), twice(3))\n";
+    for (const bool treeWalk : {true, false}) {
+        Profiler profiler("mock.vis", 1); // samples every tick so even this short run is charged to each line
+        {
+            Profiler::Scope profilerScope(&profiler);
+            Interpreter::setInstrumented(treeWalk);
+            EXPECT_EQ(runVisSource(source, treeWalk), "4 6 \n");
+            Interpreter::setInstrumented(false);
+        }
+        const std::vector<Profiler::FunctionProfile> functions = profiler.getFunctionProfiles();
+        const auto twice = std::find_if(functions.begin(), functions.end(),
+            [](const Profiler::FunctionProfile& profile) {return profile.name == "twice";});
+        const auto root = std::find_if(functions.begin(), functions.end(),
+            [](const Profiler::FunctionProfile& profile) {return profile.name == "mock.vis";});
+        ASSERT_NE(twice, functions.end());
+        ASSERT_NE(root, functions.end());
+        EXPECT_EQ(twice->calls, 2u);
+        EXPECT_EQ(twice->inclusive, twice->exclusive);
+        EXPECT_GE(root->inclusive, twice->inclusive);
+
+        const std::vector<Profiler::LineProfile> lines = profiler.getLineProfiles();
+        EXPECT_TRUE(std::any_of(lines.begin(), lines.end(),
+            [](const Profiler::LineProfile& profile) {return profile.position.line == 1;}));
+        std::ostringstream stacks;
+        profiler.writeCollapsedStacks(stacks);
+        EXPECT_NE(stacks.str().find("mock.vis:4;twice:2 "), std::string::npos);
+    }
+}
+
+TEST(InterpreterTest, testVisitUnknownNodeThrows) {
+    auto context = makeMockContext();
+    const std::unique_ptr<Node> mockNode = std::make_unique<EndOfFile>(Token(TokenType::EOF_, dummyPos));
+    EXPECT_THROW(Interpreter::visit(mockNode, &context), VisRunTimeError);
+}
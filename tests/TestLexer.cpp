@@ -1,5 +1,7 @@
 #include <Error.h>
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
 #include <sstream>
 #include "Lexer.h"
 #include "Token.h"
@@ -17,7 +19,7 @@ INSTANTIATE_TEST_SUITE_P(AllTokenTypes,
     ::testing::Values(
         // Primitives
         LexerInput{"42", TokenType::INT, 42},
-        LexerInput{"3.14", TokenType::FLOAT, 3.14f},
+        LexerInput{"3.14", TokenType::FLOAT, 3.14},
         LexerInput{"\"hello\"", TokenType::STRING, std::string("hello")},
         // Operators
         LexerInput{"+", TokenType::PLUS, {}},
@@ -65,7 +67,7 @@ TEST_P(LexerTest, ProducesExpectedTokenType) {
     Lexer lexer(ph);
 
     auto tokens = lexer.tokenise();
-    const auto& line = tokens.begin()->second;
+    const TokenLine line = tokens.getLine(0);
 
     ASSERT_FALSE(line.empty());
 
@@ -80,8 +82,8 @@ TEST_P(LexerTest, ProducesExpectedTokenType) {
 
         if (std::holds_alternative<int>(expectedValue)) {
             EXPECT_EQ(std::get<int>(actualValue), std::get<int>(expectedValue));
-        } else if (std::holds_alternative<float>(expectedValue)) {
-            EXPECT_FLOAT_EQ(std::get<float>(actualValue), std::get<float>(expectedValue));
+        } else if (std::holds_alternative<double>(expectedValue)) {
+            EXPECT_DOUBLE_EQ(std::get<double>(actualValue), std::get<double>(expectedValue));
         } else if (std::holds_alternative<std::string>(expectedValue)) {
             EXPECT_EQ(std::get<std::string>(actualValue), std::get<std::string>(expectedValue));
         } else if (std::holds_alternative<bool>(expectedValue)) {
@@ -95,8 +97,8 @@ TEST(LexerTest, TokenizeCommentedLine) {
     PositionHandler ph("mock.vis", stream);
     const Lexer lexer = Lexer(ph);
     auto tokens = lexer.tokenise();
-    ASSERT_EQ(tokens.size(), 2);
-    const auto& line = tokens.at(0);
+    ASSERT_EQ(tokens.lineCount(), 2);
+    const TokenLine line = tokens.getLine(0);
     ASSERT_EQ(line.size(), 4);
 
     EXPECT_EQ(line[0].getType(), TokenType::IDENTIFIER);
@@ -140,3 +142,75 @@ TEST(LexerTest, TokenizeUnrecognisedChar) {
 }
 
 
+
+TEST(LexerTest, ErrorLooksUpLineTextFromLineTable) {
+    std::istringstream stream("var x = 1\nvar y = |");
+    PositionHandler ph("mock.vis", stream);
+    const Lexer lexer = Lexer(ph);
+    try {
+        auto tokens = lexer.tokenise();
+        FAIL() << "expected IllegalCharError";
+    }
+    catch (const IllegalCharError& error) {
+        const std::string message = error.what();
+        EXPECT_NE(message.find("line: 2"), std::string::npos);
+        EXPECT_NE(message.find("mock.vis"), std::string::npos);
+        EXPECT_NE(message.find("{var y = |}"), std::string::npos);
+    }
+}
+
+TEST(LexerTest, SourceBufferMapsFilesAndReadsStreams) {
+    const std::string filename = "temp_source.vis";
+    std::ofstream("temp_source.vis") << "var x = 1\nout(x)";
+    const std::shared_ptr<const SourceBuffer> mapped = SourceBuffer::fromFile(filename);
+    std::remove(filename.c_str());
+    ASSERT_NE(mapped, nullptr);
+    EXPECT_TRUE(mapped->isMapped());
+    EXPECT_EQ(mapped->getText(), "var x = 1\nout(x)");
+    EXPECT_EQ(SourceBuffer::fromFile("missing_source.vis"), nullptr);
+    std::istringstream stream("var x = 1\n");
+    const std::shared_ptr<const SourceBuffer> streamed = SourceBuffer::fromStream(stream);
+    EXPECT_FALSE(streamed->isMapped());
+    EXPECT_EQ(streamed->size(), 10);
+}
+
+TEST(LexerTest, TokensAreSlicedFromSourceBuffer) {
+    PositionHandler ph("mock.vis", SourceBuffer::fromString("var total = 12.5\nout(\"hi there\", total)\n"));
+    const Lexer lexer = Lexer(ph);
+    auto tokens = lexer.tokenise();
+    ASSERT_EQ(tokens.lineCount(), 3);
+    const TokenLine first = tokens.getLine(0);
+    EXPECT_EQ(std::get<std::string>(first[1].getValue()), "total");
+    EXPECT_DOUBLE_EQ(std::get<double>(first[3].getValue()), 12.5);
+    const TokenLine second = tokens.getLine(1);
+    EXPECT_EQ(std::get<std::string>(second[2].getValue()), "hi there");
+    EXPECT_EQ(SourceTable::getLineText(second[2].getPos()), "out(\"hi there\", total)");
+}
+
+TEST(LexerTest, ReleasedFilesGiveTheirIdToTheNextFile) {
+    std::uint32_t fileId;
+    {
+        const SourceRegistration registration(SourceTable::registerFile("first.vis", SourceBuffer::fromString("out(1)\n")));
+        fileId = registration.getFileId();
+        EXPECT_EQ(SourceTable::getLineText(Position{fileId, 0, 0}), "out(1)");
+    }
+    EXPECT_EQ(SourceTable::getFileName(fileId), "null");
+    EXPECT_EQ(SourceTable::getLineText(Position{fileId, 0, 0}), "");
+    const SourceRegistration next(SourceTable::registerFile("second.vis"));
+    EXPECT_EQ(next.getFileId(), fileId);
+    EXPECT_EQ(SourceTable::getFileName(fileId), "second.vis");
+}
+
+TEST(LexerTest, TokenStreamIsContiguousAcrossLines) {
+    std::istringstream stream("var x = 1\n\nout(x) ~ comment\n");
+    PositionHandler ph("mock.vis", stream);
+    const Lexer lexer = Lexer(ph);
+    const TokenStream tokens = lexer.tokenise();
+    ASSERT_EQ(tokens.lineCount(), 4); // three source lines and the EOF line
+    EXPECT_EQ(tokens.size(), 12);
+    EXPECT_EQ(tokens.getLine(1).size(), 1);
+    EXPECT_EQ(tokens.getLine(1)[0].getType(), TokenType::EOL);
+    EXPECT_EQ(tokens.lineEnd(0), tokens.lineStart(1));
+    EXPECT_EQ(&tokens.getLine(2)[0], &tokens[tokens.lineStart(2)]);
+    EXPECT_EQ(tokens.getLine(3)[0].getType(), TokenType::EOF_);
+}
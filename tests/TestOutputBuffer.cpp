@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "Error.h"
+#include "OutputBuffer.h"
+#include "TestHelpers.h"
+
+TEST(OutputBufferTest, FormatsValuesLikeTheirStringValue) {
+    std::ostringstream target;
+    {
+        OutputBuffer output(target);
+        const std::vector<Value> values = {
+            Value(42), Value(std::int64_t{-9223372036854775807LL - 1}), Value(2.5), Value(-0.1), Value(1e300),
+            Value(true), Value(false), Value(std::shared_ptr<const Literal>(std::make_shared<StringLiteral>("text")))
+        };
+        std::string expected;
+        for (const Value& value : values) {
+            output.write(value);
+            output.write(" ");
+            expected += value.getStringValue() + " ";
+        }
+        output.endLine();
+        EXPECT_EQ(target.str(), "");
+        output.flush();
+        EXPECT_EQ(target.str(), expected + "\n");
+    }
+}
+
+TEST(OutputBufferTest, WritesOutOnlyWhenFullFlushedOrLineBuffered) {
+    std::ostringstream target;
+    OutputBuffer output(target, false, 512);
+    output.write(std::string(500, 'a'));
+    EXPECT_EQ(target.str(), "");
+    output.write(std::string(20, 'b'));
+    EXPECT_EQ(target.str(), std::string(500, 'a'));
+    output.write(std::string(2000, 'c')); // longer than the whole buffer, so it bypasses it after a flush
+    EXPECT_EQ(target.str(), std::string(500, 'a') + std::string(20, 'b') + std::string(2000, 'c'));
+
+    std::ostringstream lineTarget;
+    OutputBuffer lineOutput(lineTarget, true);
+    lineOutput.write(Value(7));
+    EXPECT_EQ(lineTarget.str(), "");
+    lineOutput.endLine();
+    EXPECT_EQ(lineTarget.str(), "7\n");
+}
+
+TEST(OutputBufferTest, FlushBuiltinWritesOutTheScopesBuffer) {
+    std::ostringstream target;
+    const std::string source = "out(1, \"a\")\nflush()\nout(2.5)\n";
+    for (const bool treeWalk : {true, false}) {
+        target.str("");
+        OutputBuffer output(target);
+        OutputBuffer::Scope outputScope(&output);
+        EXPECT_EQ(runVisSource(source, treeWalk), "");
+        EXPECT_EQ(target.str(), "1 a \n");
+        EXPECT_EQ(output.getBufferedSize(), std::string("2.500000 \n").size());
+        output.flush();
+        EXPECT_EQ(target.str(), "1 a \n2.500000 \n");
+    }
+    EXPECT_THROW(runVisSource("flush(1)\n"), VisRunTimeError);
+    EXPECT_THROW(runVisSource("flush(1)\n", true), VisRunTimeError);
+    EXPECT_EQ(runVisSource("out(3)\nflush()\n"), "3 \n");
+}
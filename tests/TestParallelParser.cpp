@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "TestHelpers.h"
+#include "Error.h"
+#include "Lexer.h"
+#include "NodeArena.h"
+#include "ParallelParser.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+
+namespace {
+const std::string piecesSource =
+    "var x = 1\n"
+    "func first(a){\n"
+    "    ~ a comment with a brace {\n"
+    "    return a + 1\n"
+    "}\n"
+    "var s = \"func in a string {\"\n"
+    "if(x > 0){\n"
+    "    out(first(x))\n"
+    "}\n"
+    "else{\n"
+    "    out(0)\n"
+    "}\n"
+    "func second(a){\n"
+    "    var y = (a +\n"
+    "func nested\n"
+    "    return y\n"
+    "}\n"
+    "  func third(a){\n"
+    "    return second(a)\n"
+    "}\n"
+    "function_call = 1\n"
+    "out(third(2))\n";
+
+// each top level statement printed with the position it starts at
+std::vector<std::string> describeStatements(const std::function<std::unique_ptr<Node>()>& parse) {
+    std::vector<std::string> statements;
+    while (true) {
+        const std::unique_ptr<Node> node = parse();
+        if (!node) {continue;}
+        if (node->getType() == NodeType::EndOfFile) {break;}
+        std::ostringstream os;
+        os << node->getToken().getPos().line << ":" << node->getToken().getPos().charPos << " " << *node;
+        statements.push_back(os.str());
+    }
+    return statements;
+}
+
+std::vector<std::string> parseSequentially(const std::string& source) {
+    PositionHandler positionHandler("sequential.vis", SourceBuffer::fromString(source));
+    Parser parser(Lexer(positionHandler).tokenise());
+    return describeStatements([&parser] {return parser.parse();});
+}
+}
+
+TEST(ParallelParserTest, SplitsOnlyBeforeTopLevelFunctions) {
+    const std::vector<ParallelParser::Piece> pieces = ParallelParser::split(piecesSource, 1);
+    ASSERT_EQ(pieces.size(), 3u); // nothing after the parenthesis second leaves open is a boundary
+    EXPECT_EQ(pieces[0].firstLine, 0);
+    EXPECT_EQ(pieces[1].firstLine, 1);
+    EXPECT_EQ(pieces[2].firstLine, 12);
+    EXPECT_EQ(pieces[1].text.substr(0, 10), "func first");
+    EXPECT_EQ(pieces[2].text.substr(0, 11), "func second");
+    std::string joined;
+    for (const ParallelParser::Piece& piece : pieces) {joined += piece.text;}
+    EXPECT_EQ(joined, piecesSource);
+
+    EXPECT_EQ(ParallelParser::split(piecesSource, piecesSource.size()).size(), 1u);
+    EXPECT_EQ(ParallelParser::split("}\nfunc a(){\n}\n", 1).size(), 1u); // unbalanced input is never split
+    EXPECT_EQ(ParallelParser::split("", 1).size(), 1u);
+    EXPECT_EQ(ParallelParser::chooseThreadCount(1024), 1u);
+}
+
+TEST(ParallelParserTest, StatementsMatchTheSequentialParser) {
+    std::string source;
+    for (int index = 0; index < 40; index++) {
+        source += "func f" + std::to_string(index) + "(a, b){\n    if(a < b){\n        return a * " +
+            std::to_string(index) + "\n    }\n    return \"}\" + b\n}\nout(f" + std::to_string(index) + "(1, 2))\n";
+    }
+    const std::vector<std::string> expected = parseSequentially(source);
+    ASSERT_EQ(expected.size(), 80u);
+    NodeArena arena;
+    NodeArena::Scope arenaScope(arena);
+    ParallelParser parallelParser("parallel.vis", SourceBuffer::fromString(source), 4, 1);
+    EXPECT_EQ(parallelParser.getPieceCount(), 40u);
+    EXPECT_EQ(describeStatements([&parallelParser] {return parallelParser.parse();}), expected);
+    EXPECT_GT(arena.getBlockCount(), 0u); // the workers' nodes now belong to the caller's arena
+    EXPECT_EQ(parallelParser.parse()->getType(), NodeType::EndOfFile);
+}
+
+TEST(ParallelParserTest, ErrorsSurfaceInSourceOrder) {
+    const std::string source = "out(1)\nfunc a(){\n    return 1\n}\nvar = 2\nfunc b(){\n    return 2\n}\nout(b())\n";
+    ParallelParser parallelParser("errors.vis", SourceBuffer::fromString(source), 3, 1);
+    EXPECT_EQ(parallelParser.parse()->getType(), NodeType::LibCall);
+    EXPECT_EQ(parallelParser.parse()->getType(), NodeType::FuncDef);
+    EXPECT_THROW(parallelParser.parse(), InvalidSyntaxError); // statements after the bad line are never handed out
+    EXPECT_EQ(parallelParser.parse()->getType(), NodeType::EndOfFile);
+
+    const std::string badCharacter = "var = 2\nfunc a(){\n    return 1 $ 2\n}\n";
+    EXPECT_THROW(ParallelParser("errors.vis", SourceBuffer::fromString(badCharacter), 2, 1), IllegalCharError);
+    try {ParallelParser("errors.vis", SourceBuffer::fromString(badCharacter), 2, 1);}
+    catch (const IllegalCharError& error) {EXPECT_NE(std::string(error.what()).find("line: 3"), std::string::npos);}
+}
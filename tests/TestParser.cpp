@@ -4,6 +4,9 @@
 #include "Parser.h"
 #include "Token.h"
 #include "Node.h"
+#include "NodeArena.h"
+#include "Lexer.h"
+#include "PositionHandler.h"
 
 TEST(ParserTest, ParsesSimpleVariableAssignment) {
     std::vector<Token> tokens = {
@@ -228,7 +231,7 @@ TEST(ParserTest, ParsesIfSatement) {
     EXPECT_EQ(std::get<int>(rightNum->getToken().getValue()), 2);
 
     // Check that the binary operator is PLUS
-    EXPECT_EQ(trueBinOp->getOperatorNode().getToken().getType(), TokenType::PLUS);
+    EXPECT_EQ(trueBinOp->getOperatorKind(), OperatorKind::Add);
 
     // Check the false branch (else block)
     const auto& falseBody = ifStatement->getElseBlock();
@@ -257,7 +260,7 @@ TEST(ParserTest, ParsesIfSatement) {
     EXPECT_EQ(std::get<int>(falseRightNum->getToken().getValue()), 4);
 
     // Check that the binary operator is MINUS
-    EXPECT_EQ(falseBinOp->getOperatorNode().getToken().getType(), TokenType::MINUS);
+    EXPECT_EQ(falseBinOp->getOperatorKind(), OperatorKind::Subtract);
 
 }
 
@@ -335,7 +338,7 @@ TEST(ParserTest, ParsesWhileSatement) {
     EXPECT_EQ(std::get<int>(rightNum->getToken().getValue()), 2);
 
     // Check that the binary operator is PLUS
-    EXPECT_EQ(trueBinOp->getOperatorNode().getToken().getType(), TokenType::PLUS);
+    EXPECT_EQ(trueBinOp->getOperatorKind(), OperatorKind::Add);
 }
 
 TEST(ParserTest, ParsesForSatement) {
@@ -423,8 +426,61 @@ TEST(ParserTest, ParsesForSatement) {
     EXPECT_EQ(std::get<int>(rightNum->getToken().getValue()), 2);
 
     // Check that the binary operator is PLUS
-    EXPECT_EQ(trueBinOp->getOperatorNode().getToken().getType(), TokenType::PLUS);
+    EXPECT_EQ(trueBinOp->getOperatorKind(), OperatorKind::Add);
 }
 
+TEST(ParserTest, AllocatesNodesFromActiveArena) {
+    std::vector<Token> tokens = {
+        Token(TokenType::KEYWORD, dummyPos, "var"),
+        Token(TokenType::IDENTIFIER, dummyPos, "x"),
+        Token(TokenType::EQUALS, dummyPos),
+        Token(TokenType::INT, dummyPos, 1),
+        Token(TokenType::PLUS, dummyPos),
+        Token(TokenType::INT, dummyPos, 2),
+        Token(TokenType::EOL, dummyPos)
+    };
+    std::map<int, std::vector<Token>> tokenMap = { {0, tokens}, {1, {Token(TokenType::EOF_, dummyPos)}} };
+    NodeArena arena;
+    std::unique_ptr<Node> node;
+    {
+        NodeArena::Scope scope(arena);
+        Parser parser(tokenMap);
+        node = parser.parse();
+    }
+    ASSERT_NE(node, nullptr);
+    EXPECT_GE(arena.getBytesUsed(), sizeof(VarAssignment) + sizeof(BinaryOperator) + 2 * sizeof(Number));
+    EXPECT_EQ(arena.getBlockCount(), 1);
+    const std::size_t usedBefore = arena.getBytesUsed();
+    const std::unique_ptr<Node> heapNode = node->clone(); // no arena active, comes from the heap
+    EXPECT_EQ(arena.getBytesUsed(), usedBefore);
+    node.reset();
+    EXPECT_EQ(heapNode->getType(), NodeType::VarAssgnment);
+    arena.rewind(NodeArena::Mark{0, 0, 0, 0});
+    EXPECT_EQ(arena.getBytesUsed(), 0);
+    EXPECT_EQ(arena.getBlockCount(), 1); // the first block is kept for reuse
+}
 
-
+TEST(ParserTest, RecognisesCountedForLoops) {
+    const auto parseLoop = [](const std::string& source) {
+        std::istringstream stream(source);
+        PositionHandler positionHandler("mock.vis", stream);
+        Lexer lexer(positionHandler);
+        return Parser(lexer.tokenise()).parse();
+    };
+    const std::unique_ptr<Node> reading = parseLoop("for (var i = 0, i < n, var i ++){\n    out(i)\n}\n");
+    const CountedLoop& readingLoop = dynamic_cast<ForStmt*>(reading.get())->getCountedLoop();
+    EXPECT_TRUE(readingLoop.counted);
+    EXPECT_TRUE(readingLoop.writesBack);
+    EXPECT_EQ(readingLoop.comparison, OperatorKind::Less);
+
+    const std::unique_ptr<Node> silent = parseLoop("for (var i = 9, i >= 0, var i --){\n    var x = x + 1\n}\n");
+    const CountedLoop& silentLoop = dynamic_cast<ForStmt*>(silent.get())->getCountedLoop();
+    EXPECT_TRUE(silentLoop.counted);
+    EXPECT_FALSE(silentLoop.writesBack);
+    EXPECT_EQ(silentLoop.step, -1);
+
+    const std::unique_ptr<Node> writesCounter = parseLoop("for (var i = 0, i < 9, var i ++){\n    var i = i + 1\n}\n");
+    EXPECT_FALSE(dynamic_cast<ForStmt*>(writesCounter.get())->getCountedLoop().counted);
+    const std::unique_ptr<Node> writesBound = parseLoop("for (var i = 0, i < n, var i ++){\n    var n = n - 1\n}\n");
+    EXPECT_FALSE(dynamic_cast<ForStmt*>(writesBound.get())->getCountedLoop().counted);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include "Error.h"
+#include "ProgramFile.h"
+#include "TestHelpers.h"
+
+namespace {
+const std::string programSource =
+    "func square(n){\n"
+    "    return n * n\n"
+    "}\n"
+    "var total = 0\n"
+    "var i = 0\n"
+    "while(i < 5){\n"
+    "    var total = total + square(i)\n"
+    "    var i ++\n"
+    "}\n"
+    "out(\"total\", total, 1.5)\n";
+
+void writeFile(const std::string& filename, const std::string& contents) {
+    std::ofstream file(filename, std::ios::binary);
+    file << contents;
+}
+
+std::string readFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// interprets filename with the given cache directory and returns everything printed to std::cout
+std::string runFile(const std::string& filename, const std::string& cacheDirectory = "") {
+    std::stringstream buffer;
+    std::streambuf* oldCout = std::cout.rdbuf(buffer.rdbuf());
+    try {Interpreter::interpretFile(filename, false, false, false, false, cacheDirectory);}
+    catch (...) {
+        std::cout.rdbuf(oldCout);
+        throw;
+    }
+    std::cout.rdbuf(oldCout);
+    return buffer.str();
+}
+}
+
+TEST(ProgramFileTest, CompiledProgramRunsLikeItsSource) {
+    writeFile("temp_program.vis", programSource);
+    const std::string expected = runFile("temp_program.vis");
+    ASSERT_EQ(expected, "total 30 1.500000 \n");
+    const std::uint64_t sourceHash = ProgramFile::hashBytes(programSource);
+    ProgramFile::save("temp_program.visc", ProgramFile::compile("temp_program.vis"), sourceHash, "temp_program.vis");
+    const std::string program = readFile("temp_program.visc");
+    EXPECT_TRUE(ProgramFile::isProgram(program));
+    EXPECT_FALSE(ProgramFile::isProgram(programSource));
+    EXPECT_EQ(runFile("temp_program.visc"), expected);
+    EXPECT_THROW(Interpreter::interpretFile("temp_program.visc", false, true), ProgramFileError);
+
+    const Chunk chunk = ProgramFile::read(program, sourceHash);
+    std::ostringstream rewritten;
+    ProgramFile::write(rewritten, chunk, sourceHash, "temp_program.vis");
+    EXPECT_EQ(rewritten.str(), program);
+    std::remove("temp_program.vis");
+    std::remove("temp_program.visc");
+}
+
+TEST(ProgramFileTest, RejectsMismatchedAndDamagedPrograms) {
+    writeFile("temp_program.vis", programSource);
+    std::ostringstream os;
+    ProgramFile::write(os, ProgramFile::compile("temp_program.vis"), 42, "temp_program.vis");
+    std::remove("temp_program.vis");
+    const std::string program = os.str();
+    EXPECT_NO_THROW((void)ProgramFile::read(program, 42));
+    EXPECT_THROW((void)ProgramFile::read(program, 43), ProgramFileError);
+    EXPECT_THROW((void)ProgramFile::read(programSource), ProgramFileError);
+    for (std::size_t length = 0; length < program.size(); length += 7) {
+        EXPECT_THROW((void)ProgramFile::read(program.substr(0, length)), ProgramFileError);
+    }
+    std::string flipped = program;
+    flipped.back() = static_cast<char>(flipped.back() ^ 1);
+    EXPECT_THROW((void)ProgramFile::read(flipped), ProgramFileError);
+    std::string otherVersion = program;
+    otherVersion[4] = static_cast<char>(otherVersion[4] + 1);
+    EXPECT_THROW((void)ProgramFile::read(otherVersion), ProgramFileError);
+}
+
+TEST(ProgramFileTest, CacheIsWrittenAfterARunAndReusedUntilTheSourceChanges) {
+    const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "vis_test_cache";
+    std::filesystem::remove_all(cacheDirectory);
+    writeFile("temp_program.vis", programSource);
+    const std::string cachePath = ProgramFile::cachePath(cacheDirectory.string(), ProgramFile::hashBytes(programSource));
+    const std::string expected = runFile("temp_program.vis", cacheDirectory.string());
+    ASSERT_TRUE(std::filesystem::exists(cachePath));
+    EXPECT_EQ(runFile("temp_program.vis", cacheDirectory.string()), expected);
+
+    writeFile(cachePath, "VISC damaged"); // a broken entry is compiled again and replaced
+    EXPECT_EQ(runFile("temp_program.vis", cacheDirectory.string()), expected);
+    EXPECT_TRUE(ProgramFile::isProgram(readFile(cachePath)) && readFile(cachePath).size() > 12);
+
+    writeFile("temp_program.vis", "out(7)\n");
+    EXPECT_EQ(runFile("temp_program.vis", cacheDirectory.string()), "7 \n");
+    writeFile("temp_program.vis", "out(1)\nout(1 / 0)\n"); // runs that fail are never cached
+    EXPECT_THROW(runFile("temp_program.vis", cacheDirectory.string()), VisRunTimeError);
+    EXPECT_FALSE(std::filesystem::exists(ProgramFile::cachePath(cacheDirectory.string(),
+        ProgramFile::hashBytes("out(1)\nout(1 / 0)\n"))));
+    std::remove("temp_program.vis");
+    std::filesystem::remove_all(cacheDirectory);
+}
+
+TEST(ProgramFileTest, RejectsInstructionsOutsideTheirChunk) {
+    const Chunk compiled = ProgramFile::compile("temp_program.vis", SourceBuffer::fromString(programSource));
+    const auto readChanged = [&compiled](const std::function<void(Chunk&)>& change) {
+        Chunk chunk = compiled;
+        change(chunk);
+        std::ostringstream os;
+        ProgramFile::write(os, chunk, 0, "temp_program.vis");
+        return ProgramFile::read(os.str());
+    };
+    const auto find = [](Chunk& chunk, const OpCode op) -> Instruction& {
+        return *std::find_if(chunk.code.begin(), chunk.code.end(), [op](const Instruction& instruction) {return instruction.op == op;});
+    };
+    EXPECT_NO_THROW((void)readChanged([](Chunk&) {}));
+    EXPECT_THROW((void)readChanged([&find](Chunk& chunk) {
+        find(chunk, OpCode::CONSTANT).operand = static_cast<std::int32_t>(chunk.constants.size());
+    }), ProgramFileError);
+    EXPECT_THROW((void)readChanged([&find](Chunk& chunk) {find(chunk, OpCode::GET_VAR).operand = -1;}), ProgramFileError);
+    EXPECT_THROW((void)readChanged([&find](Chunk& chunk) {find(chunk, OpCode::MAKE_FUNCTION).operand = 1;}), ProgramFileError);
+    EXPECT_THROW((void)readChanged([&find](Chunk& chunk) {
+        find(chunk, OpCode::JUMP).operand = static_cast<std::int32_t>(chunk.code.size() + 1);
+    }), ProgramFileError);
+    EXPECT_THROW((void)readChanged([&find](Chunk& chunk) {find(chunk, OpCode::CALL).count = 3;}), ProgramFileError);
+    EXPECT_THROW((void)readChanged([&find](Chunk& chunk) {find(chunk, OpCode::GET_VAR).op = OpCode::GET_LOCAL;}), ProgramFileError);
+    EXPECT_THROW((void)readChanged([&find](Chunk& chunk) {
+        Chunk& body = chunk.functions[0]->chunk;
+        find(body, OpCode::GET_LOCAL).operand = static_cast<std::int32_t>(chunk.functions[0]->locals->size());
+    }), ProgramFileError);
+    EXPECT_THROW((void)readChanged([](Chunk& chunk) { // pops before anything was pushed
+        chunk.code.insert(chunk.code.begin(), Instruction{OpCode::POP, 0, 0});
+        chunk.positions.insert(chunk.positions.begin(), Position{});
+    }), ProgramFileError);
+}
+
+TEST(ProgramFileTest, LoadedPositionsPointAtTheCallersFile) {
+    std::ostringstream os;
+    ProgramFile::write(os, ProgramFile::compile("first.vis", SourceBuffer::fromString(programSource)), 0, "first.vis");
+    const std::uint32_t fileId = SourceTable::registerFile("second.vis", SourceBuffer::fromString(programSource));
+    const Chunk chunk = ProgramFile::read(os.str(), 0, fileId);
+    ASSERT_FALSE(chunk.positions.empty());
+    EXPECT_EQ(SourceTable::getFileName(chunk.positions.front().fileId), "second.vis");
+    EXPECT_EQ(SourceTable::getLineText(chunk.functions[0]->chunk.positions.front()), "    return n * n");
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "Repl.h"
+#include "TestHelpers.h"
+
+namespace {
+struct Session {
+    std::string output;
+    std::string errors;
+};
+
+Session runSession(const std::string& input, const bool prompts = false) {
+    std::ostringstream os;
+    std::ostringstream errors;
+    {
+        Repl repl(os, errors);
+        std::istringstream is(input);
+        repl.run(is, prompts);
+    }
+    return Session{os.str(), errors.str()};
+}
+}
+
+TEST(ReplTest, DefinitionsPersistAcrossInputs) {
+    const Session session = runSession(
+        "var total = 10\n"
+        "func add(a, b){\n"
+        "    return a + b\n"
+        "}\n"
+        "add(total, 5)\n"
+        "var total = add(total, 1)\n"
+        "out(\"total\", total)\n"
+        "total * 2\n"
+        "\"text\"\n");
+    EXPECT_EQ(session.output, "15\ntotal 11 \n22\ntext\n");
+    EXPECT_EQ(session.errors, "");
+}
+
+TEST(ReplTest, IfWaitsForAnElseAndBlocksRunWhenBalanced) {
+    Repl repl(std::cout, std::cerr);
+    EXPECT_TRUE(repl.addLine("while(false){"));
+    EXPECT_FALSE(repl.addLine("}"));
+    EXPECT_TRUE(repl.addLine("if(true){"));
+    EXPECT_TRUE(repl.addLine("    out(1)"));
+    EXPECT_TRUE(repl.addLine("}")); // held back in case the next line is an else
+    EXPECT_TRUE(repl.addLine("else{"));
+    EXPECT_TRUE(repl.addLine("    out(2)"));
+    EXPECT_FALSE(repl.addLine("}"));
+
+    const Session session = runSession(
+        "var x = 3\n"
+        "if(x > 5){\n"
+        "    out(\"big\")\n"
+        "} else {\n"
+        "    out(\"small\")\n"
+        "}\n"
+        "if(x == 3){\n"
+        "    out(\"three\")\n"
+        "}\n"
+        "out(\"after\")\n"
+        "if(x == 3){\n"
+        "    out(\"last\")\n"
+        "}\n");
+    EXPECT_EQ(session.output, "small \nthree \nafter \nlast \n");
+}
+
+TEST(ReplTest, ErrorsAreReportedAndTheSessionContinues) {
+    const Session session = runSession(
+        "var kept = 1\n"
+        "var = 2\n"
+        "out(\"before\")\nout(kept / 0)\n"
+        "out(missing)\n"
+        "kept + 1\n"
+        "func broken(a){\n"
+        "    return a +\n", true);
+    EXPECT_EQ(session.output, "vis> vis> vis> before \nvis> vis> vis> 2\nvis> ...  ...  \n");
+    EXPECT_NE(session.errors.find("Division by zero"), std::string::npos);
+    EXPECT_NE(session.errors.find("missing"), std::string::npos);
+    EXPECT_NE(session.errors.find("line: 2 | var = 2"), std::string::npos);
+    EXPECT_NE(session.errors.rfind("Syntax Error"), session.errors.find("Syntax Error")); // the unfinished function too
+}
+
+TEST(ReplTest, InputsShareOneSourceFileReleasedWithTheSession) {
+    const std::uint32_t freeId = SourceTable::registerFile("probe.vis");
+    SourceTable::releaseFile(freeId);
+    {
+        Repl repl(std::cout, std::cerr);
+        EXPECT_EQ(SourceTable::getFileName(freeId), "<repl>");
+        EXPECT_FALSE(repl.addLine("var a = 1"));
+        EXPECT_FALSE(repl.addLine("var b = a + 1"));
+        EXPECT_EQ(SourceTable::getLineText(Position{freeId, 1, 0}), "var b = a + 1");
+    }
+    const SourceRegistration after(SourceTable::registerFile("after.vis"));
+    EXPECT_EQ(after.getFileId(), freeId);
+}
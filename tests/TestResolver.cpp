@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include "Lexer.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+#include "Resolver.h"
+#include "TestHelpers.h"
+
+TEST(ResolverTest, GivesArgumentsAndLocalsSlots) {
+    std::vector<Token> args;
+    args.push_back(Token(TokenType::IDENTIFIER, dummyPos, "a"));
+    std::vector<std::unique_ptr<Node>> body;
+    body.push_back(std::make_unique<VarAssignment>(Token(TokenType::IDENTIFIER, dummyPos, "b"),
+        std::make_unique<VarAccess>(Token(TokenType::IDENTIFIER, dummyPos, "a"))));
+    body.push_back(std::make_unique<ReturnCall>(Token(TokenType::KEYWORD, dummyPos, "return"),
+        std::make_unique<VarAccess>(Token(TokenType::IDENTIFIER, dummyPos, "g"))));
+    const std::unique_ptr<Node> node = std::make_unique<FuncDef>(
+        Token(TokenType::IDENTIFIER, dummyPos, "f"), std::move(args), std::move(body));
+    Resolver().resolve(node);
+
+    const auto* funcDef = dynamic_cast<FuncDef*>(node.get());
+    EXPECT_FALSE(funcDef->getSlotRef().isResolved());
+    ASSERT_NE(funcDef->getLocals(), nullptr);
+    EXPECT_EQ(*funcDef->getLocals(), (std::vector<std::string>{"a", "b"}));
+    ASSERT_NE(funcDef->getCapturedSlots(), nullptr);
+    EXPECT_EQ(*funcDef->getCapturedSlots(), (std::vector<bool>{false, false}));
+    const auto* assignment = dynamic_cast<VarAssignment*>(funcDef->getFunctionBody()[0].get());
+    EXPECT_EQ(assignment->getSlotRef().depth, 0);
+    EXPECT_EQ(assignment->getSlotRef().slot, 1);
+    EXPECT_EQ(assignment->getValue()->getSlotRef().slot, 0);
+    const auto* returnCall = dynamic_cast<ReturnCall*>(funcDef->getFunctionBody()[1].get());
+    EXPECT_FALSE(returnCall->getExpression()->getSlotRef().isResolved());
+}
+
+TEST(ResolverTest, NestedFunctionsReadEnclosingSlots) {
+    const std::string source =
+        "func outer(x){\n"
+        "    func inner(){\n"
+        "        return x * 2\n"
+        "    }\n"
+        "    return inner()\n"
+        "}\n"
+        "out(outer(21))\n";
+    EXPECT_EQ(runVisSource(source), "42 \n");
+    EXPECT_EQ(runVisSource(source, true), "42 \n");
+}
+
+TEST(ResolverTest, MarksOnlySlotsNestedFunctionsRead) {
+    std::vector<Token> args;
+    args.push_back(Token(TokenType::IDENTIFIER, dummyPos, "x"));
+    std::vector<std::unique_ptr<Node>> innerBody;
+    innerBody.push_back(std::make_unique<ReturnCall>(Token(TokenType::KEYWORD, dummyPos, "return"),
+        std::make_unique<VarAccess>(Token(TokenType::IDENTIFIER, dummyPos, "x"))));
+    std::vector<std::unique_ptr<Node>> body;
+    body.push_back(std::make_unique<VarAssignment>(Token(TokenType::IDENTIFIER, dummyPos, "y"), makeNumbernode(1)));
+    body.push_back(std::make_unique<FuncDef>(
+        Token(TokenType::IDENTIFIER, dummyPos, "inner"), std::vector<Token>{}, std::move(innerBody)));
+    const std::unique_ptr<Node> node = std::make_unique<FuncDef>(
+        Token(TokenType::IDENTIFIER, dummyPos, "outer"), std::move(args), std::move(body));
+    Resolver().resolve(node);
+
+    const auto* funcDef = dynamic_cast<FuncDef*>(node.get());
+    EXPECT_EQ(*funcDef->getLocals(), (std::vector<std::string>{"x", "y", "inner"}));
+    ASSERT_NE(funcDef->getCapturedSlots(), nullptr);
+    EXPECT_EQ(*funcDef->getCapturedSlots(), (std::vector<bool>{true, false, false})); // y and inner go once outer returns
+}
+
+TEST(ResolverTest, FunctionsReadingTheirOwnNameBindThemselves) {
+    const auto resolveOuter = [](const std::string& source) {
+        std::istringstream stream(source);
+        PositionHandler positionHandler("mock.vis", stream);
+        std::unique_ptr<Node> node = Parser(Lexer(positionHandler).tokenise()).parse();
+        Resolver().resolve(node);
+        return node;
+    };
+    const std::unique_ptr<Node> bound = resolveOuter(
+        "func outer(){\n    func rec(k){\n        return rec(k - 1)\n    }\n    return rec\n}\n");
+    const auto* rec = dynamic_cast<FuncDef*>(dynamic_cast<FuncDef*>(bound.get())->getFunctionBody()[0].get());
+    EXPECT_EQ(*rec->getLocals(), (std::vector<std::string>{"k", "rec"}));
+    EXPECT_EQ(rec->getSelfSlot(), 1);
+    const auto* call = dynamic_cast<ReturnCall*>(rec->getFunctionBody()[0].get())->getExpression().get();
+    EXPECT_EQ(call->getSlotRef().depth, 0);
+    EXPECT_EQ(call->getSlotRef().slot, 1);
+    EXPECT_EQ(*dynamic_cast<FuncDef*>(bound.get())->getCapturedSlots(), (std::vector<bool>{false}));
+
+    // a later write means the name may not be the function any more, so it is read through the frame as before
+    const std::unique_ptr<Node> rebound = resolveOuter(
+        "func outer(){\n    func rec(k){\n        return rec(k - 1)\n    }\n    var f = rec\n    var rec = 1\n    return f\n}\n");
+    const auto* outer = dynamic_cast<FuncDef*>(rebound.get());
+    EXPECT_EQ(dynamic_cast<FuncDef*>(outer->getFunctionBody()[0].get())->getSelfSlot(), -1);
+    EXPECT_EQ(*outer->getCapturedSlots(), (std::vector<bool>{true, false}));
+}
+
+TEST(ResolverTest, SlotsOfReturnedFramesStayReadable) {
+    const std::string source =
+        "func outer(x){\n"
+        "    func middle(y){\n"
+        "        func leaf(z){\n"
+        "            return x + y + z\n"
+        "        }\n"
+        "        return leaf\n"
+        "    }\n"
+        "    return middle\n"
+        "}\n"
+        "var m = outer(1)\n"
+        "var l = m(10)\n"
+        "var m = 0\n"
+        "out(l(100), m)\n";
+    EXPECT_EQ(runVisSource(source), "111 0 \n");
+    EXPECT_EQ(runVisSource(source, true), "111 0 \n");
+}
+
+TEST(ResolverTest, UnassignedLocalFallsBackToGlobal) {
+    const std::string source =
+        "var x = 100\n"
+        "func f(){\n"
+        "    var total = 0\n"
+        "    for (var i = 0, i < 3, var i ++){\n"
+        "        var total = total + x\n"
+        "        var x = i\n"
+        "    }\n"
+        "    return total\n"
+        "}\n"
+        "out(f(), x)\n";
+    EXPECT_EQ(runVisSource(source), "101 100 \n");
+    EXPECT_EQ(runVisSource(source, true), "101 100 \n");
+}
@@ -6,8 +6,8 @@ TEST(TokenTest, CreatesIntTokenCorrectly) {
     Token token(TokenType::INT, dummyPos, 42);
     EXPECT_EQ(token.getType(), TokenType::INT);
     EXPECT_EQ(std::get<int>(token.getValue()), 42);
-    EXPECT_EQ(token.getPos()["line"], "0");
-    EXPECT_EQ(token.getPos()["charPos"], "0");
+    EXPECT_EQ(token.getPos().line, 0);
+    EXPECT_EQ(token.getPos().charPos, 0);
 }
 
 TEST(TokenUtilTest, TokenTypeToStrExpected) {
@@ -33,7 +33,7 @@ TEST(TokenTest, CloneProducesEqualToken) {
 }
 
 TEST(TokenTest, canOutputFloatToken) {
-    Token token(TokenType::FLOAT, dummyPos, 3.14f);
+    Token token(TokenType::FLOAT, dummyPos, 3.14);
     std::ostringstream oss;
     oss << token;
     std::string output = oss.str();
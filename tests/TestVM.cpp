@@ -0,0 +1,295 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "Compiler.h"
+#include "Error.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "PositionHandler.h"
+#include "Resolver.h"
+#include "VM.h"
+#include "TestHelpers.h"
+
+const std::string fizzBuzzSource =
+    "func main(x){\n"
+    "    while(x > 0){\n"
+    "        if(x%3 == 0){\n"
+    "            if(x%5 == 0){\n"
+    "                out(\"fizzBuzz\")\n"
+    "            }\n"
+    "            else{\n"
+    "                out(\"fizz\")\n"
+    "            }\n"
+    "        }\n"
+    "        else{\n"
+    "            if(x%5 == 0){\n"
+    "                out(\"buzz\")\n"
+    "            }\n"
+    "            else{\n"
+    "                out(x)\n"
+    "            }\n"
+    "        }\n"
+    "        var x --\n"
+    "    }\n"
+    "}\n"
+    "main(15)\n";
+
+TEST(CompilerTest, CompilesBinaryOperation) {
+    Chunk chunk;
+    Compiler compiler(chunk);
+    const std::unique_ptr<Node> node = std::make_unique<BinaryOperator>(
+        makeNumbernode(2), Operator(Token(TokenType::MUL, dummyPos)), makeNumbernode(3));
+    compiler.compile(node);
+    ASSERT_EQ(chunk.code.size(), 3);
+    EXPECT_EQ(chunk.code[0].op, OpCode::CONSTANT);
+    EXPECT_EQ(chunk.code[1].op, OpCode::CONSTANT);
+    EXPECT_EQ(chunk.code[2].op, OpCode::MULTIPLY);
+    EXPECT_EQ(chunk.positions.size(), chunk.code.size());
+}
+
+TEST(CompilerTest, CompilesFunctionIntoSeparateChunk) {
+    Chunk chunk;
+    Compiler compiler(chunk);
+    std::vector<Token> args;
+    args.push_back(Token(TokenType::IDENTIFIER, dummyPos, "a"));
+    std::vector<std::unique_ptr<Node>> body;
+    body.push_back(std::make_unique<ReturnCall>(Token(TokenType::KEYWORD, dummyPos, "return"),
+        std::make_unique<VarAccess>(Token(TokenType::IDENTIFIER, dummyPos, "a"))));
+    const std::unique_ptr<Node> node = std::make_unique<FuncDef>(
+        Token(TokenType::IDENTIFIER, dummyPos, "identity"), std::move(args), std::move(body));
+    compiler.compile(node);
+    ASSERT_EQ(chunk.functions.size(), 1);
+    ASSERT_EQ(chunk.code.size(), 2);
+    EXPECT_EQ(chunk.code[0].op, OpCode::MAKE_FUNCTION);
+    EXPECT_EQ(chunk.code[1].op, OpCode::SET_VAR);
+    const Chunk& functionChunk = chunk.functions[0]->chunk;
+    ASSERT_EQ(functionChunk.code.size(), 4);
+    EXPECT_EQ(functionChunk.code[0].op, OpCode::GET_VAR);
+    EXPECT_EQ(functionChunk.code[1].op, OpCode::RETURN);
+    EXPECT_EQ(functionChunk.code.back().op, OpCode::RETURN_NULL);
+}
+
+TEST(CompilerTest, RewindDropsEverythingCompiledAfterTheMark) {
+    Chunk chunk;
+    Compiler compiler(chunk);
+    compiler.compile(std::make_unique<VarAssignment>(Token(TokenType::IDENTIFIER, dummyPos, "kept"), makeNumbernode(1)));
+    const Compiler::Mark mark = compiler.getMark();
+    std::vector<std::unique_ptr<Node>> body;
+    body.push_back(std::make_unique<ReturnCall>(Token(TokenType::KEYWORD, dummyPos, "return"), makeNumbernode(2)));
+    const std::unique_ptr<Node> node = std::make_unique<FuncDef>(
+        Token(TokenType::IDENTIFIER, dummyPos, "dropped"), std::vector<Token>{}, std::move(body));
+    compiler.compile(node);
+    compiler.compile(std::make_unique<VarAccess>(Token(TokenType::IDENTIFIER, dummyPos, "other")));
+    compiler.compile(makeNumbernode(3));
+    compiler.rewind(mark);
+    EXPECT_EQ(chunk.code.size(), mark.code);
+    EXPECT_EQ(chunk.positions.size(), mark.positions);
+    EXPECT_EQ(chunk.constants.size(), mark.constants);
+    EXPECT_EQ(chunk.names, std::vector<std::string>{"kept"});
+    EXPECT_EQ(chunk.callSiteCaches.size(), mark.callSiteCaches);
+    EXPECT_EQ(chunk.functions.size(), mark.functions);
+
+    compiler.compile(std::make_unique<VarAccess>(Token(TokenType::IDENTIFIER, dummyPos, "other")));
+    EXPECT_EQ(chunk.names, (std::vector<std::string>{"kept", "other"})); // names dropped by the rewind are added again
+    EXPECT_EQ(chunk.code.back().operand, 1);
+}
+
+TEST(VMTest, RunsArithmeticStatement) {
+    auto context = makeMockContext();
+    Chunk chunk;
+    Compiler compiler(chunk);
+    const std::unique_ptr<Node> node = std::make_unique<BinaryOperator>(
+        makeNumbernode(20), Operator(Token(TokenType::MINUS, dummyPos)), makeNumbernode(5));
+    compiler.compile(node);
+    VM vm(&context);
+    const Value result = vm.run(chunk, 0);
+    ASSERT_EQ(result.getType(), ValueType::Int);
+    EXPECT_EQ(result.getNumberValue(), 15);
+}
+
+TEST(VMTest, RunsLoopsAndRecursion) {
+    const std::string output = runVisSource(
+        "func fib(n){\n"
+        "    if (n < 2){\n"
+        "        return n\n"
+        "    }\n"
+        "    return fib(n - 1) + fib(n - 2)\n"
+        "}\n"
+        "var total = 0\n"
+        "for (var i = 0, i < 5, var i ++){\n"
+        "    var total = total + fib(i)\n"
+        "}\n"
+        "out(total, fib(10))\n");
+    EXPECT_EQ(output, "7 55 \n");
+}
+
+TEST(VMTest, ReusesFramesWithoutLosingClosures) {
+    const std::string source =
+        "func outer(n){\n"
+        "    func inner(){\n"
+        "        return n\n"
+        "    }\n"
+        "    return inner() + depth(n)\n"
+        "}\n"
+        "func depth(n){\n"
+        "    if (n < 1){\n"
+        "        return 0\n"
+        "    }\n"
+        "    return depth(n - 1) + 1\n"
+        "}\n"
+        "out(outer(3), outer(4), depth(5))\n";
+    EXPECT_EQ(runVisSource(source), "6 8 5 \n");
+    EXPECT_EQ(runVisSource(source, true), "6 8 5 \n");
+}
+
+TEST(VMTest, ClosuresOutliveTheCallThatMadeThem) {
+    const std::string source =
+        "func make(n){\n"
+        "    func inner(x){\n"
+        "        return n + x\n"
+        "    }\n"
+        "    return inner\n"
+        "}\n"
+        "var one = make(1)\n"
+        "var hundred = make(100)\n"
+        "func churn(k){\n"
+        "    var scratch = k * 7\n"
+        "    return scratch\n"
+        "}\n"
+        "out(churn(3), churn(4))\n"
+        "out(one(1), hundred(1))\n";
+    EXPECT_EQ(runVisSource(source), "21 28 \n2 101 \n");
+    EXPECT_EQ(runVisSource(source, true), "21 28 \n2 101 \n");
+}
+
+TEST(VMTest, ClosuresCallingThemselvesDoNotHoldTheirFrame) {
+    const std::string source =
+        "func counter(n){\n"
+        "    func rec(k){\n"
+        "        if (k < 1) {\n"
+        "            return n\n"
+        "        }\n"
+        "        return rec(k - 1) + 1\n"
+        "    }\n"
+        "    return rec\n"
+        "}\n"
+        "counter(10)\n";
+    for (const bool treeWalk : {false, true}) {
+        std::istringstream stream(source);
+        PositionHandler positionHandler("mock.vis", stream);
+        Parser parser(Lexer(positionHandler).tokenise());
+        Resolver resolver;
+        const std::unique_ptr<Context> globals = Context::makeGlobal("test");
+        Chunk chunk;
+        Compiler compiler(chunk);
+        VM vm(globals.get());
+        Value closure;
+        for (std::unique_ptr<Node> node = parser.parse(); node->getType() != NodeType::EndOfFile; node = parser.parse()) {
+            resolver.resolve(node);
+            if (treeWalk) {closure = Interpreter::evaluate(node, globals.get());}
+            else {
+                const std::size_t start = chunk.code.size();
+                compiler.compile(node);
+                closure = vm.run(chunk, start);
+            }
+        }
+        ASSERT_NE(closure.getFunction(), nullptr);
+        EXPECT_EQ(closure.getShareCount(), 1); // the frame counter ran in no longer holds rec
+    }
+    const std::string calls = source + "var rec = counter(10)\nout(rec(3), rec(0))\n";
+    EXPECT_EQ(runVisSource(calls), "13 10 \n");
+    EXPECT_EQ(runVisSource(calls, true), "13 10 \n");
+}
+
+TEST(VMTest, CallSitesFollowRebinding) {
+    const std::string source =
+        "func f(){\n"
+        "    return 1\n"
+        "}\n"
+        "func g(){\n"
+        "    return f()\n"
+        "}\n"
+        "out(g(), f())\n"
+        "func f(){\n"
+        "    return 2\n"
+        "}\n"
+        "out(g(), f())\n"
+        "var f = 3\n"
+        "out(f)\n"
+        "g()\n";
+    EXPECT_THROW(runVisSource(source), VisRunTimeError);
+    EXPECT_THROW(runVisSource(source, true), VisRunTimeError);
+    const std::string rebound = source.substr(0, source.find("var f = 3"));
+    EXPECT_EQ(runVisSource(rebound), "1 1 \n2 2 \n");
+    EXPECT_EQ(runVisSource(rebound, true), "1 1 \n2 2 \n");
+}
+
+TEST(VMTest, CountedLoopsKeepLoopSemantics) {
+    const std::string source =
+        "func f(n){\n"
+        "    var total = 0\n"
+        "    for (var i = 0, i < n, var i ++){\n"
+        "        var total = total + 1\n"
+        "    }\n"
+        "    for (var j = 3, j >= 1, var j --){\n"
+        "        out(j)\n"
+        "    }\n"
+        "    for (var k = 0.5, k <= 2, var k ++){\n"
+        "        out(k)\n"
+        "    }\n"
+        "    out(total, i, j)\n"
+        "}\n"
+        "f(5)\n"
+        "for (var g = 0, g != 2, var g ++){\n"
+        "    out(g)\n"
+        "}\n"
+        "out(g)\n";
+    const std::string expected = "3 \n2 \n1 \n0.500000 \n1.500000 \n5 5 0 \n0 \n1 \n2 \n";
+    EXPECT_EQ(runVisSource(source), expected);
+    EXPECT_EQ(runVisSource(source, true), expected);
+}
+
+TEST(VMTest, TailCallsReuseTheCallingFrame) {
+    const std::string source =
+        "func count(n, total){\n"
+        "    if (n == 0) {\n"
+        "        return total\n"
+        "    }\n"
+        "    for (var i = 0, i < 1, var i ++){\n"
+        "        return count(n - 1, total + n)\n"
+        "    }\n"
+        "}\n"
+        "func outer(n){\n"
+        "    func step(m){\n"
+        "        return m + n\n"
+        "    }\n"
+        "    return step(n)\n"
+        "}\n"
+        "out(count(200000, 0), outer(4))\n";
+    EXPECT_EQ(runVisSource(source), "20000100000 8 \n");
+    EXPECT_EQ(runVisSource(source, true), "20000100000 8 \n");
+
+    std::istringstream stream("func f(n){\n    return f(n)\n}\n");
+    PositionHandler positionHandler("mock.vis", stream);
+    Lexer lexer(positionHandler);
+    Parser parser(lexer.tokenise());
+    const std::unique_ptr<Node> node = parser.parse();
+    Resolver().resolve(node);
+    Chunk chunk;
+    Compiler(chunk).compile(node);
+    const std::vector<Instruction>& code = chunk.functions[0]->chunk.code;
+    ASSERT_GE(code.size(), 2);
+    EXPECT_EQ(code[0].op, OpCode::GET_LOCAL);
+    EXPECT_EQ(code[1].op, OpCode::TAIL_CALL);
+    for (const Instruction& instruction : code) {EXPECT_NE(instruction.op, OpCode::CALL);}
+}
+
+TEST(VMTest, MatchesTreeWalkerOutput) {
+    const std::string vmOutput = runVisSource(fizzBuzzSource);
+    const std::string treeOutput = runVisSource(fizzBuzzSource, true);
+    EXPECT_EQ(vmOutput, treeOutput);
+    EXPECT_NE(vmOutput.find("fizzBuzz"), std::string::npos);
+}
+
+TEST(VMTest, ReturnOutsideFunctionThrows) {
+    EXPECT_THROW(runVisSource("return 5\n"), VisRunTimeError);
+}
@@ -0,0 +1,89 @@
+#include <limits>
+#include <gtest/gtest.h>
+#include "Error.h"
+#include "Literal.h"
+#include "Value.h"
+
+TEST(ValueTest, IntegralArithmeticStaysInt) {
+    const Value result = Value(7).add(Value(3));
+    EXPECT_EQ(result.getType(), ValueType::Int);
+    EXPECT_EQ(result.getNumberValue(), 10);
+    const Value fraction = Value(7).divide(Value(2));
+    EXPECT_EQ(fraction.getType(), ValueType::Float);
+    EXPECT_EQ(fraction.getNumberValue(), 3.5);
+}
+
+TEST(ValueTest, IntegersStayExactPastFloatPrecision) {
+    const Value large(std::int64_t{9007199254740993}); // 2^53 + 1, not representable as a double
+    const Value sum = large.add(Value(2));
+    EXPECT_EQ(sum.getType(), ValueType::Int);
+    EXPECT_EQ(sum.getIntValue(), 9007199254740995);
+    EXPECT_EQ(sum.getStringValue(), "9007199254740995");
+    EXPECT_EQ(Value(16777217).multiply(Value(3)).getIntValue(), 50331651);
+    EXPECT_TRUE(large.compareLT(Value(std::int64_t{9007199254740994})).getBoolValue());
+    EXPECT_FALSE(large.compareTE(Value(std::int64_t{9007199254740992})).getBoolValue());
+    EXPECT_EQ(Value(-7).modulo(Value(-1)).getIntValue(), 0);
+}
+
+TEST(ValueTest, IntegerOverflowThrows) {
+    const Value maximum(std::numeric_limits<std::int64_t>::max());
+    const Value minimum(std::numeric_limits<std::int64_t>::min());
+    EXPECT_THROW((void)maximum.add(Value(1)), VisRunTimeError);
+    EXPECT_THROW((void)minimum.subtract(Value(1)), VisRunTimeError);
+    EXPECT_THROW((void)maximum.multiply(Value(2)), VisRunTimeError);
+    EXPECT_THROW((void)minimum.divide(Value(-1)), VisRunTimeError);
+    EXPECT_THROW((void)minimum.negate(), VisRunTimeError);
+}
+
+TEST(ValueTest, FloatArithmeticStaysFloat) {
+    const Value sum = Value(1.5).add(Value(1.5));
+    EXPECT_EQ(sum.getType(), ValueType::Float);
+    EXPECT_EQ(sum.getNumberValue(), 3.0);
+    const Value mixed = Value(2).multiply(Value(0.1));
+    EXPECT_EQ(mixed.getType(), ValueType::Float);
+    EXPECT_EQ(mixed.getNumberValue(), 2 * 0.1);
+}
+
+TEST(ValueTest, StringsConcatenateAndCompare) {
+    const Value hello(std::shared_ptr<const Literal>(std::make_shared<StringLiteral>("hello ")));
+    const Value world(std::shared_ptr<const Literal>(std::make_shared<StringLiteral>("world")));
+    const Value combined = hello.add(world);
+    EXPECT_EQ(combined.getType(), ValueType::String);
+    EXPECT_EQ(combined.getStringValue(), "hello world");
+    EXPECT_TRUE(combined.compareNE(hello).getBoolValue());
+}
+
+TEST(ValueTest, AppendingLeavesEveryEarlierStringUnchanged) {
+    const Value start = Value::fromString("ab");
+    const Value longer = start.add(Value::fromString("cd")); // written into start's storage
+    const Value branch = start.add(Value::fromString("xy")); // start no longer ends the storage so this copies
+    EXPECT_EQ(start.getStringView(), "ab");
+    EXPECT_EQ(longer.getStringView(), "abcd");
+    EXPECT_EQ(branch.getStringView(), "abxy");
+    EXPECT_EQ(longer.getStringView().data(), start.getStringView().data());
+    EXPECT_NE(branch.getStringView().data(), start.getStringView().data());
+
+    Value report = longer;
+    for (int line = 0; line < 1000; line++) {report = report.add(report.compareTE(longer).getBoolValue() ? longer : start);}
+    EXPECT_EQ(report.getStringView().size(), 4u + 4u + 999u * 2u);
+    const Value doubled = report.add(report); // the tail is a view of the storage being grown
+    EXPECT_EQ(doubled.getStringView().substr(0, report.getStringView().size()), report.getStringView());
+    EXPECT_EQ(doubled.getStringView().substr(report.getStringView().size()), report.getStringView());
+    EXPECT_EQ(longer.getStringValue(), "abcd");
+    EXPECT_TRUE(longer.toLiteral()->getStringValue() == "abcd"); // clones share the storage too
+}
+
+TEST(ValueTest, InvalidOperationsThrow) {
+    EXPECT_THROW((void)Value(true).subtract(Value(1)), VisRunTimeError);
+    EXPECT_THROW((void)Value(1).modulo(Value(0)), VisRunTimeError);
+    EXPECT_THROW((void)Value().add(Value(1)), VisRunTimeError);
+}
+
+TEST(ValueTest, LiteralRoundTrip) {
+    const Value number = Value::fromLiteral(std::make_unique<FloatLiteral>(2.5));
+    EXPECT_EQ(number.getType(), ValueType::Float);
+    const std::unique_ptr<Literal> literal = number.toLiteral();
+    ASSERT_NE(dynamic_cast<FloatLiteral*>(literal.get()), nullptr);
+    EXPECT_EQ(literal->getNumberValue(), 2.5);
+    EXPECT_EQ(Value::fromLiteral(std::make_unique<BoolLiteral>(true)).getType(), ValueType::Bool);
+}